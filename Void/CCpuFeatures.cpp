@@ -0,0 +1,58 @@
+#include "../Header/CCpuFeatures.h"
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//eax, ebx, ecx, edx of cpuid leaf, zeros if the leaf is not supported
+		static void ReadCpuId(const uint32 leaf, uint32 info[4])
+		{
+#ifdef _MSC_VER
+			__cpuid((int*)info, leaf);
+#else
+			if(!__get_cpuid(leaf, &info[0], &info[1], &info[2], &info[3]))
+				info[0] = info[1] = info[2] = info[3] = 0;
+#endif
+		}
+
+		//state components the os saves on context switch, only valid with osxsave
+		static uint64 ReadXcr0()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32 low, high;
+			__asm__ __volatile__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return ((uint64)high << 32) | low;
+#endif
+		}
+
+		CCpuFeatures::SimdLevel CCpuFeatures::DetectLevel()
+		{
+			uint32 info[4];
+			ReadCpuId(0, info);
+			if(info[0] < 1)
+				return SIMD_SCALAR;
+
+			ReadCpuId(1, info);
+			bool sse2		= (info[3] & (1 << 26)) != 0;
+			bool osxsave	= (info[2] & (1 << 27)) != 0;
+			bool avx		= (info[2] & (1 << 28)) != 0;
+
+			//the os has to save ymm registers on context switch
+			if(avx && osxsave && (ReadXcr0() & 0x6) == 0x6)
+				return SIMD_AVX;
+
+			if(sse2)
+				return SIMD_SSE2;
+
+			return SIMD_SCALAR;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+/*
+	Instruction sets the cpu and the os support, shared by
+	every module that picks a SIMD kernel at run time.
+*/
+
+#ifndef _CCPUFEATURES_H_
+#define _CCPUFEATURES_H_
+
+#include "../../Core/Header/Void.h"
+
+//msvc emits avx intrinsics anywhere, gcc and clang only in functions compiled for avx
+//put it in front of every function using them, the translation unit itself is built without -mavx
+#ifdef _MSC_VER
+#define CPUFEATURES_TARGET_AVX
+#else
+#define CPUFEATURES_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+namespace Void
+{
+	namespace Renderer
+	{
+		class CCpuFeatures
+		{
+		public:
+			enum SimdLevel
+			{
+				SIMD_SCALAR = 0x0,
+				SIMD_SSE2,
+				SIMD_AVX
+			};
+
+		public:
+			//highest level supported by cpu and os
+			static SimdLevel DetectLevel();
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "../Header/CEffectParameterCache.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		static CEffectParameterCache s_EffectParameterCache;
+		CEffectParameterCache* EffectParameterCache = &s_EffectParameterCache;
+
+		CEffectParameterCache::CEffectParameterCache()
+			:	m_Source(NULL),
+				m_NextGeneration(1),
+				m_SentCnt(0),
+				m_SkippedCnt(0)
+		{
+		}
+
+		CEffectParameterCache::~CEffectParameterCache()
+		{
+			this->Release();
+		}
+
+		void CEffectParameterCache::Release()
+		{
+			m_Effects.clear();
+		}
+
+		bool CEffectParameterCache::RegisterEffect(const CEffect* const effect, ID3DXEffect* const d3dxEffect)
+		{
+			D3DXEFFECT_DESC effectDesc;
+			HRESULT hr = d3dxEffect->GetDesc(&effectDesc);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetDesc Failed. [CEffectParameterCache::RegisterEffect]");
+				return false;
+			}
+
+			EffectRecord& record = m_Effects[effect];
+			EffectParameterMap& parameters = record.Parameters;
+			parameters.clear();
+			record.Generation = m_NextGeneration++;
+
+			for(uint32 i = 0; i < effectDesc.Parameters; ++i)
+			{
+				D3DXHANDLE handle = d3dxEffect->GetParameter(NULL, i);
+				if(handle == NULL)
+					continue;
+
+				D3DXPARAMETER_DESC desc;
+				hr = d3dxEffect->GetParameterDesc(handle, &desc);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("GetParameterDesc Failed. [CEffectParameterCache::RegisterEffect]");
+					continue;
+				}
+
+				EffectParameter parameter;
+				parameter.Handle	= handle;
+				parameter.Slot		= parameters.size();
+				parameters.insert(EffectParameterMapEnt(CHashedString(desc.Name), parameter));
+			}
+
+			record.UploadedVersions.assign(parameters.size(), 0);
+			return true;
+		}
+
+		void CEffectParameterCache::RegisterEffect(const CEffect* const effect, const char* const* const names, const uint32 nameCnt)
+		{
+			EffectRecord& record = m_Effects[effect];
+			EffectParameterMap& parameters = record.Parameters;
+			parameters.clear();
+			record.Generation = m_NextGeneration++;
+
+			for(uint32 i = 0; i < nameCnt; ++i)
+			{
+				EffectParameter parameter;
+				parameter.Handle	= NULL;
+				parameter.Slot		= parameters.size();
+				parameters.insert(EffectParameterMapEnt(CHashedString(names[i]), parameter));
+			}
+
+			record.UploadedVersions.assign(parameters.size(), 0);
+		}
+
+		void CEffectParameterCache::UnregisterEffect(const CEffect* const effect)
+		{
+			m_Effects.erase(effect);
+		}
+
+		const EffectParameterMap* CEffectParameterCache::GetParameters(const CEffect* const effect)
+		{
+			std::unordered_map<const CEffect*, EffectRecord>::iterator iter = m_Effects.find(effect);
+			if(iter != m_Effects.end())
+				return &iter->second.Parameters;
+
+			if(effect == NULL || m_Source == NULL)
+				return NULL;
+
+			//a failed registration leaves an empty record, the effect is not asked for again
+			ID3DXEffect* d3dxEffect = m_Source(effect);
+			if(d3dxEffect == NULL || !this->RegisterEffect(effect, d3dxEffect))
+			{
+				EffectRecord& record = m_Effects[effect];
+				record.Generation = m_NextGeneration++;
+			}
+
+			return &m_Effects[effect].Parameters;
+		}
+
+		uint64* CEffectParameterCache::GetUploadedVersions(const CEffect* const effect)
+		{
+			std::unordered_map<const CEffect*, EffectRecord>::iterator iter = m_Effects.find(effect);
+			if(iter == m_Effects.end() || iter->second.UploadedVersions.empty())
+				return NULL;
+
+			return &iter->second.UploadedVersions[0];
+		}
+
+		void CEffectParameterCache::InvalidateUploads(const CEffect* const effect)
+		{
+			std::unordered_map<const CEffect*, EffectRecord>::iterator iter = m_Effects.find(effect);
+			if(iter != m_Effects.end())
+				std::fill(iter->second.UploadedVersions.begin(), iter->second.UploadedVersions.end(), 0);
+		}
+
+		void CEffectParameterCache::InvalidateUpload(const CEffect* const effect, const EffectParameter* const parameter)
+		{
+			if(parameter == NULL)
+				return;
+
+			std::unordered_map<const CEffect*, EffectRecord>::iterator iter = m_Effects.find(effect);
+			if(iter != m_Effects.end() && parameter->Slot < iter->second.UploadedVersions.size())
+				iter->second.UploadedVersions[parameter->Slot] = 0;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,173 @@
+/*
+	Parameter handles of loaded effects, keyed by effect and
+	parameter name. Handles are resolved once when an effect
+	registers, on load or the first time its parameters are
+	asked for, setting a parameter by handle skips the name
+	lookup inside the effect. Every parameter also remembers
+	the version of the value it received last, uploads of an
+	unchanged version can be skipped. Each registration gets
+	its own generation, handles cached elsewhere only go stale
+	when their own effect registers again.
+*/
+
+#ifndef _CEFFECTPARAMETERCACHE_H_
+#define _CEFFECTPARAMETERCACHE_H_
+
+#include <d3dx9.h>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "../../Core/Header/Void.h"
+#include "../../Core/Header/CHashedString.h"
+#include "../../ResourceManagement/Header/CResourceManager.h"
+
+using namespace Void::Core;
+using namespace Void::ResourceManagement;
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//a D3DXHANDLE, which is a const char*: the setters of CEffect take handles and names alike
+		typedef D3DXHANDLE EffectParameterHandle;
+
+		//slot of parameters that are not known to the cache, their uploads are never tracked
+		#define EFFECTPARAMETER_NO_SLOT		0xFFFFFFFF
+
+		//handle, or the name if the handle is NULL, use it inside the setter call so the name outlives it
+		#define EFFECT_PARAMETER(handle, name)	((handle) != NULL ? (handle) : (name).GetString().c_str())
+
+		//the D3DX effect behind a loaded CEffect, lets the cache register effects on first use
+		typedef ID3DXEffect* (*EffectSource)(const CEffect* const effect);
+
+		struct EffectParameter
+		{
+			EffectParameterHandle	Handle;
+
+			//index into the uploaded versions of the effect
+			uint32			Slot;
+		};
+
+		typedef std::map<const CHashedString, EffectParameter>	EffectParameterMap;
+		typedef std::pair<const CHashedString, EffectParameter>	EffectParameterMapEnt;
+
+		class CEffectParameterCache
+		{
+		private:
+			struct EffectRecord
+			{
+				EffectParameterMap	Parameters;
+
+				//by slot, 0 until a tracked value was uploaded
+				std::vector<uint64>	UploadedVersions;
+
+				//unique across registrations, 0 is never handed out
+				uint32			Generation;
+			};
+
+			std::unordered_map<const CEffect*, EffectRecord>	m_Effects;
+			EffectSource						m_Source;
+			uint32							m_NextGeneration;
+
+			uint32							m_SentCnt;
+			uint32							m_SkippedCnt;
+
+		public:
+			CEffectParameterCache();
+			~CEffectParameterCache();
+
+			void Release();
+
+			//call when the effect was loaded, every top level parameter of d3dxEffect is resolved
+			//effects that never registered are registered through the source the first time they are looked up
+			bool RegisterEffect(const CEffect* const effect, ID3DXEffect* const d3dxEffect);
+
+			//registers names as the effect's parameters without resolving handles, the setters get the names
+			//uploads are tracked all the same, for effects without a D3DX effect behind them like test stand-ins
+			void RegisterEffect(const CEffect* const effect, const char* const* const names, const uint32 nameCnt);
+
+			inline void SetEffectSource(const EffectSource source)
+			{
+				m_Source = source;
+			}
+
+			inline EffectSource GetEffectSource() const
+			{
+				return m_Source;
+			}
+
+			//call before the effect is unloaded, a later effect at the same address must not see old handles
+			void UnregisterEffect(const CEffect* const effect);
+
+			//NULL for effects that are not registered and can not be, keep it while binding many parameters of one effect
+			const EffectParameterMap* GetParameters(const CEffect* const effect);
+
+			//NULL for unknown parameters
+			static inline const EffectParameter* FindParameter(const EffectParameterMap* const parameters, const CHashedString& name)
+			{
+				if(parameters == NULL)
+					return NULL;
+
+				EffectParameterMap::const_iterator iter = parameters->find(name);
+				return iter != parameters->end() ? &iter->second : NULL;
+			}
+
+			//NULL for unknown parameters, the setters take the name instead, see EFFECT_PARAMETER
+			static inline EffectParameterHandle GetHandle(const EffectParameterMap* const parameters, const CHashedString& name)
+			{
+				const EffectParameter* parameter = FindParameter(parameters, name);
+				return parameter != NULL ? parameter->Handle : NULL;
+			}
+
+			inline EffectParameterHandle GetHandle(const CEffect* const effect, const CHashedString& name)
+			{
+				return GetHandle(this->GetParameters(effect), name);
+			}
+
+			//generation of the effect's registration, 0 while it is not registered
+			inline uint32 GetGeneration(const CEffect* const effect) const
+			{
+				std::unordered_map<const CEffect*, EffectRecord>::const_iterator iter = m_Effects.find(effect);
+				return iter != m_Effects.end() ? iter->second.Generation : 0;
+			}
+
+			//indexed by EffectParameter::Slot, NULL for effects that never registered
+			uint64* GetUploadedVersions(const CEffect* const effect);
+
+			//call after setting tracked parameters behind the back of the cache, the next upload of each is sent
+			//setting a parameter with the CEffect setters directly is such a case, Begin and BeginPass are not
+			void InvalidateUploads(const CEffect* const effect);
+
+			//the same for a single parameter, NULL is ignored
+			void InvalidateUpload(const CEffect* const effect, const EffectParameter* const parameter);
+
+			inline void CountUploads(const uint32 sentCnt, const uint32 skippedCnt)
+			{
+				m_SentCnt		+= sentCnt;
+				m_SkippedCnt	+= skippedCnt;
+			}
+
+			inline void ResetUploadCounts()
+			{
+				m_SentCnt		= 0;
+				m_SkippedCnt	= 0;
+			}
+
+			inline uint32 GetSentCount() const
+			{
+				return m_SentCnt;
+			}
+
+			inline uint32 GetSkippedCount() const
+			{
+				return m_SkippedCnt;
+			}
+		};
+
+		//shared by everything that sets effect parameters, filled by whoever loads effects
+		extern CEffectParameterCache* EffectParameterCache;
+	};
+};
+
+#endif
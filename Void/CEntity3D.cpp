@@ -1,113 +1,191 @@
-#include "../Header/CEntity3D.h"
-
-namespace Void
-{
-	namespace Scene
-	{
-		CEntity3D::CEntity3D(const CHashedString& id) 
-			: Identifier(id), BoundingBox(new CBoundingBox())
-		{
-			this->WorldMatrix.Identity();
-			this->BoundingBox->SetMatrix(&this->WorldMatrix);
-		}
-	
-		CEntity3D::~CEntity3D()
-		{
-			SAFE_DELETE(this->BoundingBox);
-
-			ConstantMap::iterator iter = this->m_ConstantMap.begin();
-			while(iter != this->m_ConstantMap.end())
-			{
-				SAFE_DELETE(iter->second);
-				iter++;
-			}
-			this->m_ConstantMap.clear();
-		}
-	
-		void CEntity3D::Update(const float32 timeDelta)
-		{
-			LuaObject tmpObj = Lua->GetGlobalActorTable()[this->Identifier.GetString().c_str()];
-			if(tmpObj.IsTable())
-			{
-				LuaObject funcObj = tmpObj["OnUpdate"];
-				if(funcObj.IsFunction())
-				{
-					LuaFunction<void> func = funcObj;
-					try
-					{
-						func(timeDelta);
-					}
-					catch(LuaException ex)
-					{
-						DEBUG_MSG_VA("[CEntity3D::Update]", 
-							"Failed to execute ActorFuntion of: %s\nLuaFunction OnUpdate has caused the exception\n'%s'", 
-							this->Identifier.GetString().c_str(), ex.GetErrorMessage());
-					}
-				}
-			}
-		}
-	
-		bool CEntity3D::SetShaderConstant(ShaderConstant* constant)
-		{
-			ConstantMap::iterator iter = this->m_ConstantMap.find(constant->Identifier);
-			if(iter == this->m_ConstantMap.end())
-			{
-				ConstantMapEnt entry = ConstantMapEnt(constant->Identifier, constant);
-				ConstantMapIRes iRes = this->m_ConstantMap.insert(entry);
-				return iRes.second;
-			}
-			else
-			{
-				SAFE_DELETE(iter->second)
-				iter->second = constant;
-			}
-			return true;
-		}
-	
-		void CEntity3D::SetShaderConstants(CEffect* const effect, const uint16 pass)
-		{
-			ConstantMap::iterator iter = this->m_ConstantMap.begin();
-			while(iter != this->m_ConstantMap.end())
-			{
-				//skip this constant if its not the right pass
-				if(iter->second->Pass != pass)
-				{
-					iter++;
-					continue;
-				}
-
-				switch(iter->second->Type)
-				{
-				case ShaderConstant::CONSTANT_TYPE_BOOL:
-					effect->SetBool(iter->second->Identifier.GetString().c_str(), *((bool*)iter->second->Value));
-					break;
-				case ShaderConstant::CONSTANT_TYPE_INT:
-					effect->SetInt(iter->second->Identifier.GetString().c_str(), *((int32*)iter->second->Value));
-					break;
-				case ShaderConstant::CONSTANT_TYPE_FLOAT:
-					effect->SetFloat(iter->second->Identifier.GetString().c_str(), *((float32*)iter->second->Value));
-					break;
-				case ShaderConstant::CONSTANT_TYPE_VECTOR3:
-					effect->SetVector(iter->second->Identifier.GetString().c_str(), (CVector3*)iter->second->Value);
-					break;
-				case ShaderConstant::CONSTANT_TYPE_VECTOR4:
-					effect->SetVector(iter->second->Identifier.GetString().c_str(), (CVector4*)iter->second->Value);
-					break;
-				case ShaderConstant::CONSTANT_TYPE_VECTOR4_ARRAY:
-					effect->SetVectorArray(iter->second->Identifier.GetString().c_str(), (CVector4*)iter->second->Value, iter->second->ArraySize);
-					break;
-				case ShaderConstant::CONSTANT_TYPE_MATRIX4X4:
-					effect->SetMatrix(iter->second->Identifier.GetString().c_str(), (CMatrix4x4*)iter->second->Value);
-					break;
-				case ShaderConstant::CONSTANT_TYPE_MATRIX4X4_ARRAY:
-					effect->SetMatrixArray(iter->second->Identifier.GetString().c_str(), (CMatrix4x4*)iter->second->Value, iter->second->ArraySize);
-					break;
-				default:
-					DEBUG_MSG("ShaderConstantType unknown. [CEntity3D::SetShaderConstants]");
-					break;
-				}
-				iter++;
-			}
-		}		
-	};
+#include "../Header/CEntity3D.h"
+
+namespace Void
+{
+	namespace Scene
+	{
+		static void DeleteShaderConstant(ShaderConstant* constant)
+		{
+			if(ShaderConstantPool->Owns(constant))
+				ShaderConstantPool->Delete(constant);
+			else
+				SAFE_DELETE(constant);
+		}
+
+		//every entity lives in Entity3DStore, running out of slots fails construction like the pools do
+		static CMatrix4x4& GetSlotWorldMatrix(const EntityHandle handle)
+		{
+			if(handle == EntityHandle_Invalid)
+			{
+				DEBUG_MSG("Allocating Entity Slot Failed. [CEntity3D::CEntity3D]");
+				throw std::bad_alloc();
+			}
+
+			return Entity3DStore->GetWorldMatrix(handle);
+		}
+
+		CEntity3D::CEntity3D(const CHashedString& id) 
+			: m_LuaOnUpdate(NULL), m_LuaGeneration(0), m_LuaSlot(ENTITYLUA_NO_SLOT), m_LuaQueueSlot(ENTITYLUA_NO_SLOT), m_Handle(Entity3DStore->Allocate(this)), Identifier(id), 
+			  WorldMatrix(GetSlotWorldMatrix(m_Handle)), BoundingBox(BoundingBoxPool->New())
+		{
+			//the destructor does not run for a throwing constructor, the slot is given back here
+			if(this->BoundingBox == NULL)
+			{
+				DEBUG_MSG("Allocating BoundingBox Failed. [CEntity3D::CEntity3D]");
+				Entity3DStore->Free(this->m_Handle);
+				throw std::bad_alloc();
+			}
+
+			this->BoundingBox->SetMatrix(&this->WorldMatrix);
+		}
+	
+		CEntity3D::~CEntity3D()
+		{
+			for(uint32 pass = 0; pass < this->m_OwnedConstants.size(); ++pass)
+			{
+				for(uint32 i = 0; i < this->m_OwnedConstants[pass].size(); ++i)
+					DeleteShaderConstant(this->m_OwnedConstants[pass][i].Constant);
+			}
+			this->m_OwnedConstants.clear();
+
+			BoundingBoxPool->Delete(this->BoundingBox);
+			this->BoundingBox = NULL;
+
+			EntityLuaDispatcher->Untrack(this);
+			this->ReleaseLuaHandler();
+			Entity3DStore->Free(this->m_Handle);
+		}
+
+		void CEntity3D::SyncLocalBounds()
+		{
+			Entity3DStore->SetLocalBounds(this->m_Handle, this->BoundingBox->GetMin(), this->BoundingBox->GetMax());
+		}
+
+		void* CEntity3D::operator new(size_t size)
+		{
+			return EntityPools->Allocate(size);
+		}
+
+		void CEntity3D::operator delete(void* object, size_t size)
+		{
+			if(object != NULL)
+				EntityPools->Free(object, size);
+		}
+	
+		void CEntity3D::Update(const float32 timeDelta)
+		{
+			if(!this->ResolveLuaHandler())
+				return;
+
+			if(EntityLuaDispatcher->IsBatched())
+			{
+				EntityLuaDispatcher->Queue(this, timeDelta);
+				return;
+			}
+
+			try
+			{
+				(*this->m_LuaOnUpdate)(timeDelta);
+			}
+			catch(LuaException& ex)
+			{
+				DEBUG_MSG_VA("[CEntity3D::Update]", 
+					"Failed to execute ActorFuntion of: %s\nLuaFunction OnUpdate has caused the exception\n'%s'", 
+					this->Identifier.GetString().c_str(), ex.GetErrorMessage());
+			}
+		}
+
+		bool CEntity3D::ResolveLuaHandler()
+		{
+			uint32 generation = EntityLuaDispatcher->GetActorGeneration();
+			if(this->m_LuaGeneration == generation)
+				return this->m_LuaOnUpdate != NULL;
+
+			this->m_LuaGeneration = generation;
+			this->ReleaseLuaHandler();
+
+			this->m_LuaActor = EntityLuaDispatcher->FindActor(this->Identifier.GetString().c_str());
+			if(!this->m_LuaActor.IsTable())
+			{
+				this->m_LuaActor = LuaObject();
+				return false;
+			}
+
+			//the references are dropped by EntityLuaDispatcher::Release before the state closes
+			EntityLuaDispatcher->Track(this);
+
+			LuaObject funcObj = this->m_LuaActor["OnUpdate"];
+			if(!funcObj.IsFunction())
+				return false;
+
+			this->m_LuaOnUpdate = new LuaFunction<void>(funcObj);
+			return true;
+		}
+
+		void CEntity3D::ReleaseLuaHandler()
+		{
+			SAFE_DELETE(this->m_LuaOnUpdate);
+			this->m_LuaActor = LuaObject();
+		}
+	
+		bool CEntity3D::SetShaderConstant(ShaderConstant* constant)
+		{
+			if(constant == NULL)
+				return false;
+
+			ShaderConstantHandle handle = this->m_Constants.Set(*constant);
+			if(handle == ShaderConstantHandle_Invalid)
+				return false;
+
+			//the old bucket may be another pass, the constant is filed again under its current one
+			ShaderConstant* replaced = this->TakeOwnedConstant(handle);
+			if(replaced != NULL && replaced != constant)
+				DeleteShaderConstant(replaced);
+
+			if(this->m_OwnedConstants.size() <= constant->Pass)
+				this->m_OwnedConstants.resize(constant->Pass + 1);
+
+			OwnedShaderConstant owned;
+			owned.Constant	= constant;
+			owned.Handle	= handle;
+			this->m_OwnedConstants[constant->Pass].push_back(owned);
+			return true;
+		}
+
+		ShaderConstantHandle CEntity3D::SetShaderConstant(const ShaderConstant& constant)
+		{
+			ShaderConstantHandle handle = this->m_Constants.Set(constant);
+			if(handle != ShaderConstantHandle_Invalid)
+			{
+				ShaderConstant* replaced = this->TakeOwnedConstant(handle);
+				if(replaced != NULL)
+					DeleteShaderConstant(replaced);
+			}
+			return handle;
+		}
+
+		ShaderConstant* CEntity3D::TakeOwnedConstant(const ShaderConstantHandle handle)
+		{
+			for(uint32 pass = 0; pass < this->m_OwnedConstants.size(); ++pass)
+			{
+				std::vector<OwnedShaderConstant>& owned = this->m_OwnedConstants[pass];
+				for(uint32 i = 0; i < owned.size(); ++i)
+				{
+					if(owned[i].Handle != handle)
+						continue;
+
+					ShaderConstant* constant = owned[i].Constant;
+					owned[i] = owned.back();
+					owned.pop_back();
+					return constant;
+				}
+			}
+			return NULL;
+		}
+	
+		void CEntity3D::SetShaderConstants(CEffect* const effect, const uint16 pass)
+		{
+			this->BindShaderConstants(effect, effect, pass);
+		}		
+	};
 };
\ No newline at end of file
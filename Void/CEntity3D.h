@@ -1,76 +1,179 @@
-/*
-	Base 3D scene entity class (abstract).
-*/
-
-#ifndef _CENITITY3D_H_
-#define _CENITITY3D_H_
-
-#include <map>
-#include "../../Core/Header/Void.h"
-#include "../../Core/Header/CHashedString.h"
-#include "../../Core/Header/CLua.h"
-#include "../../Renderer/Header/CRenderer.h"
-#include "../../ResourceManagement/Header/CResourceManager.h"
-#include "../../ResourceManagement/Header/IShaderConstantSetter.h"
-#include "../../Math/Header/CBoundingBox.h"
-#include "../../Math/Header/CMatrix4x4.h"
-#include "SceneTypes.h"
-
-using namespace Void::Core;
-using namespace Void::Renderer;
-using namespace Void::ResourceManagement;
-using namespace Void::Math;
-using namespace LuaPlus;
-
-namespace Void
-{
-	namespace Scene
-	{
-		enum Entity3DType
-		{ 
-			ENTITY3D_MODEL = 0x0,
-			ENTITY3D_PARTICLE_SYSTEM,
-			ENTITY3D_BILLBOARD
-		};
-	
-		typedef std::map<const CHashedString, ShaderConstant*>	ConstantMap;
-		typedef std::pair<const CHashedString, ShaderConstant*>	ConstantMapEnt;
-		typedef std::pair<ConstantMap::iterator, bool>		ConstantMapIRes;
-
-		class CEntity3D : public IShaderConstantSetter
-		{
-		private:
-			ConstantMap			m_ConstantMap;
-
-		public:
-			CHashedString			Identifier;
-
-			//global world transformation (determined by scene graph)
-			CMatrix4x4			WorldMatrix;
-
-			//global object oriented bounding-box
-			CBoundingBox*			BoundingBox;
-
-		public:
-			explicit CEntity3D(const CHashedString& id);
-			virtual ~CEntity3D();
-			
-			virtual void Update(const float32 timeDelta);
-			virtual void PreRender(CRenderer* const renderer) = 0;
-
-			virtual void LoadResources(CResourceManager* const resManager) = 0;
-			virtual void UnloadResources(CResourceManager* const resManager) = 0;
-
-			virtual void Rebuild() = 0;
-
-			bool SetShaderConstant(ShaderConstant* constant);
-
-			virtual Entity3DType GetEntityType() const = 0;
-
-			//from IShaderConstantSetter
-			void SetShaderConstants(CEffect* const effect, const uint16 pass);
-		};
-	};
-};
-
-#endif
+/*
+	Base 3D scene entity class (abstract).
+*/
+
+#ifndef _CENITITY3D_H_
+#define _CENITITY3D_H_
+
+#include "../../Core/Header/Void.h"
+#include "../../Core/Header/CHashedString.h"
+#include "../../Core/Header/CLua.h"
+#include "../../Renderer/Header/CRenderer.h"
+#include "../../Renderer/Header/CEffectParameterCache.h"
+#include "../../ResourceManagement/Header/CResourceManager.h"
+#include "../../ResourceManagement/Header/IShaderConstantSetter.h"
+#include "../../Math/Header/CBoundingBox.h"
+#include "../../Math/Header/CMatrix4x4.h"
+#include "SceneTypes.h"
+#include "CEntityConstantStore.h"
+#include "CEntityLuaDispatcher.h"
+#include "CEntity3DStore.h"
+#include "CEntityPools.h"
+
+using namespace Void::Core;
+using namespace Void::Renderer;
+using namespace Void::ResourceManagement;
+using namespace Void::Math;
+using namespace LuaPlus;
+
+namespace Void
+{
+	namespace Scene
+	{
+		enum Entity3DType
+		{ 
+			ENTITY3D_MODEL = 0x0,
+			ENTITY3D_PARTICLE_SYSTEM,
+			ENTITY3D_BILLBOARD
+		};
+	
+		//a constant handed over by pointer, its Value is read again at every bind of its pass
+		struct OwnedShaderConstant
+		{
+			ShaderConstant*			Constant;
+			ShaderConstantHandle		Handle;
+		};
+
+		class CEntity3D : public IShaderConstantSetter
+		{
+			//keeps the slots below and drops the Lua references when the state closes
+			friend class CEntityLuaDispatcher;
+
+		private:
+			CEntityConstantStore		m_Constants;
+
+			//bucketed by the pass they had when handed over, a bind only looks at its own
+			std::vector<std::vector<OwnedShaderConstant> >	m_OwnedConstants;
+
+			//OnUpdate of the actor, resolved again once the actor generation of EntityLuaDispatcher moved
+			LuaObject			m_LuaActor;
+			LuaFunction<void>*		m_LuaOnUpdate;
+			uint32				m_LuaGeneration;
+
+			//in the tracked entities and the queue of EntityLuaDispatcher, ENTITYLUA_NO_SLOT if not
+			uint32				m_LuaSlot;
+			uint32				m_LuaQueueSlot;
+
+			//slot in Entity3DStore holding matrix and bounds, always valid, construction throws std::bad_alloc without one
+			EntityHandle			m_Handle;
+
+		private:
+			//removes the owned constant stored under handle from its bucket, NULL if there is none
+			ShaderConstant* TakeOwnedConstant(const ShaderConstantHandle handle);
+
+			void ReleaseLuaHandler();
+
+		public:
+			CHashedString			Identifier;
+
+			//global world transformation (determined by scene graph), lives in Entity3DStore
+			CMatrix4x4&			WorldMatrix;
+
+			//global object oriented bounding-box, owned by BoundingBoxPool, construction throws std::bad_alloc without one
+			CBoundingBox*			BoundingBox;
+
+		public:
+			explicit CEntity3D(const CHashedString& id);
+			virtual ~CEntity3D();
+
+			//every entity type comes from the size class pools of EntityPools
+			static void* operator new(size_t size);
+			static void operator delete(void* object, size_t size);
+			
+			//calls the OnUpdate handler of the actor, or queues it when EntityLuaDispatcher is batched
+			virtual void Update(const float32 timeDelta);
+
+			//false for entities without handler, Lua is only touched after the actor table changed
+			bool ResolveLuaHandler();
+
+			inline LuaObject& GetLuaActor()
+			{
+				return m_LuaActor;
+			}
+
+			inline EntityHandle GetHandle() const
+			{
+				return m_Handle;
+			}
+
+			//object space box, the world space box follows with the next recompute of Entity3DStore
+			//until one is set the box is unbounded (ENTITYSTORE_UNBOUNDED), the entity passes every cull
+			inline void SetLocalBounds(const CVector3& min, const CVector3& max)
+			{
+				Entity3DStore->SetLocalBounds(m_Handle, min, max);
+			}
+
+			//copies the object space extents of BoundingBox, nothing does that on its own
+			//entity types call it at the end of Rebuild and LoadResources, else they stay unbounded
+			void SyncLocalBounds();
+
+			//as of the last recompute of Entity3DStore
+			inline void GetWorldBounds(CVector3& min, CVector3& max) const
+			{
+				Entity3DStore->GetWorldBounds(m_Handle, min, max);
+			}
+
+			virtual void PreRender(CRenderer* const renderer) = 0;
+
+			virtual void LoadResources(CResourceManager* const resManager) = 0;
+			virtual void UnloadResources(CResourceManager* const resManager) = 0;
+
+			virtual void Rebuild() = 0;
+
+			//takes ownership of constant until it is replaced or the entity dies, writes to its Value
+			//show up at the next bind, a replaced constant is deleted or given back to ShaderConstantPool
+			//its Pass is read here, hand the constant over again to move it to another pass
+			bool SetShaderConstant(ShaderConstant* constant);
+
+			//copies the value, constant may live on the stack, replaces an owned constant of the same identifier
+			ShaderConstantHandle SetShaderConstant(const ShaderConstant& constant);
+
+			//overwrites the value in place, no lookup by identifier
+			//owned constants are read again at every bind, write their Value instead
+			inline bool UpdateShaderConstant(const ShaderConstantHandle handle, const void* const value)
+			{
+				return m_Constants.Update(handle, value);
+			}
+
+			inline ShaderConstantHandle GetShaderConstantHandle(const CHashedString& identifier) const
+			{
+				return m_Constants.Find(identifier);
+			}
+
+			virtual Entity3DType GetEntityType() const = 0;
+
+			//from IShaderConstantSetter
+			void SetShaderConstants(CEffect* const effect, const uint16 pass);
+
+			//SetShaderConstants through any target with the setters of CEffect, see CEntityConstantStore::BindTarget
+			template<typename Target>
+			void BindShaderConstants(Target* const target, const CEffect* const effect, const uint16 pass);
+		};
+
+		template<typename Target>
+		void CEntity3D::BindShaderConstants(Target* const target, const CEffect* const effect, const uint16 pass)
+		{
+			//an unchanged value keeps its version and is still skipped
+			if(pass < this->m_OwnedConstants.size())
+			{
+				const std::vector<OwnedShaderConstant>& owned = this->m_OwnedConstants[pass];
+				for(uint32 i = 0; i < owned.size(); ++i)
+					this->m_Constants.Update(owned[i].Handle, owned[i].Constant->Value);
+			}
+
+			this->m_Constants.BindTarget(target, effect, pass);
+		}
+	};
+};
+
+#endif
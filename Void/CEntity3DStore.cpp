@@ -0,0 +1,271 @@
+#include "../Header/CEntity3DStore.h"
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+namespace Void
+{
+	namespace Scene
+	{
+		//the sweep loads matrix rows as aligned vectors, D3DX layout
+		static_assert(sizeof(CMatrix4x4) == 16 * sizeof(float32), "CMatrix4x4 has to be 16 packed floats");
+
+		//generations wrap within the bits left above the index
+		#define ENTITYHANDLE_GENERATION_MASK	((1 << (32 - ENTITYHANDLE_INDEX_BITS)) - 1)
+
+		static CEntity3DStore s_Entity3DStore;
+		CEntity3DStore* Entity3DStore = &s_Entity3DStore;
+
+		CEntity3DStore::CEntity3DStore()
+			:	m_ChunkCnt(0),
+				m_SlotCnt(0),
+				m_AliveCnt(0)
+		{
+			memset(m_Chunks, 0, sizeof(m_Chunks));
+		}
+
+		CEntity3DStore::~CEntity3DStore()
+		{
+			this->Release();
+		}
+
+		void CEntity3DStore::Release()
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+
+			uint32 chunkCnt = m_ChunkCnt.load(std::memory_order_relaxed);
+			m_ChunkCnt.store(0, std::memory_order_release);
+			m_SlotCnt.store(0, std::memory_order_release);
+			for(uint32 i = 0; i < chunkCnt; ++i)
+			{
+				_mm_free(m_Chunks[i]);
+				m_Chunks[i] = NULL;
+			}
+
+			m_FreeSlots.clear();
+			m_AliveCnt = 0;
+		}
+
+		void CEntity3DStore::ResetSlot(EntityChunk* const chunk, const uint32 slot)
+		{
+			chunk->Owners[slot] = NULL;
+			chunk->WorldMatrices[slot].Identity();
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				chunk->LocalMin[axis][slot] = ENTITYSTORE_UNBOUNDED;
+				chunk->LocalMax[axis][slot] = -ENTITYSTORE_UNBOUNDED;
+				chunk->WorldMin[axis][slot] = ENTITYSTORE_UNBOUNDED;
+				chunk->WorldMax[axis][slot] = -ENTITYSTORE_UNBOUNDED;
+			}
+		}
+
+		EntityHandle CEntity3DStore::Allocate(CEntity3D* const owner)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+
+			uint32 index = 0;
+			if(!m_FreeSlots.empty())
+			{
+				index = m_FreeSlots.back();
+				m_FreeSlots.pop_back();
+			}
+			else
+			{
+				uint32 slotCnt = m_SlotCnt.load(std::memory_order_relaxed);
+				if(slotCnt >= ENTITYHANDLE_INDEX_MASK)
+				{
+					DEBUG_MSG("Entity limit reached. [CEntity3DStore::Allocate]");
+					return EntityHandle_Invalid;
+				}
+
+				if((slotCnt & (ENTITYSTORE_CHUNK_SIZE - 1)) == 0)
+				{
+					EntityChunk* chunk = (EntityChunk*)_mm_malloc(sizeof(EntityChunk), 16);
+					if(chunk == NULL)
+					{
+						DEBUG_MSG("Chunk allocation Failed. [CEntity3DStore::Allocate]");
+						return EntityHandle_Invalid;
+					}
+
+					for(uint32 i = 0; i < ENTITYSTORE_CHUNK_SIZE; ++i)
+					{
+						this->ResetSlot(chunk, i);
+						chunk->Generations[i] = 0;
+					}
+					uint32 chunkCnt = m_ChunkCnt.load(std::memory_order_relaxed);
+					m_Chunks[chunkCnt] = chunk;
+					m_ChunkCnt.store(chunkCnt + 1, std::memory_order_release);
+				}
+				index = slotCnt;
+			}
+
+			EntityChunk* chunk = m_Chunks[index >> ENTITYSTORE_CHUNK_SHIFT];
+			uint32 slot = index & (ENTITYSTORE_CHUNK_SIZE - 1);
+			chunk->Owners[slot] = owner;
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				chunk->LocalMin[axis][slot] = -ENTITYSTORE_UNBOUNDED;
+				chunk->LocalMax[axis][slot] = ENTITYSTORE_UNBOUNDED;
+				chunk->WorldMin[axis][slot] = -ENTITYSTORE_UNBOUNDED;
+				chunk->WorldMax[axis][slot] = ENTITYSTORE_UNBOUNDED;
+			}
+
+			//the slot is set up before IsValid on another thread can count it
+			if(index + 1 > m_SlotCnt.load(std::memory_order_relaxed))
+				m_SlotCnt.store(index + 1, std::memory_order_release);
+
+			++m_AliveCnt;
+			return ((uint32)chunk->Generations[slot] << ENTITYHANDLE_INDEX_BITS) | (index + 1);
+		}
+
+		void CEntity3DStore::Free(const EntityHandle handle)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+
+			if(!this->IsValid(handle))
+			{
+				DEBUG_MSG("Invalid handle. [CEntity3DStore::Free]");
+				return;
+			}
+
+			EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+			this->ResetSlot(chunk, slot);
+			chunk->Generations[slot] = (chunk->Generations[slot] + 1) & ENTITYHANDLE_GENERATION_MASK;
+
+			m_FreeSlots.push_back((handle & ENTITYHANDLE_INDEX_MASK) - 1);
+			--m_AliveCnt;
+		}
+
+		bool CEntity3DStore::IsValid(const EntityHandle handle) const
+		{
+			uint32 index = handle & ENTITYHANDLE_INDEX_MASK;
+			if(index == 0 || index > m_SlotCnt.load(std::memory_order_acquire))
+				return false;
+
+			const EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+			return chunk->Owners[slot] != NULL && chunk->Generations[slot] == (handle >> ENTITYHANDLE_INDEX_BITS);
+		}
+
+		void CEntity3DStore::SetLocalBounds(const EntityHandle handle, const CVector3& min, const CVector3& max)
+		{
+			EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+			chunk->LocalMin[0][slot] = min.X;
+			chunk->LocalMin[1][slot] = min.Y;
+			chunk->LocalMin[2][slot] = min.Z;
+			chunk->LocalMax[0][slot] = max.X;
+			chunk->LocalMax[1][slot] = max.Y;
+			chunk->LocalMax[2][slot] = max.Z;
+		}
+
+		void CEntity3DStore::GetLocalBounds(const EntityHandle handle, CVector3& min, CVector3& max) const
+		{
+			const EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+			min = CVector3(chunk->LocalMin[0][slot], chunk->LocalMin[1][slot], chunk->LocalMin[2][slot]);
+			max = CVector3(chunk->LocalMax[0][slot], chunk->LocalMax[1][slot], chunk->LocalMax[2][slot]);
+		}
+
+		void CEntity3DStore::GetWorldBounds(const EntityHandle handle, CVector3& min, CVector3& max) const
+		{
+			const EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+			min = CVector3(chunk->WorldMin[0][slot], chunk->WorldMin[1][slot], chunk->WorldMin[2][slot]);
+			max = CVector3(chunk->WorldMax[0][slot], chunk->WorldMax[1][slot], chunk->WorldMax[2][slot]);
+		}
+
+		void CEntity3DStore::RecomputeWorldBounds(const EntityHandle handle)
+		{
+			EntityChunk* chunk = this->GetChunk(handle);
+			uint32 slot = GetSlot(handle);
+
+			//center goes through the whole matrix, the extent through its absolute 3x3 (row vectors)
+			const float32* m = (const float32*)&chunk->WorldMatrices[slot];
+			float32 center[3];
+			float32 extent[3];
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				center[axis] = (chunk->LocalMin[axis][slot] + chunk->LocalMax[axis][slot]) * 0.5f;
+				extent[axis] = (chunk->LocalMax[axis][slot] - chunk->LocalMin[axis][slot]) * 0.5f;
+			}
+
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				float32 worldCenter = (center[0] * m[axis] + center[1] * m[4 + axis]) + (center[2] * m[8 + axis] + m[12 + axis]);
+				float32 worldExtent = extent[0] * fabsf(m[axis]) + extent[1] * fabsf(m[4 + axis]) + extent[2] * fabsf(m[8 + axis]);
+				chunk->WorldMin[axis][slot] = worldCenter - worldExtent;
+				chunk->WorldMax[axis][slot] = worldCenter + worldExtent;
+			}
+		}
+
+		void CEntity3DStore::RecomputeWorldBounds(const uint32 beginChunk, const uint32 endChunk)
+		{
+			const __m128 half		= _mm_set1_ps(0.5f);
+			const __m128 absMask	= _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+			for(uint32 c = beginChunk; c < endChunk; ++c)
+			{
+				EntityChunk* chunk = m_Chunks[c];
+
+				//free slots are swept as well, their identity matrix keeps the inverted box inverted
+				for(uint32 base = 0; base < ENTITYSTORE_CHUNK_SIZE; base += 4)
+				{
+					__m128 minX = _mm_load_ps(&chunk->LocalMin[0][base]);
+					__m128 minY = _mm_load_ps(&chunk->LocalMin[1][base]);
+					__m128 minZ = _mm_load_ps(&chunk->LocalMin[2][base]);
+					__m128 maxX = _mm_load_ps(&chunk->LocalMax[0][base]);
+					__m128 maxY = _mm_load_ps(&chunk->LocalMax[1][base]);
+					__m128 maxZ = _mm_load_ps(&chunk->LocalMax[2][base]);
+
+					//four entities per component, transposed to one [x, y, z, 0] per entity
+					__m128 center[4] = {	_mm_mul_ps(_mm_add_ps(minX, maxX), half),
+											_mm_mul_ps(_mm_add_ps(minY, maxY), half),
+											_mm_mul_ps(_mm_add_ps(minZ, maxZ), half),
+											_mm_setzero_ps() };
+					__m128 extent[4] = {	_mm_mul_ps(_mm_sub_ps(maxX, minX), half),
+											_mm_mul_ps(_mm_sub_ps(maxY, minY), half),
+											_mm_mul_ps(_mm_sub_ps(maxZ, minZ), half),
+											_mm_setzero_ps() };
+					_MM_TRANSPOSE4_PS(center[0], center[1], center[2], center[3]);
+					_MM_TRANSPOSE4_PS(extent[0], extent[1], extent[2], extent[3]);
+
+					__m128 worldMin[4];
+					__m128 worldMax[4];
+					for(uint32 i = 0; i < 4; ++i)
+					{
+						const float32* m = (const float32*)&chunk->WorldMatrices[base + i];
+						__m128 row0 = _mm_load_ps(m);
+						__m128 row1 = _mm_load_ps(m + 4);
+						__m128 row2 = _mm_load_ps(m + 8);
+						__m128 row3 = _mm_load_ps(m + 12);
+
+						__m128 c = _mm_add_ps(_mm_add_ps(	_mm_mul_ps(_mm_shuffle_ps(center[i], center[i], _MM_SHUFFLE(0,0,0,0)), row0),
+															_mm_mul_ps(_mm_shuffle_ps(center[i], center[i], _MM_SHUFFLE(1,1,1,1)), row1)),
+											  _mm_add_ps(	_mm_mul_ps(_mm_shuffle_ps(center[i], center[i], _MM_SHUFFLE(2,2,2,2)), row2), row3));
+						__m128 e = _mm_add_ps(_mm_add_ps(	_mm_mul_ps(_mm_shuffle_ps(extent[i], extent[i], _MM_SHUFFLE(0,0,0,0)), _mm_and_ps(row0, absMask)),
+															_mm_mul_ps(_mm_shuffle_ps(extent[i], extent[i], _MM_SHUFFLE(1,1,1,1)), _mm_and_ps(row1, absMask))),
+															_mm_mul_ps(_mm_shuffle_ps(extent[i], extent[i], _MM_SHUFFLE(2,2,2,2)), _mm_and_ps(row2, absMask)));
+						worldMin[i] = _mm_sub_ps(c, e);
+						worldMax[i] = _mm_add_ps(c, e);
+					}
+
+					//back to one vector per component
+					_MM_TRANSPOSE4_PS(worldMin[0], worldMin[1], worldMin[2], worldMin[3]);
+					_MM_TRANSPOSE4_PS(worldMax[0], worldMax[1], worldMax[2], worldMax[3]);
+					for(uint32 axis = 0; axis < 3; ++axis)
+					{
+						_mm_store_ps(&chunk->WorldMin[axis][base], worldMin[axis]);
+						_mm_store_ps(&chunk->WorldMax[axis][base], worldMax[axis]);
+					}
+				}
+			}
+		}
+
+		void CEntity3DStore::RecomputeTask(void* const context, const uint32 beginChunk, const uint32 endChunk)
+		{
+			((CEntity3DStore*)context)->RecomputeWorldBounds(beginChunk, endChunk);
+		}
+	};
+};
\ No newline at end of file
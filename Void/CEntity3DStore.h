@@ -0,0 +1,158 @@
+/*
+	World matrices and axis aligned boxes of all scene entities,
+	kept in chunks of structure-of-arrays. Matrices and box
+	components are 16 byte aligned and contiguous per chunk, the
+	world space boxes of every entity are recomputed in one SSE
+	sweep. Chunks never move, so a slot keeps its address for as
+	long as its handle is alive. The chunk table has a fixed size,
+	readers on other threads never see it reallocate.
+*/
+
+#ifndef _CENTITY3DSTORE_H_
+#define _CENTITY3DSTORE_H_
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "../../Core/Header/Void.h"
+#include "../../Math/Header/CMatrix4x4.h"
+#include "../../Math/Header/CVector3.h"
+
+using namespace Void::Core;
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Scene
+	{
+		class CEntity3D;
+
+		//slot index + 1 in the low bits, generation of the slot above, 0 is never handed out
+		typedef uint32 EntityHandle;
+		#define EntityHandle_Invalid		0
+		#define ENTITYHANDLE_INDEX_BITS		20
+		#define ENTITYHANDLE_INDEX_MASK		((1 << ENTITYHANDLE_INDEX_BITS) - 1)
+
+		//slots per chunk, a multiple of 8 so chunks split evenly into SSE and AVX batches
+		#define ENTITYSTORE_CHUNK_SIZE		256
+		#define ENTITYSTORE_CHUNK_SHIFT		8
+
+		//enough chunks for every index a handle can hold
+		#define ENTITYSTORE_MAX_CHUNKS		((ENTITYHANDLE_INDEX_MASK >> ENTITYSTORE_CHUNK_SHIFT) + 1)
+
+		//local box of entities that never set one, they count as visible from everywhere
+		#define ENTITYSTORE_UNBOUNDED		1.0e30f
+
+		struct EntityChunk
+		{
+			CMatrix4x4	WorldMatrices[ENTITYSTORE_CHUNK_SIZE];
+
+			//per component [x, y, z], free slots hold an inverted box that overlaps nothing
+			float32		LocalMin[3][ENTITYSTORE_CHUNK_SIZE];
+			float32		LocalMax[3][ENTITYSTORE_CHUNK_SIZE];
+			float32		WorldMin[3][ENTITYSTORE_CHUNK_SIZE];
+			float32		WorldMax[3][ENTITYSTORE_CHUNK_SIZE];
+
+			CEntity3D*	Owners[ENTITYSTORE_CHUNK_SIZE];
+			uint16		Generations[ENTITYSTORE_CHUNK_SIZE];
+		};
+
+		class CEntity3DStore
+		{
+		private:
+			//entries below m_ChunkCnt are set before the count moves and never change until Release
+			EntityChunk*			m_Chunks[ENTITYSTORE_MAX_CHUNKS];
+			std::atomic<uint32>		m_ChunkCnt;
+			std::atomic<uint32>		m_SlotCnt;
+			std::vector<uint32>		m_FreeSlots;
+			uint32				m_AliveCnt;
+
+			//entities are created and destroyed from streaming threads as well, counts are published
+			//with release so the render thread may read chunks without taking the lock
+			std::mutex			m_Lock;
+
+		private:
+			void ResetSlot(EntityChunk* const chunk, const uint32 slot);
+
+			inline EntityChunk* GetChunk(const EntityHandle handle) const
+			{
+				return m_Chunks[((handle & ENTITYHANDLE_INDEX_MASK) - 1) >> ENTITYSTORE_CHUNK_SHIFT];
+			}
+
+			static inline uint32 GetSlot(const EntityHandle handle)
+			{
+				return ((handle & ENTITYHANDLE_INDEX_MASK) - 1) & (ENTITYSTORE_CHUNK_SIZE - 1);
+			}
+
+		public:
+			CEntity3DStore();
+			~CEntity3DStore();
+
+			//every handle has to be freed before
+			void Release();
+
+			//identity matrix and an unbounded local box, EntityHandle_Invalid once the index space is exhausted
+			EntityHandle Allocate(CEntity3D* const owner);
+			void Free(const EntityHandle handle);
+
+			//false for freed handles and handles of an older generation
+			bool IsValid(const EntityHandle handle) const;
+
+			inline CMatrix4x4& GetWorldMatrix(const EntityHandle handle)
+			{
+				return this->GetChunk(handle)->WorldMatrices[GetSlot(handle)];
+			}
+
+			inline CEntity3D* GetOwner(const EntityHandle handle) const
+			{
+				return this->GetChunk(handle)->Owners[GetSlot(handle)];
+			}
+
+			void SetLocalBounds(const EntityHandle handle, const CVector3& min, const CVector3& max);
+			void GetLocalBounds(const EntityHandle handle, CVector3& min, CVector3& max) const;
+
+			//as of the last recompute
+			void GetWorldBounds(const EntityHandle handle, CVector3& min, CVector3& max) const;
+
+			//single entity, scalar
+			void RecomputeWorldBounds(const EntityHandle handle);
+
+			//world boxes of chunks [begin, end), chunks can be handed to different threads
+			void RecomputeWorldBounds(const uint32 beginChunk, const uint32 endChunk);
+
+			inline void RecomputeAllWorldBounds()
+			{
+				this->RecomputeWorldBounds(0, this->GetChunkCount());
+			}
+
+			//matches ParallelTask of CWorkStealingPool, context is the store
+			static void RecomputeTask(void* const context, const uint32 beginChunk, const uint32 endChunk);
+
+			inline uint32 GetChunkCount() const
+			{
+				return m_ChunkCnt.load(std::memory_order_acquire);
+			}
+
+			inline EntityChunk* GetChunkByIndex(const uint32 chunk) const
+			{
+				return m_Chunks[chunk];
+			}
+
+			inline uint32 GetAliveCount() const
+			{
+				return m_AliveCnt;
+			}
+
+			//handle of the slot at index, whatever lives there
+			inline EntityHandle GetHandleAt(const uint32 chunk, const uint32 slot) const
+			{
+				return ((uint32)m_Chunks[chunk]->Generations[slot] << ENTITYHANDLE_INDEX_BITS) | ((chunk << ENTITYSTORE_CHUNK_SHIFT) + slot + 1);
+			}
+		};
+
+		//every CEntity3D lives in here
+		extern CEntity3DStore* Entity3DStore;
+	};
+};
+
+#endif
@@ -0,0 +1,595 @@
+#include "../Header/CEntityBVH.h"
+#include <math.h>
+
+namespace Void
+{
+	namespace Scene
+	{
+		//double, unbounded boxes would overflow float
+		static inline float64 SurfaceArea(const float32* const min, const float32* const max)
+		{
+			float64 dx = (float64)max[0] - min[0];
+			float64 dy = (float64)max[1] - min[1];
+			float64 dz = (float64)max[2] - min[2];
+			return 2.0 * (dx * dy + dy * dz + dz * dx);
+		}
+
+		static inline float64 UnionArea(const BVHNode& a, const BVHNode& b)
+		{
+			float32 min[3];
+			float32 max[3];
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				min[axis] = a.Min[axis] < b.Min[axis] ? a.Min[axis] : b.Min[axis];
+				max[axis] = a.Max[axis] > b.Max[axis] ? a.Max[axis] : b.Max[axis];
+			}
+			return SurfaceArea(min, max);
+		}
+
+		static inline void Combine(BVHNode& node, const BVHNode& a, const BVHNode& b)
+		{
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				node.Min[axis] = a.Min[axis] < b.Min[axis] ? a.Min[axis] : b.Min[axis];
+				node.Max[axis] = a.Max[axis] > b.Max[axis] ? a.Max[axis] : b.Max[axis];
+			}
+		}
+
+		static inline bool Contains(const BVHNode& node, const CVector3& min, const CVector3& max)
+		{
+			return	node.Min[0] <= min.X && node.Min[1] <= min.Y && node.Min[2] <= min.Z &&
+					node.Max[0] >= max.X && node.Max[1] >= max.Y && node.Max[2] >= max.Z;
+		}
+
+		static inline int32 MaxHeight(const int32 a, const int32 b)
+		{
+			return a > b ? a : b;
+		}
+
+		CEntityBVH::CEntityBVH()
+			:	m_Root(BVH_NULL_NODE),
+				m_FreeList(BVH_NULL_NODE),
+				m_LeafCnt(0),
+				m_DirtyCnt(0),
+				m_Margin(0.5f)
+		{
+		}
+
+		CEntityBVH::~CEntityBVH()
+		{
+			this->Release();
+		}
+
+		void CEntityBVH::Release()
+		{
+			std::vector<BVHNode>().swap(m_Nodes);
+			std::vector<int32>().swap(m_Leaves);
+			std::vector<int32>().swap(m_DirtyLeaves);
+			m_Root		= BVH_NULL_NODE;
+			m_FreeList	= BVH_NULL_NODE;
+			m_LeafCnt	= 0;
+			m_DirtyCnt	= 0;
+		}
+
+		int32 CEntityBVH::AllocateNode()
+		{
+			int32 node = m_FreeList;
+			if(node != BVH_NULL_NODE)
+			{
+				m_FreeList = m_Nodes[node].Parent;
+			}
+			else
+			{
+				node = m_Nodes.size();
+				m_Nodes.push_back(BVHNode());
+			}
+
+			BVHNode& allocated = m_Nodes[node];
+			allocated.Parent	= BVH_NULL_NODE;
+			allocated.Child[0]	= BVH_NULL_NODE;
+			allocated.Child[1]	= BVH_NULL_NODE;
+			allocated.Height	= 0;
+			allocated.Handle	= EntityHandle_Invalid;
+			allocated.Dirty		= false;
+			return node;
+		}
+
+		void CEntityBVH::FreeNode(const int32 node)
+		{
+			m_Nodes[node].Parent	= m_FreeList;
+			m_Nodes[node].Height	= -1;
+			m_Nodes[node].Dirty		= false;
+			m_FreeList = node;
+		}
+
+		int32 CEntityBVH::FindLeaf(const EntityHandle handle) const
+		{
+			uint32 slot = GetSlotIndex(handle);
+			if(handle == EntityHandle_Invalid || slot >= m_Leaves.size())
+				return BVH_NULL_NODE;
+
+			int32 leaf = m_Leaves[slot];
+			return (leaf != BVH_NULL_NODE && m_Nodes[leaf].Handle == handle) ? leaf : BVH_NULL_NODE;
+		}
+
+		bool CEntityBVH::Insert(const EntityHandle handle, const CVector3& min, const CVector3& max)
+		{
+			if(handle == EntityHandle_Invalid || this->FindLeaf(handle) != BVH_NULL_NODE)
+			{
+				DEBUG_MSG("Handle invalid or already inserted. [CEntityBVH::Insert]");
+				return false;
+			}
+
+			//the entity of the slot died without Remove, its leaf would never be found again
+			uint32 slot = GetSlotIndex(handle);
+			if(slot < m_Leaves.size() && m_Leaves[slot] != BVH_NULL_NODE)
+				this->DestroyLeaf(m_Leaves[slot]);
+
+			int32 leaf = this->AllocateNode();
+			BVHNode& node = m_Nodes[leaf];
+			node.Handle	= handle;
+			node.Min[0]	= min.X - m_Margin;
+			node.Min[1]	= min.Y - m_Margin;
+			node.Min[2]	= min.Z - m_Margin;
+			node.Max[0]	= max.X + m_Margin;
+			node.Max[1]	= max.Y + m_Margin;
+			node.Max[2]	= max.Z + m_Margin;
+
+			if(slot >= m_Leaves.size())
+				m_Leaves.resize(slot + 1, BVH_NULL_NODE);
+			m_Leaves[slot] = leaf;
+
+			this->InsertLeaf(leaf);
+			++m_LeafCnt;
+			return true;
+		}
+
+		bool CEntityBVH::Remove(const EntityHandle handle)
+		{
+			int32 leaf = this->FindLeaf(handle);
+			if(leaf == BVH_NULL_NODE)
+				return false;
+
+			this->DestroyLeaf(leaf);
+			return true;
+		}
+
+		void CEntityBVH::DestroyLeaf(const int32 leaf)
+		{
+			if(m_Nodes[leaf].Dirty)
+				--m_DirtyCnt;
+
+			this->RemoveLeaf(leaf);
+			m_Leaves[GetSlotIndex(m_Nodes[leaf].Handle)] = BVH_NULL_NODE;
+			this->FreeNode(leaf);
+			--m_LeafCnt;
+		}
+
+		bool CEntityBVH::Move(const EntityHandle handle, const CVector3& min, const CVector3& max)
+		{
+			int32 leaf = this->FindLeaf(handle);
+			if(leaf == BVH_NULL_NODE)
+				return false;
+
+			BVHNode& node = m_Nodes[leaf];
+			if(Contains(node, min, max))
+				return false;
+
+			node.Min[0]	= min.X - m_Margin;
+			node.Min[1]	= min.Y - m_Margin;
+			node.Min[2]	= min.Z - m_Margin;
+			node.Max[0]	= max.X + m_Margin;
+			node.Max[1]	= max.Y + m_Margin;
+			node.Max[2]	= max.Z + m_Margin;
+
+			//queries stay exact right away, the position in the tree is fixed later
+			this->FixUpwards(node.Parent, false);
+			if(!node.Dirty)
+			{
+				node.Dirty = true;
+				++m_DirtyCnt;
+				m_DirtyLeaves.push_back(leaf);
+			}
+			return true;
+		}
+
+		uint32 CEntityBVH::Rebalance(const uint32 maxLeaves)
+		{
+			uint32 reinsertedCnt = 0;
+			while(!m_DirtyLeaves.empty() && reinsertedCnt < maxLeaves)
+			{
+				int32 leaf = m_DirtyLeaves.back();
+				m_DirtyLeaves.pop_back();
+
+				//removed or already handled since it was queued
+				if(!m_Nodes[leaf].Dirty)
+					continue;
+
+				m_Nodes[leaf].Dirty = false;
+				--m_DirtyCnt;
+				this->RemoveLeaf(leaf);
+				this->InsertLeaf(leaf);
+				++reinsertedCnt;
+			}
+			return m_DirtyCnt;
+		}
+
+		void CEntityBVH::InsertLeaf(const int32 leaf)
+		{
+			if(m_Root == BVH_NULL_NODE)
+			{
+				m_Root = leaf;
+				m_Nodes[leaf].Parent = BVH_NULL_NODE;
+				return;
+			}
+
+			//descend while pushing the leaf further down is cheaper than pairing it here
+			int32 index = m_Root;
+			while(!m_Nodes[index].IsLeaf())
+			{
+				const BVHNode& node		= m_Nodes[index];
+				const BVHNode& leafNode	= m_Nodes[leaf];
+
+				float64 area			= SurfaceArea(node.Min, node.Max);
+				float64 combinedArea	= UnionArea(node, leafNode);
+
+				//new parent here, plus the growth every ancestor below pays for the leaf
+				float64 cost			= 2.0 * combinedArea;
+				float64 inheritanceCost	= 2.0 * (combinedArea - area);
+
+				float64 childCost[2];
+				for(uint32 i = 0; i < 2; ++i)
+				{
+					const BVHNode& child = m_Nodes[node.Child[i]];
+					float64 childArea = UnionArea(child, leafNode);
+					childCost[i] = (child.IsLeaf() ? childArea : childArea - SurfaceArea(child.Min, child.Max)) + inheritanceCost;
+				}
+
+				if(cost < childCost[0] && cost < childCost[1])
+					break;
+
+				index = childCost[0] < childCost[1] ? node.Child[0] : node.Child[1];
+			}
+
+			int32 sibling = index;
+			int32 oldParent = m_Nodes[sibling].Parent;
+			int32 newParent = this->AllocateNode();
+
+			BVHNode& parent = m_Nodes[newParent];
+			parent.Parent	= oldParent;
+			parent.Child[0]	= sibling;
+			parent.Child[1]	= leaf;
+			parent.Height	= m_Nodes[sibling].Height + 1;
+			Combine(parent, m_Nodes[sibling], m_Nodes[leaf]);
+
+			if(oldParent != BVH_NULL_NODE)
+			{
+				BVHNode& grandParent = m_Nodes[oldParent];
+				grandParent.Child[grandParent.Child[0] == sibling ? 0 : 1] = newParent;
+			}
+			else
+			{
+				m_Root = newParent;
+			}
+
+			m_Nodes[sibling].Parent	= newParent;
+			m_Nodes[leaf].Parent	= newParent;
+
+			this->FixUpwards(m_Nodes[leaf].Parent, true);
+		}
+
+		void CEntityBVH::RemoveLeaf(const int32 leaf)
+		{
+			if(leaf == m_Root)
+			{
+				m_Root = BVH_NULL_NODE;
+				return;
+			}
+
+			//the sibling takes the place of the parent
+			int32 parent		= m_Nodes[leaf].Parent;
+			int32 grandParent	= m_Nodes[parent].Parent;
+			int32 sibling		= m_Nodes[parent].Child[m_Nodes[parent].Child[0] == leaf ? 1 : 0];
+
+			if(grandParent != BVH_NULL_NODE)
+			{
+				BVHNode& grandParentNode = m_Nodes[grandParent];
+				grandParentNode.Child[grandParentNode.Child[0] == parent ? 0 : 1] = sibling;
+				m_Nodes[sibling].Parent = grandParent;
+				this->FreeNode(parent);
+				this->FixUpwards(grandParent, true);
+			}
+			else
+			{
+				m_Root = sibling;
+				m_Nodes[sibling].Parent = BVH_NULL_NODE;
+				this->FreeNode(parent);
+			}
+			m_Nodes[leaf].Parent = BVH_NULL_NODE;
+		}
+
+		void CEntityBVH::FixUpwards(int32 node, const bool balance)
+		{
+			while(node != BVH_NULL_NODE)
+			{
+				if(balance)
+					node = this->Balance(node);
+
+				BVHNode& current = m_Nodes[node];
+				const BVHNode& child0 = m_Nodes[current.Child[0]];
+				const BVHNode& child1 = m_Nodes[current.Child[1]];
+				current.Height = 1 + MaxHeight(child0.Height, child1.Height);
+				Combine(current, child0, child1);
+				node = current.Parent;
+			}
+		}
+
+		int32 CEntityBVH::Balance(const int32 a)
+		{
+			BVHNode& nodeA = m_Nodes[a];
+			if(nodeA.IsLeaf() || nodeA.Height < 2)
+				return a;
+
+			int32 b = nodeA.Child[0];
+			int32 c = nodeA.Child[1];
+			int32 balance = m_Nodes[c].Height - m_Nodes[b].Height;
+			if(balance >= -1 && balance <= 1)
+				return a;
+
+			//the taller child up, its taller child stays with it, the shorter one goes down to a
+			int32 up		= balance > 1 ? c : b;
+			int32 other		= balance > 1 ? b : c;
+			int32 upSide	= balance > 1 ? 1 : 0;
+			BVHNode& nodeUp = m_Nodes[up];
+
+			int32 f = nodeUp.Child[0];
+			int32 g = nodeUp.Child[1];
+
+			nodeUp.Child[0]	= a;
+			nodeUp.Parent	= nodeA.Parent;
+			nodeA.Parent	= up;
+
+			if(nodeUp.Parent != BVH_NULL_NODE)
+			{
+				BVHNode& parent = m_Nodes[nodeUp.Parent];
+				parent.Child[parent.Child[0] == a ? 0 : 1] = up;
+			}
+			else
+			{
+				m_Root = up;
+			}
+
+			int32 keep	= m_Nodes[f].Height > m_Nodes[g].Height ? f : g;
+			int32 move	= keep == f ? g : f;
+			nodeUp.Child[1]		= keep;
+			nodeA.Child[upSide]	= move;
+			m_Nodes[move].Parent = a;
+
+			Combine(nodeA, m_Nodes[other], m_Nodes[move]);
+			Combine(nodeUp, nodeA, m_Nodes[keep]);
+			nodeA.Height	= 1 + MaxHeight(m_Nodes[other].Height, m_Nodes[move].Height);
+			nodeUp.Height	= 1 + MaxHeight(nodeA.Height, m_Nodes[keep].Height);
+			return up;
+		}
+
+		uint32 CEntityBVH::QueryFrustum(const FrustumPlanes& frustum, std::vector<EntityHandle>& handles) const
+		{
+			if(m_Root == BVH_NULL_NODE)
+				return 0;
+
+			uint32 foundCnt = 0;
+
+			//subtrees known to be completely inside are pushed as -(node + 2) and taken without tests
+			int32 stack[BVH_STACK_SIZE];
+			uint32 stackCnt = 0;
+			stack[stackCnt++] = m_Root;
+			while(stackCnt > 0)
+			{
+				int32 entry = stack[--stackCnt];
+				bool inside = entry < 0;
+				const BVHNode& node = m_Nodes[inside ? -entry - 2 : entry];
+
+				if(!inside)
+				{
+					bool outside = false;
+					inside = true;
+					for(uint32 p = 0; p < 6 && !outside; ++p)
+					{
+						const float32* plane = frustum.Planes[p];
+						float32 farDistance = plane[3];
+						float32 nearDistance = plane[3];
+						for(uint32 axis = 0; axis < 3; ++axis)
+						{
+							farDistance		+= plane[axis] * (plane[axis] >= 0.0f ? node.Max[axis] : node.Min[axis]);
+							nearDistance	+= plane[axis] * (plane[axis] >= 0.0f ? node.Min[axis] : node.Max[axis]);
+						}
+						outside	= farDistance < 0.0f;
+						inside	&= nearDistance >= 0.0f;
+					}
+
+					if(outside)
+						continue;
+				}
+
+				if(node.IsLeaf())
+				{
+					handles.push_back(node.Handle);
+					++foundCnt;
+					continue;
+				}
+
+				if(stackCnt + 2 > BVH_STACK_SIZE)
+				{
+					DEBUG_MSG("Stack overflow. [CEntityBVH::QueryFrustum]");
+					break;
+				}
+				stack[stackCnt++] = inside ? -node.Child[0] - 2 : node.Child[0];
+				stack[stackCnt++] = inside ? -node.Child[1] - 2 : node.Child[1];
+			}
+			return foundCnt;
+		}
+
+		uint32 CEntityBVH::QueryAABB(const CVector3& min, const CVector3& max, std::vector<EntityHandle>& handles) const
+		{
+			if(m_Root == BVH_NULL_NODE)
+				return 0;
+
+			uint32 foundCnt = 0;
+			int32 stack[BVH_STACK_SIZE];
+			uint32 stackCnt = 0;
+			stack[stackCnt++] = m_Root;
+			while(stackCnt > 0)
+			{
+				const BVHNode& node = m_Nodes[stack[--stackCnt]];
+				if(	node.Max[0] < min.X || node.Min[0] > max.X ||
+					node.Max[1] < min.Y || node.Min[1] > max.Y ||
+					node.Max[2] < min.Z || node.Min[2] > max.Z)
+					continue;
+
+				if(node.IsLeaf())
+				{
+					handles.push_back(node.Handle);
+					++foundCnt;
+					continue;
+				}
+
+				if(stackCnt + 2 > BVH_STACK_SIZE)
+				{
+					DEBUG_MSG("Stack overflow. [CEntityBVH::QueryAABB]");
+					break;
+				}
+				stack[stackCnt++] = node.Child[0];
+				stack[stackCnt++] = node.Child[1];
+			}
+			return foundCnt;
+		}
+
+		void CEntityBVH::QueryRay(const CVector3& origin, const CVector3& direction, const float32 maxDistance, BVHRayCallback callback, void* const context) const
+		{
+			if(m_Root == BVH_NULL_NODE)
+				return;
+
+			//slab test, a zero component gives infinities that still compare right
+			const float32 start[3]		= { origin.X, origin.Y, origin.Z };
+			const float32 invDir[3]		= { 1.0f / direction.X, 1.0f / direction.Y, 1.0f / direction.Z };
+			float32 distance = maxDistance;
+
+			int32 stack[BVH_STACK_SIZE];
+			uint32 stackCnt = 0;
+			stack[stackCnt++] = m_Root;
+			while(stackCnt > 0)
+			{
+				const BVHNode& node = m_Nodes[stack[--stackCnt]];
+
+				float32 entry = 0.0f;
+				float32 exit = distance;
+				for(uint32 axis = 0; axis < 3; ++axis)
+				{
+					float32 t0 = (node.Min[axis] - start[axis]) * invDir[axis];
+					float32 t1 = (node.Max[axis] - start[axis]) * invDir[axis];
+					if(t0 > t1)
+					{
+						float32 swap = t0;
+						t0 = t1;
+						t1 = swap;
+					}
+					entry	= t0 > entry ? t0 : entry;
+					exit	= t1 < exit ? t1 : exit;
+				}
+
+				if(entry > exit)
+					continue;
+
+				if(node.IsLeaf())
+				{
+					distance = callback(context, node.Handle, entry);
+					if(distance <= 0.0f)
+						return;
+					continue;
+				}
+
+				if(stackCnt + 2 > BVH_STACK_SIZE)
+				{
+					DEBUG_MSG("Stack overflow. [CEntityBVH::QueryRay]");
+					break;
+				}
+				stack[stackCnt++] = node.Child[0];
+				stack[stackCnt++] = node.Child[1];
+			}
+		}
+
+		float32 CEntityBVH::GetAreaRatio() const
+		{
+			if(m_Root == BVH_NULL_NODE)
+				return 0.0f;
+
+			float64 rootArea = SurfaceArea(m_Nodes[m_Root].Min, m_Nodes[m_Root].Max);
+			if(rootArea <= 0.0)
+				return 0.0f;
+
+			float64 totalArea = 0.0;
+			for(uint32 i = 0; i < m_Nodes.size(); ++i)
+			{
+				if(m_Nodes[i].Height > 0)
+					totalArea += SurfaceArea(m_Nodes[i].Min, m_Nodes[i].Max);
+			}
+			return (float32)(totalArea / rootArea);
+		}
+
+		bool CEntityBVH::Validate() const
+		{
+			if(m_Root == BVH_NULL_NODE)
+				return m_LeafCnt == 0 && m_DirtyCnt == 0;
+
+			if(m_Nodes[m_Root].Parent != BVH_NULL_NODE)
+				return false;
+
+			uint32 leafCnt = 0;
+			uint32 dirtyCnt = 0;
+			int32 stack[BVH_STACK_SIZE];
+			uint32 stackCnt = 0;
+			stack[stackCnt++] = m_Root;
+			while(stackCnt > 0)
+			{
+				int32 index = stack[--stackCnt];
+				const BVHNode& node = m_Nodes[index];
+				if(node.IsLeaf())
+				{
+					uint32 slot = GetSlotIndex(node.Handle);
+					if(node.Height != 0 || node.Child[1] != BVH_NULL_NODE || slot >= m_Leaves.size() || m_Leaves[slot] != index)
+						return false;
+
+					++leafCnt;
+					dirtyCnt += node.Dirty ? 1 : 0;
+					continue;
+				}
+
+				//inner nodes have two children pointing back and enclose both boxes
+				const BVHNode& child0 = m_Nodes[node.Child[0]];
+				const BVHNode& child1 = m_Nodes[node.Child[1]];
+				if(node.Child[1] == BVH_NULL_NODE || child0.Parent != index || child1.Parent != index ||
+					node.Height != 1 + MaxHeight(child0.Height, child1.Height))
+					return false;
+
+				for(uint32 axis = 0; axis < 3; ++axis)
+				{
+					if(	node.Min[axis] > child0.Min[axis] || node.Min[axis] > child1.Min[axis] ||
+						node.Max[axis] < child0.Max[axis] || node.Max[axis] < child1.Max[axis])
+						return false;
+				}
+
+				if(stackCnt + 2 > BVH_STACK_SIZE)
+					return false;
+				stack[stackCnt++] = node.Child[0];
+				stack[stackCnt++] = node.Child[1];
+			}
+
+			//no slot may point at a leaf outside the tree
+			uint32 slotCnt = 0;
+			for(uint32 i = 0; i < m_Leaves.size(); ++i)
+				slotCnt += m_Leaves[i] != BVH_NULL_NODE ? 1 : 0;
+
+			return leafCnt == m_LeafCnt && slotCnt == m_LeafCnt && dirtyCnt == m_DirtyCnt;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,164 @@
+/*
+	Dynamic bounding volume hierarchy over entity handles. Leaves
+	hold boxes fattened by a margin, so small moves leave the
+	tree alone. Larger moves refit the path to the root at once
+	and put the leaf on a dirty list, Rebalance reinserts dirty
+	leaves lazily within a budget. Insertion picks the cheapest
+	sibling by surface area and rotates towards balanced heights.
+*/
+
+#ifndef _CENTITYBVH_H_
+#define _CENTITYBVH_H_
+
+#include <vector>
+#include "../../Core/Header/Void.h"
+#include "../../Math/Header/CVector3.h"
+#include "CEntity3DStore.h"
+#include "CEntityFrustumCuller.h"
+
+using namespace Void::Core;
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Scene
+	{
+		#define BVH_NULL_NODE		-1
+
+		//deepest traversal a query can do, balanced trees stay far below
+		#define BVH_STACK_SIZE		256
+
+		//distance to the hit of a leaf box, returns the new maximum distance of the ray (0 stops the query)
+		typedef float32 (*BVHRayCallback)(void* const context, const EntityHandle handle, const float32 distance);
+
+		struct BVHNode
+		{
+			float32		Min[3];
+			float32		Max[3];
+
+			//next free node while unused
+			int32		Parent;
+			int32		Child[2];
+
+			//0 for leaves, -1 for free nodes
+			int32		Height;
+
+			EntityHandle	Handle;
+			bool		Dirty;
+
+			inline bool IsLeaf() const
+			{
+				return Child[0] == BVH_NULL_NODE;
+			}
+		};
+
+		class CEntityBVH
+		{
+		private:
+			std::vector<BVHNode>		m_Nodes;
+			int32				m_Root;
+			int32				m_FreeList;
+			uint32				m_LeafCnt;
+
+			//leaf of every entity, indexed like the slots of Entity3DStore
+			std::vector<int32>		m_Leaves;
+
+			//refit but not reinserted yet, may hold stale entries that lost their Dirty flag
+			std::vector<int32>		m_DirtyLeaves;
+			uint32				m_DirtyCnt;
+
+			float32				m_Margin;
+
+		private:
+			int32 AllocateNode();
+			void FreeNode(const int32 node);
+
+			void InsertLeaf(const int32 leaf);
+			void RemoveLeaf(const int32 leaf);
+
+			//takes the leaf out of the tree and its slot and frees it
+			void DestroyLeaf(const int32 leaf);
+
+			//rotates the taller grandchild up, returns the node now in place of node
+			int32 Balance(const int32 node);
+
+			//boxes and heights from node up to the root
+			void FixUpwards(int32 node, const bool balance);
+
+			int32 FindLeaf(const EntityHandle handle) const;
+
+			static inline uint32 GetSlotIndex(const EntityHandle handle)
+			{
+				return (handle & ENTITYHANDLE_INDEX_MASK) - 1;
+			}
+
+		public:
+			CEntityBVH();
+			~CEntityBVH();
+
+			void Release();
+
+			//fat boxes grow by margin on every side
+			inline void SetMargin(const float32 margin)
+			{
+				m_Margin = margin;
+			}
+
+			//false if the handle is already in the tree
+			//a leaf an earlier entity of the same slot left behind is removed, the store hands out one live handle per slot
+			bool Insert(const EntityHandle handle, const CVector3& min, const CVector3& max);
+			bool Remove(const EntityHandle handle);
+
+			//true if the leaf had to be refit, it then waits for Rebalance
+			bool Move(const EntityHandle handle, const CVector3& min, const CVector3& max);
+
+			//world box as of the last recompute of Entity3DStore
+			inline bool Insert(const EntityHandle handle)
+			{
+				CVector3 min, max;
+				Entity3DStore->GetWorldBounds(handle, min, max);
+				return this->Insert(handle, min, max);
+			}
+
+			inline bool Move(const EntityHandle handle)
+			{
+				CVector3 min, max;
+				Entity3DStore->GetWorldBounds(handle, min, max);
+				return this->Move(handle, min, max);
+			}
+
+			//reinserts up to maxLeaves dirty leaves, returns how many are left
+			uint32 Rebalance(const uint32 maxLeaves);
+
+			//handles are appended, the return value counts the appended ones
+			uint32 QueryFrustum(const FrustumPlanes& frustum, std::vector<EntityHandle>& handles) const;
+			uint32 QueryAABB(const CVector3& min, const CVector3& max, std::vector<EntityHandle>& handles) const;
+
+			//leaves in no particular order, boxes behind the current maximum distance are skipped
+			void QueryRay(const CVector3& origin, const CVector3& direction, const float32 maxDistance, BVHRayCallback callback, void* const context) const;
+
+			inline uint32 GetLeafCount() const
+			{
+				return m_LeafCnt;
+			}
+
+			inline uint32 GetDirtyCount() const
+			{
+				return m_DirtyCnt;
+			}
+
+			inline int32 GetHeight() const
+			{
+				return m_Root == BVH_NULL_NODE ? 0 : m_Nodes[m_Root].Height;
+			}
+
+			//surface area of all inner nodes over the one of the root, grows as the tree degrades
+			float32 GetAreaRatio() const;
+
+			//walks the whole tree, false if a link, box, height, leaf slot or count is off
+			bool Validate() const;
+		};
+	};
+};
+
+#endif
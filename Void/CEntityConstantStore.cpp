@@ -0,0 +1,186 @@
+#include "../Header/CEntityConstantStore.h"
+
+namespace Void
+{
+	namespace Scene
+	{
+		//0 is what an effect holds before anything was uploaded
+		std::atomic<uint64> CEntityConstantStore::s_NextVersion(1);
+
+		CEntityConstantStore::CEntityConstantStore()
+			:	m_DeadBytes(0)
+		{
+		}
+
+		CEntityConstantStore::~CEntityConstantStore()
+		{
+			this->Release();
+		}
+
+		void CEntityConstantStore::Release()
+		{
+			m_Passes.clear();
+			m_Slots.clear();
+			m_Lookup.clear();
+			std::vector<uint8>().swap(m_Data);
+			m_DeadBytes = 0;
+		}
+
+		bool CEntityConstantStore::GetValueSize(const ShaderConstant::ConstantType type, const uint32 arraySize, uint32& size)
+		{
+			switch(type)
+			{
+			case ShaderConstant::CONSTANT_TYPE_BOOL:				size = sizeof(bool);					break;
+			case ShaderConstant::CONSTANT_TYPE_INT:					size = sizeof(int32);					break;
+			case ShaderConstant::CONSTANT_TYPE_FLOAT:				size = sizeof(float32);					break;
+			case ShaderConstant::CONSTANT_TYPE_VECTOR3:				size = sizeof(CVector3);				break;
+			case ShaderConstant::CONSTANT_TYPE_VECTOR4:				size = sizeof(CVector4);				break;
+			case ShaderConstant::CONSTANT_TYPE_VECTOR4_ARRAY:		size = sizeof(CVector4) * arraySize;	break;
+			case ShaderConstant::CONSTANT_TYPE_MATRIX4X4:			size = sizeof(CMatrix4x4);				break;
+			case ShaderConstant::CONSTANT_TYPE_MATRIX4X4_ARRAY:		size = sizeof(CMatrix4x4) * arraySize;	break;
+			default:												return false;
+			}
+			return true;
+		}
+
+		uint32 CEntityConstantStore::Allocate(const uint32 size)
+		{
+			//values that were replaced by larger ones leave holes, squeeze them out once they dominate
+			if(m_DeadBytes > 0 && m_DeadBytes * 2 >= m_Data.size())
+				this->Compact();
+
+			uint32 offset = ((m_Data.size() + CONSTANTSTORE_ALIGNMENT - 1) / CONSTANTSTORE_ALIGNMENT) * CONSTANTSTORE_ALIGNMENT;
+			m_Data.resize(offset + size);
+			return offset;
+		}
+
+		void CEntityConstantStore::Compact()
+		{
+			std::vector<uint8> data;
+			data.reserve(m_Data.size() - m_DeadBytes);
+
+			for(uint32 pass = 0; pass < m_Passes.size(); ++pass)
+			{
+				std::vector<StoredConstant>& constants = m_Passes[pass];
+				for(uint32 i = 0; i < constants.size(); ++i)
+				{
+					uint32 offset = ((data.size() + CONSTANTSTORE_ALIGNMENT - 1) / CONSTANTSTORE_ALIGNMENT) * CONSTANTSTORE_ALIGNMENT;
+					data.resize(offset + constants[i].Size);
+					if(constants[i].Size > 0)
+						memcpy(&data[offset], &m_Data[constants[i].Offset], constants[i].Size);
+					constants[i].Offset = offset;
+				}
+			}
+
+			m_Data.swap(data);
+			m_DeadBytes = 0;
+		}
+
+		ShaderConstantHandle CEntityConstantStore::Set(const ShaderConstant& constant)
+		{
+			uint32 size = 0;
+			if(!GetValueSize(constant.Type, constant.ArraySize, size))
+			{
+				DEBUG_MSG("ShaderConstantType unknown. [CEntityConstantStore::Set]");
+				return ShaderConstantHandle_Invalid;
+			}
+
+			ShaderConstantHandle handle = this->Find(constant.Identifier);
+			if(handle != ShaderConstantHandle_Invalid)
+			{
+				//moved to another pass, the last constant of the old bucket takes its place
+				ConstantSlot& slot = m_Slots[handle - 1];
+				if(slot.Pass != constant.Pass)
+				{
+					std::vector<StoredConstant>& oldPass = m_Passes[slot.Pass];
+					StoredConstant moved = oldPass[slot.Index];
+					oldPass[slot.Index] = oldPass.back();
+					m_Slots[oldPass[slot.Index].Handle - 1].Index = slot.Index;
+					oldPass.pop_back();
+
+					if(m_Passes.size() <= constant.Pass)
+						m_Passes.resize(constant.Pass + 1);
+					slot.Pass	= constant.Pass;
+					slot.Index	= m_Passes[constant.Pass].size();
+					m_Passes[constant.Pass].push_back(moved);
+				}
+
+				StoredConstant& stored = m_Passes[slot.Pass][slot.Index];
+				if(stored.Type == constant.Type && stored.Size == size && (size == 0 || memcmp(&m_Data[stored.Offset], constant.Value, size) == 0))
+					return handle;
+
+				stored.Version = s_NextVersion.fetch_add(1, std::memory_order_relaxed);
+				if(size > stored.Size)
+				{
+					//may compact, the old value counts as dead only afterwards
+					uint32 offset = this->Allocate(size);
+					m_DeadBytes += stored.Size;
+					stored.Offset = offset;
+				}
+				else
+				{
+					m_DeadBytes += stored.Size - size;
+				}
+
+				stored.Type			= constant.Type;
+				stored.Size			= size;
+				stored.ArraySize	= constant.ArraySize;
+				if(size > 0)
+					memcpy(&m_Data[stored.Offset], constant.Value, size);
+				return handle;
+			}
+
+			StoredConstant stored;
+			stored.Identifier		= constant.Identifier;
+			stored.Type				= constant.Type;
+			stored.Offset			= this->Allocate(size);
+			stored.Size				= size;
+			stored.ArraySize		= constant.ArraySize;
+			stored.Handle			= m_Slots.size() + 1;
+			stored.Version			= s_NextVersion.fetch_add(1, std::memory_order_relaxed);
+			stored.HandleEffect		= NULL;
+			stored.HandleGeneration	= 0;
+			stored.ParameterHandle	= NULL;
+			stored.ParameterSlot	= EFFECTPARAMETER_NO_SLOT;
+			if(size > 0)
+				memcpy(&m_Data[stored.Offset], constant.Value, size);
+
+			if(m_Passes.size() <= constant.Pass)
+				m_Passes.resize(constant.Pass + 1);
+
+			ConstantSlot slot;
+			slot.Pass	= constant.Pass;
+			slot.Index	= m_Passes[constant.Pass].size();
+			m_Passes[constant.Pass].push_back(stored);
+			m_Slots.push_back(slot);
+			m_Lookup.insert(std::pair<const CHashedString, ShaderConstantHandle>(constant.Identifier, stored.Handle));
+			return stored.Handle;
+		}
+
+		bool CEntityConstantStore::Update(const ShaderConstantHandle handle, const void* const value)
+		{
+			if(handle == ShaderConstantHandle_Invalid || handle > m_Slots.size())
+				return false;
+
+			const ConstantSlot& slot = m_Slots[handle - 1];
+			StoredConstant& stored = m_Passes[slot.Pass][slot.Index];
+			if(stored.Size == 0 || memcmp(&m_Data[stored.Offset], value, stored.Size) == 0)
+				return true;
+
+			memcpy(&m_Data[stored.Offset], value, stored.Size);
+			stored.Version = s_NextVersion.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		ShaderConstantHandle CEntityConstantStore::Find(const CHashedString& identifier) const
+		{
+			std::map<const CHashedString, ShaderConstantHandle>::const_iterator iter = m_Lookup.find(identifier);
+			return iter != m_Lookup.end() ? iter->second : ShaderConstantHandle_Invalid;
+		}
+
+		void CEntityConstantStore::Bind(CEffect* const effect, const uint16 pass)
+		{
+			this->BindTarget(effect, effect, pass);
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,219 @@
+/*
+	Shader constants of one entity, bucketed by pass. Values
+	live packed in a single byte buffer, binding a pass sweeps
+	only its own bucket. Handles stay valid for the lifetime
+	of the store, whatever is replaced or compacted.
+	Every change of a value draws a version unique across all
+	stores, a value the effect already holds is not sent again.
+*/
+
+#ifndef _CENTITYCONSTANTSTORE_H_
+#define _CENTITYCONSTANTSTORE_H_
+
+#include <map>
+#include <vector>
+#include <atomic>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+#include "../../Core/Header/CHashedString.h"
+#include "../../Renderer/Header/CEffectParameterCache.h"
+#include "../../ResourceManagement/Header/CResourceManager.h"
+#include "../../ResourceManagement/Header/IShaderConstantSetter.h"
+#include "../../Math/Header/CMatrix4x4.h"
+
+using namespace Void::Core;
+using namespace Void::Renderer;
+using namespace Void::ResourceManagement;
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Scene
+	{
+		//0 is never handed out
+		typedef uint32 ShaderConstantHandle;
+		#define ShaderConstantHandle_Invalid	0
+
+		//values start on this boundary within the buffer
+		#define CONSTANTSTORE_ALIGNMENT		4
+
+		class CEntityConstantStore
+		{
+		private:
+			struct StoredConstant
+			{
+				CHashedString		Identifier;
+				ShaderConstant::ConstantType	Type;
+				uint32			Offset;
+				uint32			Size;
+				uint32			ArraySize;
+				ShaderConstantHandle	Handle;
+				uint64			Version;
+
+				//parameter handle resolved for the effect bound last, NULL if it does not know the parameter
+				const CEffect*		HandleEffect;
+				uint32			HandleGeneration;
+				EffectParameterHandle	ParameterHandle;
+				uint32			ParameterSlot;
+			};
+
+			struct ConstantSlot
+			{
+				uint16			Pass;
+				uint32			Index;
+			};
+
+			//constants of pass i in m_Passes[i], in the order they were added
+			std::vector<std::vector<StoredConstant> >		m_Passes;
+			std::vector<ConstantSlot>				m_Slots;
+			std::map<const CHashedString, ShaderConstantHandle>	m_Lookup;
+
+			std::vector<uint8>					m_Data;
+			uint32							m_DeadBytes;
+
+			//shared by all stores, an effect can tell values of different entities apart
+			static std::atomic<uint64>				s_NextVersion;
+
+		private:
+			uint32 Allocate(const uint32 size);
+			void Compact();
+
+		public:
+			CEntityConstantStore();
+			~CEntityConstantStore();
+
+			void Release();
+
+			//copies the value, an identifier that is already stored is replaced and keeps its handle
+			ShaderConstantHandle Set(const ShaderConstant& constant);
+
+			//size of value has to match the stored constant, an unchanged value keeps its version
+			bool Update(const ShaderConstantHandle handle, const void* const value);
+
+			//sends the constants of pass the effect does not hold yet, counted in EffectParameterCache
+			void Bind(CEffect* const effect, const uint16 pass);
+
+			//Bind through any target with the setters of CEffect, uploads are still tracked for effect
+			//lets benchmarks and tests stand in for a loaded effect
+			template<typename Target>
+			void BindTarget(Target* const target, const CEffect* const effect, const uint16 pass);
+
+			ShaderConstantHandle Find(const CHashedString& identifier) const;
+
+			//false for unknown types
+			static bool GetValueSize(const ShaderConstant::ConstantType type, const uint32 arraySize, uint32& size);
+
+			//NULL for invalid handles and empty values, stays valid until the next Set
+			inline void* GetValue(const ShaderConstantHandle handle)
+			{
+				if(handle == ShaderConstantHandle_Invalid || handle > m_Slots.size())
+					return NULL;
+
+				const ConstantSlot& slot = m_Slots[handle - 1];
+				const StoredConstant& stored = m_Passes[slot.Pass][slot.Index];
+				return stored.Size > 0 ? &m_Data[stored.Offset] : NULL;
+			}
+
+			inline uint32 GetConstantCount() const
+			{
+				return m_Slots.size();
+			}
+
+			inline uint32 GetDataSize() const
+			{
+				return m_Data.size();
+			}
+		};
+
+		template<typename Target>
+		void CEntityConstantStore::BindTarget(Target* const target, const CEffect* const effect, const uint16 pass)
+		{
+			if(pass >= m_Passes.size())
+				return;
+
+			std::vector<StoredConstant>& constants = m_Passes[pass];
+			if(constants.empty())
+				return;
+
+			//handles are only looked up again when the effect or its registration changed
+			uint32 generation = EffectParameterCache->GetGeneration(effect);
+			const EffectParameterMap* parameters = NULL;
+			bool parametersFetched = false;
+			uint64* uploaded = NULL;
+			uint32 sentCnt = 0;
+			uint32 skippedCnt = 0;
+
+			uint8* data = m_Data.empty() ? NULL : &m_Data[0];
+			for(uint32 i = 0; i < constants.size(); ++i)
+			{
+				StoredConstant& constant = constants[i];
+				if(constant.HandleEffect != effect || constant.HandleGeneration != generation)
+				{
+					if(!parametersFetched)
+					{
+						//may register the effect, which gives it a generation
+						parameters = EffectParameterCache->GetParameters(effect);
+						generation = EffectParameterCache->GetGeneration(effect);
+						parametersFetched = true;
+					}
+					const EffectParameter* parameter = CEffectParameterCache::FindParameter(parameters, constant.Identifier);
+					constant.ParameterHandle	= parameter != NULL ? parameter->Handle : NULL;
+					constant.ParameterSlot		= parameter != NULL ? parameter->Slot : EFFECTPARAMETER_NO_SLOT;
+					constant.HandleEffect		= effect;
+					constant.HandleGeneration	= generation;
+				}
+
+				//the effect still holds this very value, whoever bound in between
+				if(constant.ParameterSlot != EFFECTPARAMETER_NO_SLOT)
+				{
+					if(uploaded == NULL)
+						uploaded = EffectParameterCache->GetUploadedVersions(effect);
+
+					if(uploaded[constant.ParameterSlot] == constant.Version)
+					{
+						++skippedCnt;
+						continue;
+					}
+					uploaded[constant.ParameterSlot] = constant.Version;
+				}
+				++sentCnt;
+
+				void* value = data + constant.Offset;
+				switch(constant.Type)
+				{
+				case ShaderConstant::CONSTANT_TYPE_BOOL:
+					target->SetBool(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), *((bool*)value));
+					break;
+				case ShaderConstant::CONSTANT_TYPE_INT:
+					target->SetInt(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), *((int32*)value));
+					break;
+				case ShaderConstant::CONSTANT_TYPE_FLOAT:
+					target->SetFloat(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), *((float32*)value));
+					break;
+				case ShaderConstant::CONSTANT_TYPE_VECTOR3:
+					target->SetVector(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), (CVector3*)value);
+					break;
+				case ShaderConstant::CONSTANT_TYPE_VECTOR4:
+					target->SetVector(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), (CVector4*)value);
+					break;
+				case ShaderConstant::CONSTANT_TYPE_VECTOR4_ARRAY:
+					target->SetVectorArray(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), (CVector4*)value, constant.ArraySize);
+					break;
+				case ShaderConstant::CONSTANT_TYPE_MATRIX4X4:
+					target->SetMatrix(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), (CMatrix4x4*)value);
+					break;
+				case ShaderConstant::CONSTANT_TYPE_MATRIX4X4_ARRAY:
+					target->SetMatrixArray(EFFECT_PARAMETER(constant.ParameterHandle, constant.Identifier), (CMatrix4x4*)value, constant.ArraySize);
+					break;
+				default:
+					DEBUG_MSG("ShaderConstantType unknown. [CEntityConstantStore::Bind]");
+					break;
+				}
+			}
+
+			EffectParameterCache->CountUploads(sentCnt, skippedCnt);
+		}
+	};
+};
+
+#endif
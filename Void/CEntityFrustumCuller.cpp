@@ -0,0 +1,220 @@
+#include "../Header/CEntityFrustumCuller.h"
+#include <immintrin.h>
+
+namespace Void
+{
+	namespace Scene
+	{
+		//per plane the box corner furthest along the normal, one component array each
+		static inline void SelectCorners(const FrustumPlanes& frustum, const EntityChunk* const chunk, const float32* corners[6][3])
+		{
+			for(uint32 p = 0; p < 6; ++p)
+			{
+				for(uint32 axis = 0; axis < 3; ++axis)
+					corners[p][axis] = frustum.Planes[p][axis] >= 0.0f ? chunk->WorldMax[axis] : chunk->WorldMin[axis];
+			}
+		}
+
+		CEntityFrustumCuller::CEntityFrustumCuller()
+			:	m_Kernel(GetKernel(CCpuFeatures::DetectLevel())),
+				m_VisibleCnt(0)
+		{
+			//everything alive passes until a frustum is set
+			memset(&m_Frustum, 0, sizeof(m_Frustum));
+		}
+
+		CEntityFrustumCuller::~CEntityFrustumCuller()
+		{
+		}
+
+		void CEntityFrustumCuller::SetFrustum(const CMatrix4x4& viewProjection)
+		{
+			ExtractPlanes(viewProjection, m_Frustum);
+		}
+
+		void CEntityFrustumCuller::SetFrustum(const FrustumPlanes& frustum)
+		{
+			m_Frustum = frustum;
+		}
+
+		void CEntityFrustumCuller::SetLevel(const CCpuFeatures::SimdLevel level)
+		{
+			m_Kernel = GetKernel(level);
+		}
+
+		void CEntityFrustumCuller::ExtractPlanes(const CMatrix4x4& viewProjection, FrustumPlanes& frustum)
+		{
+			//row vectors, clip = v * M, so every plane is a combination of matrix columns
+			const float32* m = (const float32*)&viewProjection;
+			for(uint32 i = 0; i < 4; ++i)
+			{
+				float32 col0 = m[i * 4 + 0];
+				float32 col1 = m[i * 4 + 1];
+				float32 col2 = m[i * 4 + 2];
+				float32 col3 = m[i * 4 + 3];
+
+				frustum.Planes[0][i] = col3 + col0;		//left
+				frustum.Planes[1][i] = col3 - col0;		//right
+				frustum.Planes[2][i] = col3 + col1;		//bottom
+				frustum.Planes[3][i] = col3 - col1;		//top
+				frustum.Planes[4][i] = col2;			//near
+				frustum.Planes[5][i] = col3 - col2;		//far
+			}
+		}
+
+		uint32 CEntityFrustumCuller::CullScalar(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible)
+		{
+			const float32* corners[6][3];
+			SelectCorners(frustum, chunk, corners);
+
+			uint32 visibleCnt = 0;
+			for(uint32 i = 0; i < ENTITYSTORE_CHUNK_SIZE; ++i)
+			{
+				bool inside = true;
+				for(uint32 p = 0; p < 6; ++p)
+				{
+					const float32* plane = frustum.Planes[p];
+					float32 distance = (plane[0] * corners[p][0][i] + plane[1] * corners[p][1][i]) + (plane[2] * corners[p][2][i] + plane[3]);
+					inside &= distance >= 0.0f;
+				}
+
+				visible[visibleCnt] = chunk->Owners[i];
+				visibleCnt += (inside && chunk->Owners[i] != NULL) ? 1 : 0;
+			}
+			return visibleCnt;
+		}
+
+		uint32 CEntityFrustumCuller::CullSSE2(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible)
+		{
+			const float32* corners[6][3];
+			SelectCorners(frustum, chunk, corners);
+
+			__m128 planes[6][4];
+			for(uint32 p = 0; p < 6; ++p)
+			{
+				for(uint32 i = 0; i < 4; ++i)
+					planes[p][i] = _mm_set1_ps(frustum.Planes[p][i]);
+			}
+
+			const __m128 zero = _mm_setzero_ps();
+			uint32 visibleCnt = 0;
+			for(uint32 base = 0; base < ENTITYSTORE_CHUNK_SIZE; base += 4)
+			{
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for(uint32 p = 0; p < 6; ++p)
+				{
+					__m128 distance = _mm_add_ps(	_mm_add_ps(_mm_mul_ps(planes[p][0], _mm_load_ps(corners[p][0] + base)), _mm_mul_ps(planes[p][1], _mm_load_ps(corners[p][1] + base))),
+													_mm_add_ps(_mm_mul_ps(planes[p][2], _mm_load_ps(corners[p][2] + base)), planes[p][3]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+				}
+
+				//branchless compaction, every owner is written but only the visible ones advance
+				//free slots are inverted boxes and fail any real plane, a degenerate frustum still must not list them
+				uint32 mask = _mm_movemask_ps(inside);
+				for(uint32 i = 0; i < 4; ++i)
+				{
+					CEntity3D* owner = chunk->Owners[base + i];
+					visible[visibleCnt] = owner;
+					visibleCnt += ((mask >> i) & 1) & (owner != NULL ? 1 : 0);
+				}
+			}
+			return visibleCnt;
+		}
+
+		CPUFEATURES_TARGET_AVX uint32 CEntityFrustumCuller::CullAVX(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible)
+		{
+			const float32* corners[6][3];
+			SelectCorners(frustum, chunk, corners);
+
+			__m256 planes[6][4];
+			for(uint32 p = 0; p < 6; ++p)
+			{
+				for(uint32 i = 0; i < 4; ++i)
+					planes[p][i] = _mm256_set1_ps(frustum.Planes[p][i]);
+			}
+
+			//chunks are only 16 byte aligned
+			const __m256 zero = _mm256_setzero_ps();
+			uint32 visibleCnt = 0;
+			for(uint32 base = 0; base < ENTITYSTORE_CHUNK_SIZE; base += 8)
+			{
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for(uint32 p = 0; p < 6; ++p)
+				{
+					__m256 distance = _mm256_add_ps(	_mm256_add_ps(_mm256_mul_ps(planes[p][0], _mm256_loadu_ps(corners[p][0] + base)), _mm256_mul_ps(planes[p][1], _mm256_loadu_ps(corners[p][1] + base))),
+														_mm256_add_ps(_mm256_mul_ps(planes[p][2], _mm256_loadu_ps(corners[p][2] + base)), planes[p][3]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+				}
+
+				uint32 mask = _mm256_movemask_ps(inside);
+				for(uint32 i = 0; i < 8; ++i)
+				{
+					CEntity3D* owner = chunk->Owners[base + i];
+					visible[visibleCnt] = owner;
+					visibleCnt += ((mask >> i) & 1) & (owner != NULL ? 1 : 0);
+				}
+			}
+			_mm256_zeroupper();
+			return visibleCnt;
+		}
+
+		EntityCullKernel CEntityFrustumCuller::GetKernel(const CCpuFeatures::SimdLevel level)
+		{
+			switch(level)
+			{
+			case CCpuFeatures::SIMD_AVX:
+				return &CEntityFrustumCuller::CullAVX;
+			case CCpuFeatures::SIMD_SSE2:
+				return &CEntityFrustumCuller::CullSSE2;
+			default:
+				return &CEntityFrustumCuller::CullScalar;
+			}
+		}
+
+		uint32 CEntityFrustumCuller::CullChunks(const CEntity3DStore* const store, const uint32 beginChunk, const uint32 endChunk, CEntity3D** const visible) const
+		{
+			uint32 visibleCnt = 0;
+			for(uint32 c = beginChunk; c < endChunk; ++c)
+				visibleCnt += m_Kernel(m_Frustum, store->GetChunkByIndex(c), visible + visibleCnt);
+			return visibleCnt;
+		}
+
+		void CEntityFrustumCuller::CullTask(void* const context, const uint32 beginChunk, const uint32 endChunk)
+		{
+			CullContext* cullContext = (CullContext*)context;
+			CEntityFrustumCuller* culler = cullContext->Culler;
+			for(uint32 c = beginChunk; c < endChunk; ++c)
+				culler->m_ChunkVisibleCnt[c] = culler->CullChunks(cullContext->Store, c, c + 1, &culler->m_ChunkVisible[c * ENTITYSTORE_CHUNK_SIZE]);
+		}
+
+		uint32 CEntityFrustumCuller::Cull(const CEntity3DStore* const store, CWorkStealingPool* const pool, const uint32 grainSize)
+		{
+			uint32 chunkCnt = store->GetChunkCount();
+			if(m_Visible.size() < chunkCnt * ENTITYSTORE_CHUNK_SIZE)
+				m_Visible.resize(chunkCnt * ENTITYSTORE_CHUNK_SIZE);
+
+			if(pool == NULL || pool->GetThreadCount() == 0 || chunkCnt <= grainSize)
+			{
+				m_VisibleCnt = chunkCnt > 0 ? this->CullChunks(store, 0, chunkCnt, &m_Visible[0]) : 0;
+				return m_VisibleCnt;
+			}
+
+			//every chunk into its own range, then closed up in chunk order
+			if(m_ChunkVisible.size() < chunkCnt * ENTITYSTORE_CHUNK_SIZE)
+				m_ChunkVisible.resize(chunkCnt * ENTITYSTORE_CHUNK_SIZE);
+			m_ChunkVisibleCnt.resize(chunkCnt);
+
+			CullContext context = { this, store };
+			pool->ParallelFor(chunkCnt, grainSize, &CEntityFrustumCuller::CullTask, &context);
+
+			m_VisibleCnt = 0;
+			for(uint32 c = 0; c < chunkCnt; ++c)
+			{
+				if(m_ChunkVisibleCnt[c] > 0)
+					memcpy(&m_Visible[m_VisibleCnt], &m_ChunkVisible[c * ENTITYSTORE_CHUNK_SIZE], m_ChunkVisibleCnt[c] * sizeof(CEntity3D*));
+				m_VisibleCnt += m_ChunkVisibleCnt[c];
+			}
+			return m_VisibleCnt;
+		}
+	};
+};
\ No newline at end of file
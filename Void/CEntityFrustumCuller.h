@@ -0,0 +1,99 @@
+/*
+	Tests the world boxes of Entity3DStore against the six
+	planes of a view frustum, four (SSE2) or eight (AVX) boxes
+	at a time, and writes the owners of everything at least
+	partially inside into a compact visible list. Chunks of the
+	store can be culled on several threads.
+*/
+
+#ifndef _CENTITYFRUSTUMCULLER_H_
+#define _CENTITYFRUSTUMCULLER_H_
+
+#include <vector>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+#include "../../Math/Header/CMatrix4x4.h"
+#include "../../Renderer/Header/CCpuFeatures.h"
+#include "../../Renderer/Header/CWorkStealingPool.h"
+#include "CEntity3DStore.h"
+
+using namespace Void::Core;
+using namespace Void::Math;
+using namespace Void::Renderer;
+
+namespace Void
+{
+	namespace Scene
+	{
+		//a box is visible while its corner furthest along the normal stays in front of every plane
+		//[a, b, c, d] with a*x + b*y + c*z + d >= 0 inside, need not be normalized
+		struct FrustumPlanes
+		{
+			float32		Planes[6][4];
+		};
+
+		//appends the owners of the visible slots of one chunk, visible needs room for a whole chunk
+		typedef uint32 (*EntityCullKernel)(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible);
+
+		class CEntityFrustumCuller
+		{
+		private:
+			struct CullContext
+			{
+				CEntityFrustumCuller*	Culler;
+				const CEntity3DStore*	Store;
+			};
+
+			FrustumPlanes			m_Frustum;
+			EntityCullKernel		m_Kernel;
+
+			//one chunk sized range per chunk while culling on several threads
+			std::vector<CEntity3D*>		m_ChunkVisible;
+			std::vector<uint32>		m_ChunkVisibleCnt;
+
+			std::vector<CEntity3D*>		m_Visible;
+			uint32				m_VisibleCnt;
+
+		private:
+			static void CullTask(void* const context, const uint32 beginChunk, const uint32 endChunk);
+
+		public:
+			CEntityFrustumCuller();
+			~CEntityFrustumCuller();
+
+			//view * projection, Direct3D clip space (0 <= z <= w)
+			void SetFrustum(const CMatrix4x4& viewProjection);
+			void SetFrustum(const FrustumPlanes& frustum);
+
+			//picks the kernel for the given level, DetectLevel by default
+			void SetLevel(const CCpuFeatures::SimdLevel level);
+
+			//world boxes have to be recomputed before, visible owners keep the slot order of the store
+			//pool may be NULL, grainSize counts chunks
+			uint32 Cull(const CEntity3DStore* const store, CWorkStealingPool* const pool = NULL, const uint32 grainSize = 4);
+
+			//chunks [begin, end) into visible, which needs room for (end - begin) * ENTITYSTORE_CHUNK_SIZE owners
+			uint32 CullChunks(const CEntity3DStore* const store, const uint32 beginChunk, const uint32 endChunk, CEntity3D** const visible) const;
+
+			inline CEntity3D* const* GetVisible() const
+			{
+				return m_Visible.empty() ? NULL : &m_Visible[0];
+			}
+
+			inline uint32 GetVisibleCount() const
+			{
+				return m_VisibleCnt;
+			}
+
+			static void ExtractPlanes(const CMatrix4x4& viewProjection, FrustumPlanes& frustum);
+
+			static uint32 CullScalar(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible);
+			static uint32 CullSSE2(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible);
+			static uint32 CullAVX(const FrustumPlanes& frustum, const EntityChunk* const chunk, CEntity3D** const visible);
+
+			static EntityCullKernel GetKernel(const CCpuFeatures::SimdLevel level);
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "../Header/CEntityLuaDispatcher.h"
+#include "../Header/CEntity3D.h"
+
+namespace Void
+{
+	namespace Scene
+	{
+		static CEntityLuaDispatcher s_EntityLuaDispatcher;
+		CEntityLuaDispatcher* EntityLuaDispatcher = &s_EntityLuaDispatcher;
+
+		//__newindex of the actor table, only called for keys it does not have yet
+		static int OnActorAdded(lua_State* state)
+		{
+			lua_rawset(state, 1);
+			EntityLuaDispatcher->InvalidateActors();
+			return 0;
+		}
+
+		CEntityLuaDispatcher::CEntityLuaDispatcher()
+			:	m_ActorGeneration(1),
+				m_WatchingActors(false),
+				m_BatchFunction(NULL),
+				m_BatchTableSize(0),
+				m_LastDispatchCnt(0)
+		{
+		}
+
+		CEntityLuaDispatcher::~CEntityLuaDispatcher()
+		{
+			this->Release();
+		}
+
+		void CEntityLuaDispatcher::Release()
+		{
+			this->ClearBatchFunction();
+
+			for(uint32 i = 0; i < m_Entities.size(); ++i)
+			{
+				m_Entities[i]->ReleaseLuaHandler();
+				m_Entities[i]->m_LuaSlot = ENTITYLUA_NO_SLOT;
+			}
+			m_Entities.clear();
+
+			m_WatchingActors = false;
+			++m_ActorGeneration;
+		}
+
+		void CEntityLuaDispatcher::WatchActors()
+		{
+			m_WatchingActors = true;
+
+			LuaObject actors = Lua->GetGlobalActorTable();
+			if(!actors.IsTable())
+				return;
+
+			LuaObject metaTable = actors.GetMetaTable();
+			if(!metaTable.IsTable())
+			{
+				metaTable.AssignNewTable(actors.GetState());
+				actors.SetMetaTable(metaTable);
+			}
+			else if(!metaTable["__newindex"].IsNil())
+			{
+				DEBUG_MSG("Actor Table Has A __newindex Already, Added Actors Need InvalidateActors. [CEntityLuaDispatcher::WatchActors]");
+				return;
+			}
+
+			metaTable.Register("__newindex", &OnActorAdded);
+		}
+
+		LuaObject CEntityLuaDispatcher::FindActor(const char* const name)
+		{
+			if(!m_WatchingActors)
+				this->WatchActors();
+
+			return Lua->GetGlobalActorTable()[name];
+		}
+
+		void CEntityLuaDispatcher::Track(CEntity3D* const entity)
+		{
+			if(entity->m_LuaSlot != ENTITYLUA_NO_SLOT)
+				return;
+
+			entity->m_LuaSlot = m_Entities.size();
+			m_Entities.push_back(entity);
+		}
+
+		void CEntityLuaDispatcher::Untrack(CEntity3D* const entity)
+		{
+			if(entity->m_LuaQueueSlot != ENTITYLUA_NO_SLOT)
+			{
+				m_Queue[entity->m_LuaQueueSlot] = NULL;
+				entity->m_LuaQueueSlot = ENTITYLUA_NO_SLOT;
+			}
+
+			uint32 slot = entity->m_LuaSlot;
+			if(slot == ENTITYLUA_NO_SLOT)
+				return;
+
+			m_Entities[slot] = m_Entities.back();
+			m_Entities[slot]->m_LuaSlot = slot;
+			m_Entities.pop_back();
+			entity->m_LuaSlot = ENTITYLUA_NO_SLOT;
+		}
+
+		bool CEntityLuaDispatcher::SetBatchFunction(const char* const name)
+		{
+			LuaState* state = Lua->GetGlobalActorTable().GetState();
+			LuaObject funcObj = state->GetGlobals()[name];
+			if(!funcObj.IsFunction())
+			{
+				DEBUG_MSG_VA("[CEntityLuaDispatcher::SetBatchFunction]", "Lua function %s not found", name);
+				return false;
+			}
+
+			SAFE_DELETE(m_BatchFunction);
+			m_BatchFunction = new LuaFunction<void>(funcObj);
+
+			//reused every frame, only the entries past the current count are cleared
+			m_BatchActors.AssignNewTable(state);
+			m_BatchDeltas.AssignNewTable(state);
+			m_BatchTableSize = 0;
+			return true;
+		}
+
+		void CEntityLuaDispatcher::ClearBatchFunction()
+		{
+			SAFE_DELETE(m_BatchFunction);
+			m_BatchActors = LuaObject();
+			m_BatchDeltas = LuaObject();
+			m_BatchTableSize = 0;
+
+			this->ClearQueue();
+		}
+
+		void CEntityLuaDispatcher::ClearQueue()
+		{
+			for(uint32 i = 0; i < m_Queue.size(); ++i)
+			{
+				if(m_Queue[i] != NULL)
+					m_Queue[i]->m_LuaQueueSlot = ENTITYLUA_NO_SLOT;
+			}
+
+			m_Queue.clear();
+			m_QueueDeltas.clear();
+		}
+
+		void CEntityLuaDispatcher::Queue(CEntity3D* const entity, const float32 timeDelta)
+		{
+			//queued twice in a frame, the handler is called once with both deltas
+			if(entity->m_LuaQueueSlot != ENTITYLUA_NO_SLOT)
+			{
+				m_QueueDeltas[entity->m_LuaQueueSlot] += timeDelta;
+				return;
+			}
+
+			entity->m_LuaQueueSlot = m_Queue.size();
+			m_Queue.push_back(entity);
+			m_QueueDeltas.push_back(timeDelta);
+		}
+
+		void CEntityLuaDispatcher::Dispatch()
+		{
+			m_LastDispatchCnt = 0;
+			if(m_Queue.empty() || m_BatchFunction == NULL)
+				return;
+
+			uint32 cnt = 0;
+			for(uint32 i = 0; i < m_Queue.size(); ++i)
+			{
+				if(m_Queue[i] == NULL)
+					continue;
+
+				++cnt;
+				m_BatchActors.SetObject(cnt, m_Queue[i]->GetLuaActor());
+				m_BatchDeltas.SetNumber(cnt, m_QueueDeltas[i]);
+			}
+
+			//the tables end at the first nil, drop what is left of a longer frame
+			for(uint32 i = cnt; i < m_BatchTableSize; ++i)
+			{
+				m_BatchActors.SetNil(i + 1);
+				m_BatchDeltas.SetNil(i + 1);
+			}
+			m_BatchTableSize = cnt;
+
+			try
+			{
+				(*m_BatchFunction)(m_BatchActors, m_BatchDeltas);
+			}
+			catch(LuaException& ex)
+			{
+				DEBUG_MSG_VA("[CEntityLuaDispatcher::Dispatch]", 
+					"Failed to execute the batched OnUpdate of %u actors\nThe LuaFunction has caused the exception\n'%s'", 
+					cnt, ex.GetErrorMessage());
+			}
+
+			m_LastDispatchCnt = cnt;
+			this->ClearQueue();
+		}
+	};
+};
\ No newline at end of file
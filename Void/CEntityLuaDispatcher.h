@@ -0,0 +1,113 @@
+/*
+	Drives the Lua OnUpdate handlers of scene entities. Entities
+	keep their resolved handler until the actor table changes.
+	Actors added to the table are noticed through a __newindex
+	hook, code replacing or removing existing actors reports that
+	through InvalidateActors. In batched mode updates are queued
+	and handed to a single Lua function once per frame.
+*/
+
+#ifndef _CENTITYLUADISPATCHER_H_
+#define _CENTITYLUADISPATCHER_H_
+
+#include <vector>
+#include "../../Core/Header/Void.h"
+#include "../../Core/Header/CLua.h"
+
+using namespace Void::Core;
+using namespace LuaPlus;
+
+namespace Void
+{
+	namespace Scene
+	{
+		class CEntity3D;
+
+		//slot of entities that are not tracked or not queued
+		#define ENTITYLUA_NO_SLOT		0xFFFFFFFF
+
+		class CEntityLuaDispatcher
+		{
+		private:
+			//entities resolved under an older generation look their handler up again
+			uint32				m_ActorGeneration;
+			bool				m_WatchingActors;
+
+			//entities holding Lua references, they drop them on Release
+			std::vector<CEntity3D*>		m_Entities;
+
+			//batched mode, called as function(actors, deltas) with two arrays of equal length
+			LuaFunction<void>*		m_BatchFunction;
+			LuaObject			m_BatchActors;
+			LuaObject			m_BatchDeltas;
+			uint32				m_BatchTableSize;
+
+			//entities that died while queued leave NULL behind
+			std::vector<CEntity3D*>		m_Queue;
+			std::vector<float32>		m_QueueDeltas;
+			uint32				m_LastDispatchCnt;
+
+		private:
+			//installs the __newindex hook on the actor table, once per Lua state
+			void WatchActors();
+
+			//forgets the queue slots of everything queued
+			void ClearQueue();
+
+		public:
+			CEntityLuaDispatcher();
+			~CEntityLuaDispatcher();
+
+			//drops every Lua reference, those of the entities included, call before the Lua state is closed
+			void Release();
+
+			//call after actors were removed or replaced, additions are seen by the hook
+			inline void InvalidateActors()
+			{
+				++m_ActorGeneration;
+			}
+
+			inline uint32 GetActorGeneration() const
+			{
+				return m_ActorGeneration;
+			}
+
+			//the actor of that name in the global actor table, watching the table from now on
+			LuaObject FindActor(const char* const name);
+
+			//called by entities once they hold Lua references and when they die
+			void Track(CEntity3D* const entity);
+			void Untrack(CEntity3D* const entity);
+
+			//switches to batched mode with a global Lua function, false if there is none
+			bool SetBatchFunction(const char* const name);
+			void ClearBatchFunction();
+
+			inline bool IsBatched() const
+			{
+				return m_BatchFunction != NULL;
+			}
+
+			//only entities with a resolved handler, dying ones are taken out through Untrack
+			void Queue(CEntity3D* const entity, const float32 timeDelta);
+
+			//one Lua call for everything queued since the last Dispatch, once per frame after the updates
+			void Dispatch();
+
+			inline uint32 GetQueuedCount() const
+			{
+				return m_Queue.size();
+			}
+
+			inline uint32 GetLastDispatchCount() const
+			{
+				return m_LastDispatchCnt;
+			}
+		};
+
+		//used by CEntity3D::Update, single threaded like Lua itself
+		extern CEntityLuaDispatcher* EntityLuaDispatcher;
+	};
+};
+
+#endif
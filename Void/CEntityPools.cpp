@@ -0,0 +1,352 @@
+#include "../Header/CEntityPools.h"
+#include <immintrin.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+namespace Void
+{
+	namespace Scene
+	{
+		static CEntityPools s_EntityPools;
+		CEntityPools* EntityPools = &s_EntityPools;
+
+		static TSlabPool<CBoundingBox> s_BoundingBoxPool("BoundingBox");
+		TSlabPool<CBoundingBox>* BoundingBoxPool = &s_BoundingBoxPool;
+
+		static TSlabPool<ShaderConstant> s_ShaderConstantPool("ShaderConstant");
+		TSlabPool<ShaderConstant>* ShaderConstantPool = &s_ShaderConstantPool;
+
+		static std::atomic<uint32> s_NextCacheId(0);
+
+		struct PoolThreadCache
+		{
+			CSlabPool*	Pool;
+			void*		Head;
+			uint32		Count;
+			uint32		Generation;
+		};
+
+		//slots cached by a thread go back to their pool when it exits
+		struct PoolThreadCaches
+		{
+			PoolThreadCache	Caches[POOL_MAX_CACHED];
+
+			~PoolThreadCaches()
+			{
+				for(uint32 i = 0; i < POOL_MAX_CACHED; ++i)
+				{
+					if(Caches[i].Pool != NULL && Caches[i].Count > 0)
+						Caches[i].Pool->FlushCache(Caches[i].Head, Caches[i].Count, Caches[i].Generation);
+				}
+			}
+		};
+		static thread_local PoolThreadCaches s_ThreadCaches;
+
+		static inline void*& NextSlot(void* const slot)
+		{
+			return *(void**)slot;
+		}
+
+		CSlabPool::CSlabPool(const char* name, const uint32 objectSize)
+			:	m_Name(name),
+				m_SlotSize((objectSize + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1)),
+				m_SlotsPerSlab(0),
+				m_CacheId(s_NextCacheId++),
+				m_Generation(1),
+				m_FreeList(NULL),
+				m_FreeCnt(0),
+				m_PeakOutstanding(0),
+				m_Refills(0),
+				m_Flushes(0),
+				m_DoubleFreeCnt(0),
+				m_WriteAfterFreeCnt(0)
+		{
+			if(m_SlotSize < POOL_ALIGNMENT)
+				m_SlotSize = POOL_ALIGNMENT;
+
+			m_SlotsPerSlab = POOL_SLAB_BYTES / m_SlotSize;
+			if(m_SlotsPerSlab == 0)
+				m_SlotsPerSlab = 1;
+
+			if(m_CacheId >= POOL_MAX_CACHED)
+				m_CacheId = POOL_MAX_CACHED;
+		}
+
+		CSlabPool::~CSlabPool()
+		{
+			this->Release();
+		}
+
+		void CSlabPool::Release()
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			for(uint32 i = 0; i < m_Slabs.size(); ++i)
+				_mm_free(m_Slabs[i]);
+
+			std::vector<uint8*>().swap(m_Slabs);
+			m_FreeList			= NULL;
+			m_FreeCnt			= 0;
+			m_PeakOutstanding	= 0;
+			m_Refills			= 0;
+			m_Flushes			= 0;
+			m_DoubleFreeCnt		= 0;
+			m_WriteAfterFreeCnt	= 0;
+			++m_Generation;
+		}
+
+		bool CSlabPool::AddSlab()
+		{
+			uint8* slab = (uint8*)_mm_malloc(m_SlotSize * m_SlotsPerSlab, POOL_ALIGNMENT);
+			if(slab == NULL)
+			{
+				DEBUG_MSG_VA("[CSlabPool::AddSlab]", "Allocating a slab of pool %s failed", m_Name);
+				return false;
+			}
+
+			//in address order, slots of one batch end up next to each other
+			for(int32 i = m_SlotsPerSlab - 1; i >= 0; --i)
+			{
+				void* slot = slab + i * m_SlotSize;
+#ifdef VOID_POOL_DEBUG
+				this->Poison(slot);
+#endif
+				NextSlot(slot) = m_FreeList;
+				m_FreeList = slot;
+			}
+			m_FreeCnt += m_SlotsPerSlab;
+
+			m_Slabs.insert(std::upper_bound(m_Slabs.begin(), m_Slabs.end(), slab), slab);
+			return true;
+		}
+
+		uint32 CSlabPool::TakeBatch(void*& head, const uint32 count)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			while(m_FreeCnt < count)
+			{
+				if(!this->AddSlab())
+					break;
+			}
+
+			uint32 taken = count < m_FreeCnt ? count : m_FreeCnt;
+			if(taken == 0)
+				return 0;
+
+			//the batch is the front of the free list
+			head = m_FreeList;
+			void* tail = head;
+			for(uint32 i = 1; i < taken; ++i)
+				tail = NextSlot(tail);
+
+			m_FreeList = NextSlot(tail);
+			NextSlot(tail) = NULL;
+			m_FreeCnt -= taken;
+			++m_Refills;
+
+			uint32 outstanding = m_Slabs.size() * m_SlotsPerSlab - m_FreeCnt;
+			if(outstanding > m_PeakOutstanding)
+				m_PeakOutstanding = outstanding;
+			return taken;
+		}
+
+		void CSlabPool::ReturnBatch(void* head, void* tail, const uint32 count)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			NextSlot(tail) = m_FreeList;
+			m_FreeList = head;
+			m_FreeCnt += count;
+			++m_Flushes;
+		}
+
+		void CSlabPool::FlushCache(void* head, const uint32 count, const uint32 generation)
+		{
+			//slots of released slabs are gone already
+			if(generation != m_Generation || count == 0)
+				return;
+
+			void* tail = head;
+			for(uint32 i = 1; i < count; ++i)
+				tail = NextSlot(tail);
+
+			this->ReturnBatch(head, tail, count);
+		}
+
+		void* CSlabPool::Allocate()
+		{
+			void* slot = NULL;
+			if(m_CacheId < POOL_MAX_CACHED)
+			{
+				PoolThreadCache& cache = s_ThreadCaches.Caches[m_CacheId];
+				if(cache.Generation != m_Generation)
+				{
+					cache.Pool			= this;
+					cache.Head			= NULL;
+					cache.Count			= 0;
+					cache.Generation	= m_Generation;
+				}
+
+				if(cache.Count == 0)
+				{
+					cache.Count = this->TakeBatch(cache.Head, POOL_CACHE_BATCH);
+					if(cache.Count == 0)
+						return NULL;
+				}
+
+				slot = cache.Head;
+				cache.Head = NextSlot(slot);
+				--cache.Count;
+			}
+			else if(this->TakeBatch(slot, 1) == 0)
+				return NULL;
+
+#ifdef VOID_POOL_DEBUG
+			if(!this->IsPoisoned(slot))
+			{
+				DEBUG_MSG_VA("[CSlabPool::Allocate]", "Slot %p of pool %s was written to after it was freed", slot, m_Name);
+				std::lock_guard<std::mutex> lock(m_Lock);
+				++m_WriteAfterFreeCnt;
+			}
+			memset(slot, POOL_FILL, m_SlotSize);
+#endif
+			return slot;
+		}
+
+		void CSlabPool::Free(void* const slot)
+		{
+			if(slot == NULL)
+				return;
+
+#ifdef VOID_POOL_DEBUG
+			if(this->IsPoisoned(slot))
+			{
+				DEBUG_MSG_VA("[CSlabPool::Free]", "Slot %p of pool %s was freed twice", slot, m_Name);
+				std::lock_guard<std::mutex> lock(m_Lock);
+				++m_DoubleFreeCnt;
+				return;
+			}
+			this->Poison(slot);
+#endif
+
+			if(m_CacheId >= POOL_MAX_CACHED)
+			{
+				this->ReturnBatch(slot, slot, 1);
+				return;
+			}
+
+			PoolThreadCache& cache = s_ThreadCaches.Caches[m_CacheId];
+			if(cache.Generation != m_Generation)
+			{
+				cache.Pool			= this;
+				cache.Head			= NULL;
+				cache.Count			= 0;
+				cache.Generation	= m_Generation;
+			}
+
+			NextSlot(slot) = cache.Head;
+			cache.Head = slot;
+			if(++cache.Count < POOL_CACHE_SIZE)
+				return;
+
+			//keep the slots freed last, they are most likely still in the CPU cache
+			void* keepTail = cache.Head;
+			for(uint32 i = 1; i < POOL_CACHE_BATCH; ++i)
+				keepTail = NextSlot(keepTail);
+
+			void* head = NextSlot(keepTail);
+			NextSlot(keepTail) = NULL;
+
+			uint32 count = cache.Count - POOL_CACHE_BATCH;
+			void* tail = head;
+			for(uint32 i = 1; i < count; ++i)
+				tail = NextSlot(tail);
+
+			cache.Count = POOL_CACHE_BATCH;
+			this->ReturnBatch(head, tail, count);
+		}
+
+		bool CSlabPool::Owns(const void* const slot)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			std::vector<uint8*>::const_iterator it = std::upper_bound(m_Slabs.begin(), m_Slabs.end(), (uint8*)slot);
+			if(it == m_Slabs.begin())
+				return false;
+
+			--it;
+			return (const uint8*)slot < *it + m_SlotSize * m_SlotsPerSlab;
+		}
+
+		void CSlabPool::GetStats(PoolStats& stats)
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			stats.Name				= m_Name;
+			stats.SlotSize			= m_SlotSize;
+			stats.SlabCnt			= m_Slabs.size();
+			stats.Capacity			= m_Slabs.size() * m_SlotsPerSlab;
+			stats.Outstanding		= stats.Capacity - m_FreeCnt;
+			stats.PeakOutstanding	= m_PeakOutstanding;
+			stats.Refills			= m_Refills;
+			stats.Flushes			= m_Flushes;
+			stats.DoubleFrees		= m_DoubleFreeCnt;
+			stats.WritesAfterFree	= m_WriteAfterFreeCnt;
+		}
+
+		void CSlabPool::Poison(void* const slot) const
+		{
+			memset((uint8*)slot + sizeof(void*), POOL_POISON, m_SlotSize - sizeof(void*));
+		}
+
+		bool CSlabPool::IsPoisoned(const void* const slot) const
+		{
+			const uint8* bytes = (const uint8*)slot;
+			for(uint32 i = sizeof(void*); i < m_SlotSize; ++i)
+			{
+				if(bytes[i] != POOL_POISON)
+					return false;
+			}
+			return true;
+		}
+
+		CEntityPools::CEntityPools()
+		{
+			m_Pools[0] = new CSlabPool("Entity512", 512);
+			m_Pools[1] = new CSlabPool("Entity1024", 1024);
+			m_Pools[2] = new CSlabPool("Entity2048", ENTITYPOOL_MAX_SIZE);
+		}
+
+		CEntityPools::~CEntityPools()
+		{
+			for(uint32 i = 0; i < ENTITYPOOL_CLASS_COUNT; ++i)
+				SAFE_DELETE(m_Pools[i]);
+		}
+
+		void CEntityPools::Release()
+		{
+			for(uint32 i = 0; i < ENTITYPOOL_CLASS_COUNT; ++i)
+				m_Pools[i]->Release();
+		}
+
+		void* CEntityPools::Allocate(const size_t size)
+		{
+			if(size > ENTITYPOOL_MAX_SIZE)
+				return ::operator new(size);
+
+			void* object = m_Pools[GetClass(size)]->Allocate();
+			if(object == NULL)
+				throw std::bad_alloc();
+
+			return object;
+		}
+
+		void CEntityPools::Free(void* const object, const size_t size)
+		{
+			if(size > ENTITYPOOL_MAX_SIZE)
+			{
+				::operator delete(object);
+				return;
+			}
+
+			m_Pools[GetClass(size)]->Free(object);
+		}
+	};
+};
\ No newline at end of file
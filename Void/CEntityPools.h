@@ -0,0 +1,196 @@
+/*
+	Slab pools for objects that come and go with streamed levels.
+	Slots are carved out of 64KB slabs that live until Release,
+	every thread keeps a small cache of free slots and only takes
+	the pool lock to move a batch between its cache and the shared
+	free list. With VOID_POOL_DEBUG defined freed slots are poisoned,
+	writes after free and double frees are reported.
+*/
+
+#ifndef _CENTITYPOOLS_H_
+#define _CENTITYPOOLS_H_
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <utility>
+#include "../../Core/Header/Void.h"
+#include "../../ResourceManagement/Header/IShaderConstantSetter.h"
+#include "../../Math/Header/CBoundingBox.h"
+
+using namespace Void::Core;
+using namespace Void::ResourceManagement;
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Scene
+	{
+		#define POOL_SLAB_BYTES			65536
+		#define POOL_ALIGNMENT			16
+
+		//pools with a thread cache, later ones always go through the lock
+		#define POOL_MAX_CACHED			16
+
+		//free slots a thread holds at most, moved in halves
+		#define POOL_CACHE_SIZE			64
+		#define POOL_CACHE_BATCH		32
+
+		//fills freed slots behind the free list link
+		#define POOL_POISON			0xDD
+
+		//fills slots when they are handed out, so a slot freed untouched is not taken for a double free
+		#define POOL_FILL			0xCD
+
+		//object sizes of the entity pools, larger entities come from the heap
+		#define ENTITYPOOL_CLASS_COUNT		3
+		#define ENTITYPOOL_MAX_SIZE		2048
+
+		struct PoolStats
+		{
+			const char*	Name;
+			uint32		SlotSize;
+			uint32		SlabCnt;
+			uint32		Capacity;
+
+			//slots taken from the shared free list, includes the ones parked in thread caches
+			uint32		Outstanding;
+			uint32		PeakOutstanding;
+
+			//batches moved from and back to the shared free list
+			uint64		Refills;
+			uint64		Flushes;
+
+			//reported misuse, only counted with VOID_POOL_DEBUG
+			uint32		DoubleFrees;
+			uint32		WritesAfterFree;
+		};
+
+		class CSlabPool
+		{
+		private:
+			const char*		m_Name;
+			uint32			m_SlotSize;
+			uint32			m_SlotsPerSlab;
+
+			//index of the thread cache, POOL_MAX_CACHED if there is none
+			uint32			m_CacheId;
+
+			//bumped by Release, thread caches of an older generation are dropped
+			uint32			m_Generation;
+
+			//sorted by address for Owns
+			std::vector<uint8*>	m_Slabs;
+			void*			m_FreeList;
+			uint32			m_FreeCnt;
+
+			uint32			m_PeakOutstanding;
+			uint64			m_Refills;
+			uint64			m_Flushes;
+			uint32			m_DoubleFreeCnt;
+			uint32			m_WriteAfterFreeCnt;
+
+			std::mutex		m_Lock;
+
+		private:
+			//links the slots of a new slab into the free list, lock held
+			bool AddSlab();
+
+			//pops up to count slots off the shared free list into a chain, returns the number taken
+			uint32 TakeBatch(void*& head, const uint32 count);
+			void ReturnBatch(void* head, void* tail, const uint32 count);
+
+			void Poison(void* const slot) const;
+			bool IsPoisoned(const void* const slot) const;
+
+		public:
+			CSlabPool(const char* name, const uint32 objectSize);
+			~CSlabPool();
+
+			//frees every slab, all objects have to be freed and no other thread may use the pool anymore
+			void Release();
+
+			//NULL if no slab could be allocated
+			void* Allocate();
+			void Free(void* const slot);
+
+			//true if slot lies in one of the slabs
+			bool Owns(const void* const slot);
+
+			void GetStats(PoolStats& stats);
+
+			inline uint32 GetSlotSize() const
+			{
+				return m_SlotSize;
+			}
+
+			//returns a thread cache to the shared free list, called on thread exit
+			void FlushCache(void* head, const uint32 count, const uint32 generation);
+		};
+
+		//typed front of CSlabPool, constructs and destroys in place
+		template<typename T>
+		class TSlabPool : public CSlabPool
+		{
+		public:
+			explicit TSlabPool(const char* name)
+				:	CSlabPool(name, sizeof(T))
+			{
+			}
+
+			template<typename... Args>
+			inline T* New(Args&&... args)
+			{
+				void* slot = this->Allocate();
+				if(slot == NULL)
+					return NULL;
+
+				return new(slot) T(std::forward<Args>(args)...);
+			}
+
+			inline void Delete(T* const object)
+			{
+				if(object == NULL)
+					return;
+
+				object->~T();
+				this->Free(object);
+			}
+		};
+
+		//size class pools behind operator new and delete of CEntity3D
+		class CEntityPools
+		{
+		private:
+			CSlabPool*		m_Pools[ENTITYPOOL_CLASS_COUNT];
+
+			static inline uint32 GetClass(const size_t size)
+			{
+				return size <= 512 ? 0 : (size <= 1024 ? 1 : 2);
+			}
+
+		public:
+			CEntityPools();
+			~CEntityPools();
+
+			void Release();
+
+			//throws std::bad_alloc like operator new
+			void* Allocate(const size_t size);
+			void Free(void* const object, const size_t size);
+
+			inline CSlabPool* GetPool(const uint32 sizeClass) const
+			{
+				return m_Pools[sizeClass];
+			}
+		};
+
+		extern CEntityPools* EntityPools;
+		extern TSlabPool<CBoundingBox>* BoundingBoxPool;
+
+		//constants handed to CEntity3D::SetShaderConstant are given back here if they came from it
+		extern TSlabPool<ShaderConstant>* ShaderConstantPool;
+	};
+};
+
+#endif
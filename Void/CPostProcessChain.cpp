@@ -0,0 +1,209 @@
+#include "../Header/CPostProcessChain.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		static const CHashedString s_DiffuseTexture("diffuseTexture");
+
+		CPostProcessChain::CPostProcessChain()
+			:	m_Device(NULL),
+				m_Renderer(NULL),
+				m_ResourceManager(NULL),
+				m_LastDrawCnt(0),
+				m_LastTargetCnt(0)
+		{
+			m_TargetIds[0]		= TextureId_Default;
+			m_TargetIds[1]		= TextureId_Default;
+			m_TargetSurfaces[0]	= NULL;
+			m_TargetSurfaces[1]	= NULL;
+		}
+
+		CPostProcessChain::~CPostProcessChain()
+		{
+			this->Release();
+		}
+
+		bool CPostProcessChain::Initialize(IDirect3DDevice9* const device, CSpriteRenderer* const renderer, CResourceManager* const resManager)
+		{
+			m_Device			= device;
+			m_Renderer			= renderer;
+			m_ResourceManager	= resManager;
+			return true;
+		}
+
+		void CPostProcessChain::Release()
+		{
+			SAFE_RELEASE(m_TargetSurfaces[0]);
+			SAFE_RELEASE(m_TargetSurfaces[1]);
+			m_Passes.clear();
+		}
+
+		bool CPostProcessChain::SetTargets(const TextureId idA, IDirect3DTexture9* const targetA, const TextureId idB, IDirect3DTexture9* const targetB)
+		{
+			SAFE_RELEASE(m_TargetSurfaces[0]);
+			SAFE_RELEASE(m_TargetSurfaces[1]);
+
+			HRESULT hr = targetA->GetSurfaceLevel(0, &m_TargetSurfaces[0]);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetSurfaceLevel Failed. [CPostProcessChain::SetTargets]");
+				return false;
+			}
+
+			hr = targetB->GetSurfaceLevel(0, &m_TargetSurfaces[1]);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetSurfaceLevel Failed. [CPostProcessChain::SetTargets]");
+				SAFE_RELEASE(m_TargetSurfaces[0]);
+				return false;
+			}
+
+			m_TargetIds[0] = idA;
+			m_TargetIds[1] = idB;
+			return true;
+		}
+
+		void CPostProcessChain::AddPass(const EffectId effect, PostProcessSetup setup, void* const context, const bool readsPrevious)
+		{
+			PostProcessPass pass;
+			pass.Effect			= effect;
+			pass.Setup			= setup;
+			pass.Context		= context;
+			pass.ReadsPrevious	= readsPrevious;
+			m_Passes.push_back(pass);
+		}
+
+		void CPostProcessChain::ClearPasses()
+		{
+			m_Passes.clear();
+		}
+
+		bool CPostProcessChain::Execute(CTexture* const source, IDirect3DSurface9* const finalTarget)
+		{
+			m_LastDrawCnt	= 0;
+			m_LastTargetCnt	= 0;
+			if(m_Passes.empty())
+				return true;
+
+			//the first group would draw into the texture it samples
+			for(uint8 i = 0; i < 2; ++i)
+			{
+				if(m_TargetSurfaces[i] != NULL && source == m_ResourceManager->GetTextureById(m_TargetIds[i]))
+				{
+					DEBUG_MSG("Source Is A Ping-Pong Target. [CPostProcessChain::Execute]");
+					return false;
+				}
+			}
+
+			IDirect3DSurface9* boundTarget = NULL;
+			HRESULT hr = m_Device->GetRenderTarget(0, &boundTarget);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetRenderTarget Failed. [CPostProcessChain::Execute]");
+				return false;
+			}
+
+			//same geometry for every pass
+			m_Renderer->BindFullScreenQuad();
+
+			IDirect3DSurface9* currentTarget = boundTarget;
+			CEffect* currentEffect = NULL;
+			CTexture* currentInput = NULL;
+			CTexture* input = source;
+			uint8 target = 0;
+			bool result = true;
+
+			uint32 passCnt = m_Passes.size();
+			uint32 pass = 0;
+			while(pass < passCnt)
+			{
+				//the pass and every fused one behind it share a target
+				uint32 groupEnd = pass + 1;
+				while(groupEnd < passCnt && !m_Passes[groupEnd].ReadsPrevious)
+					++groupEnd;
+
+				bool last = (groupEnd == passCnt);
+				IDirect3DSurface9* output = last ? (finalTarget != NULL ? finalTarget : boundTarget) : m_TargetSurfaces[target];
+				if(output == NULL)
+				{
+					DEBUG_MSG("No Ping-Pong Targets Set. [CPostProcessChain::Execute]");
+					result = false;
+					break;
+				}
+
+				if(output != currentTarget)
+				{
+					hr = m_Device->SetRenderTarget(0, output);
+					if(FAILED(hr))
+					{
+						DEBUG_MSG("SetRenderTarget Failed. [CPostProcessChain::Execute]");
+						result = false;
+						break;
+					}
+					currentTarget = output;
+					++m_LastTargetCnt;
+				}
+
+				for(; pass < groupEnd; ++pass)
+				{
+					const PostProcessPass& current = m_Passes[pass];
+
+					//matrices and input stay with the effect as long as nothing else binds it
+					CEffect* effect = m_ResourceManager->GetEffectById(current.Effect);
+					if(effect == NULL)
+					{
+						DEBUG_MSG("GetEffectById Failed. [CPostProcessChain::Execute]");
+						result = false;
+						break;
+					}
+
+					if(effect != currentEffect)
+					{
+						m_Renderer->SetScreenMatrices(effect);
+						currentEffect = effect;
+						currentInput = NULL;
+					}
+
+					if(input != currentInput)
+					{
+						effect->SetTexture(EFFECT_PARAMETER(EffectParameterCache->GetHandle(effect, s_DiffuseTexture), s_DiffuseTexture), input);
+						currentInput = input;
+					}
+
+					//whatever the callback sets bypasses the upload records
+					if(current.Setup != NULL)
+					{
+						current.Setup(current.Context, effect);
+						EffectParameterCache->InvalidateUploads(effect);
+					}
+
+					m_LastDrawCnt += m_Renderer->DrawFullScreenQuad(effect);
+				}
+
+				if(!result)
+					break;
+
+				//the next group samples what this one wrote
+				if(!last)
+				{
+					input = m_ResourceManager->GetTextureById(m_TargetIds[target]);
+					target ^= 1;
+				}
+			}
+
+			if(currentTarget != boundTarget)
+			{
+				hr = m_Device->SetRenderTarget(0, boundTarget);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetRenderTarget Failed. [CPostProcessChain::Execute]");
+					result = false;
+				}
+			}
+			SAFE_RELEASE(boundTarget);
+
+			return result;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+	Ordered list of full screen effect passes. Each pass reads
+	the result of the one before it from a pair of ping-pong
+	render targets, the last one writes the final target. All
+	passes draw the renderer's static quad, which is bound once
+	per chain.
+*/
+
+#ifndef _CPOSTPROCESSCHAIN_H_
+#define _CPOSTPROCESSCHAIN_H_
+
+#include <d3d9.h>
+#include <vector>
+#include "../../Core/Header/Void.h"
+#include "../../ResourceManagement/Header/CResourceManager.h"
+#include "RendererTypes.h"
+#include "CSpriteRenderer.h"
+
+using namespace Void::ResourceManagement;
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//sets the parameters of a pass right before it draws, its input is already bound as diffuseTexture
+		typedef void (*PostProcessSetup)(void* const context, CEffect* const effect);
+
+		struct PostProcessPass
+		{
+			EffectId		Effect;
+			PostProcessSetup	Setup;
+			void*			Context;
+
+			//false fuses the pass onto the one before it: it sees the same input and draws
+			//over its result in the same target, so its effect has to blend
+			bool			ReadsPrevious;
+		};
+
+		class CPostProcessChain
+		{
+		private:
+			IDirect3DDevice9*		m_Device;
+			CSpriteRenderer*		m_Renderer;
+			CResourceManager*		m_ResourceManager;
+
+			std::vector<PostProcessPass>	m_Passes;
+
+			//ping-pong targets, the texture id is what the next pass samples
+			TextureId			m_TargetIds[2];
+			IDirect3DSurface9*		m_TargetSurfaces[2];
+
+			uint32				m_LastDrawCnt;
+			uint32				m_LastTargetCnt;
+
+		public:
+			CPostProcessChain();
+			~CPostProcessChain();
+
+			bool Initialize(IDirect3DDevice9* const device, CSpriteRenderer* const renderer, CResourceManager* const resManager);
+			void Release();
+
+			//render target textures known to the resource manager under their ids, screen sized
+			//only needed once a chain has two passes that are not fused
+			bool SetTargets(const TextureId idA, IDirect3DTexture9* const targetA, const TextureId idB, IDirect3DTexture9* const targetB);
+
+			//appended behind the passes added before, setup may be NULL
+			void AddPass(const EffectId effect, PostProcessSetup setup = NULL, void* const context = NULL, const bool readsPrevious = true);
+			void ClearPasses();
+
+			//runs every pass on source, the last one draws into finalTarget or the bound target if NULL
+			//render target 0 is restored afterwards, source must not be one of the ping-pong targets
+			//an unknown pass effect stops the chain and returns false
+			bool Execute(CTexture* const source, IDirect3DSurface9* const finalTarget = NULL);
+
+			inline uint32 GetPassCount() const			{ return m_Passes.size(); }
+
+			//counters of the last Execute
+			inline uint32 GetLastDrawCount() const		{ return m_LastDrawCnt; }
+			inline uint32 GetLastTargetCount() const	{ return m_LastTargetCnt; }
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include "../Header/CSpriteBenchmark.h"
+#include "../Header/CSpriteRenderer.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteBenchmark::CSpriteBenchmark()
+			:	m_Renderer(NULL),
+				m_OwnsRenderer(false),
+				m_AllocationCounter(NULL),
+				m_Sink(NULL)
+		{
+		}
+
+		CSpriteBenchmark::~CSpriteBenchmark()
+		{
+			this->Release();
+		}
+
+		void CSpriteBenchmark::Initialize(CSpriteRenderer* const renderer, AllocationCounter allocationCounter, CSpriteCommandSink* const sink)
+		{
+			this->Release();
+
+			m_Renderer = renderer;
+			m_AllocationCounter = allocationCounter;
+			m_Sink = sink;
+		}
+
+		bool CSpriteBenchmark::InitializeHeadless(const float32 width, const float32 height, const SpriteRenderMode mode, const SpriteVertexFormat format, AllocationCounter allocationCounter, CSpriteCommandSink* const sink)
+		{
+			this->Release();
+
+			if(sink == NULL)
+			{
+				DEBUG_MSG("Headless Benchmark Needs A Sink. [CSpriteBenchmark::InitializeHeadless]");
+				return false;
+			}
+
+			CSpriteRenderer* renderer = new CSpriteRenderer();
+			if(!renderer->Initialize(NULL, width, height, mode, format))
+			{
+				DEBUG_MSG("Initialize Renderer Failed. [CSpriteBenchmark::InitializeHeadless]");
+				delete renderer;
+				return false;
+			}
+
+			m_Renderer = renderer;
+			m_OwnsRenderer = true;
+			m_AllocationCounter = allocationCounter;
+			m_Sink = sink;
+			return true;
+		}
+
+		void CSpriteBenchmark::Release()
+		{
+			if(m_OwnsRenderer)
+			{
+				m_Renderer->Release();
+				delete m_Renderer;
+			}
+
+			m_Renderer = NULL;
+			m_OwnsRenderer = false;
+			m_AllocationCounter = NULL;
+			m_Sink = NULL;
+		}
+
+		void CSpriteBenchmark::RenderLayer(const uint8 curtain)
+		{
+			if(m_Sink == NULL)
+			{
+				if(curtain == 0)
+					m_Renderer->RenderBackground();
+				else
+					m_Renderer->RenderForeground();
+				return;
+			}
+
+			if(curtain == 0)
+				m_Renderer->BuildBackground(m_List);
+			else
+				m_Renderer->BuildForeground(m_List);
+			m_Renderer->Execute(m_List, m_Sink);
+		}
+
+		bool CSpriteBenchmark::Run(CSpriteWorkload& workload, const uint32 frames, const uint32 warmupFrames, const bool inPlace, SpriteBenchResult& result)
+		{
+			if(m_Renderer == NULL || frames == 0)
+			{
+				DEBUG_MSG("Benchmark Not Initialized. [CSpriteBenchmark::Run]");
+				return false;
+			}
+
+			memset(&result, 0, sizeof(SpriteBenchResult));
+			result.Params			= workload.GetParams();
+			result.InPlace			= inPlace;
+			result.Frames			= frames;
+			result.SpritesPerFrame	= workload.GetSpriteCount();
+
+			//Render skips an empty layer and leaves its counters alone
+			bool hasBackground = workload.GetCurtainJobCount() < workload.GetJobCount();
+			bool hasForeground = workload.GetCurtainJobCount() > 0;
+
+			uint64 submitNs = 0;
+			uint64 renderNs = 0;
+			uint64 draws = 0;
+			uint64 batches = 0;
+			uint64 arenaAllocations = 0;
+			uint64 arenaBytes = 0;
+			uint64 allocationsBefore = 0;
+
+			for(uint32 frame = 0; frame < warmupFrames + frames; ++frame)
+			{
+				bool measure = frame >= warmupFrames;
+				if(frame == warmupFrames && m_AllocationCounter != NULL)
+					allocationsBefore = m_AllocationCounter();
+
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				if(inPlace)
+					workload.SubmitInPlace(m_Renderer);
+				else
+					workload.Submit(m_Renderer);
+				std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+
+				uint32 frameDraws = 0;
+				uint32 frameBatches = 0;
+				this->RenderLayer(0);
+				if(hasBackground)
+				{
+					frameDraws += m_Renderer->GetLastDrawCount();
+					frameBatches += m_Renderer->GetLastBatchCount();
+				}
+
+				this->RenderLayer(1);
+				if(hasForeground)
+				{
+					frameDraws += m_Renderer->GetLastDrawCount();
+					frameBatches += m_Renderer->GetLastBatchCount();
+				}
+				std::chrono::high_resolution_clock::time_point rendered = std::chrono::high_resolution_clock::now();
+
+				if(!measure)
+					continue;
+
+				submitNs	+= std::chrono::duration_cast<std::chrono::nanoseconds>(submitted - start).count();
+				renderNs	+= std::chrono::duration_cast<std::chrono::nanoseconds>(rendered - submitted).count();
+				draws		+= frameDraws;
+				batches		+= frameBatches;
+
+				for(uint8 curtain = 0; curtain < 2; ++curtain)
+				{
+					const FrameArenaStats& arena = m_Renderer->GetLastFrameArenaStats(curtain);
+					arenaAllocations	+= arena.AllocationCnt;
+					arenaBytes			+= arena.BytesUsed;
+				}
+			}
+
+			uint64 sprites = (uint64)result.SpritesPerFrame * frames;
+			if(sprites > 0)
+			{
+				result.SubmitNsPerSprite	= (float32)submitNs / sprites;
+				result.RenderNsPerSprite	= (float32)renderNs / sprites;
+				result.NsPerSprite			= (float32)(submitNs + renderNs) / sprites;
+			}
+
+			result.DrawsPerFrame			= (float32)draws / frames;
+			result.BatchesPerFrame			= (float32)batches / frames;
+			result.ArenaAllocationsPerFrame	= (float32)arenaAllocations / frames;
+			result.ArenaBytesPerFrame		= (uint32)(arenaBytes / frames);
+			if(m_AllocationCounter != NULL)
+				result.AllocationsPerFrame = (float32)(m_AllocationCounter() - allocationsBefore) / frames;
+
+			return true;
+		}
+
+		//JSON string with quotes, backslashes and control characters escaped
+		static void WriteString(FILE* const file, const char* const text)
+		{
+			fputc('"', file);
+			for(const char* c = text; *c != 0; ++c)
+			{
+				if(*c == '"' || *c == '\\')
+				{
+					fputc('\\', file);
+					fputc(*c, file);
+				}
+				else if((uint8)*c < 0x20)
+					fprintf(file, "\\u%04x", (uint32)(uint8)*c);
+				else
+					fputc(*c, file);
+			}
+			fputc('"', file);
+		}
+
+		void CSpriteBenchmark::WriteResult(FILE* const file, const char* const name, const SpriteBenchResult& result)
+		{
+			const SpriteWorkloadParams& params = result.Params;
+			fputs("{\"name\":", file);
+			WriteString(file, name != NULL ? name : "");
+			fprintf(file,	",\"jobs\":%u,\"sprites_per_job\":%u,\"textures\":%u,\"effects\":%u,\"alphas\":%u,"
+							"\"sortedness\":%.3f,\"curtain_share\":%.3f,\"seed\":%u,\"in_place\":%s,\"frames\":%u,\"sprites_per_frame\":%u,"
+							"\"ns_per_sprite\":%.3f,\"submit_ns_per_sprite\":%.3f,\"render_ns_per_sprite\":%.3f,"
+							"\"draws_per_frame\":%.2f,\"batches_per_frame\":%.2f,\"allocations_per_frame\":%.2f,"
+							"\"arena_allocations_per_frame\":%.2f,\"arena_bytes_per_frame\":%u}\n",
+							params.JobCnt, params.SpritesPerJob, params.TextureCnt, params.EffectCnt, params.AlphaCnt,
+							params.Sortedness, params.CurtainShare, params.Seed, result.InPlace ? "true" : "false", result.Frames, result.SpritesPerFrame,
+							result.NsPerSprite, result.SubmitNsPerSprite, result.RenderNsPerSprite,
+							result.DrawsPerFrame, result.BatchesPerFrame, result.AllocationsPerFrame,
+							result.ArenaAllocationsPerFrame, result.ArenaBytesPerFrame);
+		}
+	};
+};
\ No newline at end of file
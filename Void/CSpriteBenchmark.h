@@ -0,0 +1,83 @@
+/*
+	Times a generated workload through CSpriteRenderer frame by
+	frame: submission, sort, fill and draw submission. Lists go to
+	the renderer's device, or to a sink standing in for device
+	and resource manager, a CSpriteNullSink keeps it headless.
+	Results are written as one JSON object per line. The header
+	stays free of Direct3D so headless hosts can build on it.
+*/
+
+#ifndef _CSPRITEBENCHMARK_H_
+#define _CSPRITEBENCHMARK_H_
+
+#include <stdio.h>
+#include <chrono>
+#include "../../Core/Header/Void.h"
+#include "CSpriteWorkload.h"
+#include "CSpriteCommandList.h"
+#include "CSpriteVertexKernel.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		class CSpriteRenderer;
+
+		//heap allocations so far, supplied by a host that counts them in operator new
+		typedef uint64 (*AllocationCounter)();
+
+		struct SpriteBenchResult
+		{
+			SpriteWorkloadParams	Params;
+			bool			InPlace;
+			uint32			Frames;
+			uint32			SpritesPerFrame;
+			float32			NsPerSprite;
+			float32			SubmitNsPerSprite;
+			float32			RenderNsPerSprite;
+			float32			DrawsPerFrame;
+			float32			BatchesPerFrame;
+			float32			AllocationsPerFrame;	//0 without an AllocationCounter
+			float32			ArenaAllocationsPerFrame;
+			uint32			ArenaBytesPerFrame;
+		};
+
+		class CSpriteBenchmark
+		{
+		private:
+			CSpriteRenderer*		m_Renderer;
+			bool				m_OwnsRenderer;
+			AllocationCounter		m_AllocationCounter;
+			CSpriteCommandSink*		m_Sink;
+			CSpriteCommandList		m_List;
+
+		private:
+			//RenderBackground/RenderForeground, or build and execute into the sink
+			void RenderLayer(const uint8 curtain);
+
+		public:
+			CSpriteBenchmark();
+			~CSpriteBenchmark();
+
+			//without a sink the renderer executes on its device and needs its resource manager
+			//a headless renderer, initialized without device, needs a sink
+			void Initialize(CSpriteRenderer* const renderer, AllocationCounter allocationCounter = NULL, CSpriteCommandSink* const sink = NULL);
+
+			//creates and owns a renderer without device, the sink is required
+			bool InitializeHeadless(const float32 width, const float32 height, const SpriteRenderMode mode, const SpriteVertexFormat format, AllocationCounter allocationCounter, CSpriteCommandSink* const sink);
+
+			//releases an owned renderer, a renderer passed to Initialize stays with the caller
+			void Release();
+
+			//warmup frames are rendered but not measured, inPlace builds the jobs in frame memory
+			bool Run(CSpriteWorkload& workload, const uint32 frames, const uint32 warmupFrames, const bool inPlace, SpriteBenchResult& result);
+
+			//one line per result, name tags the run for the tracking side and is escaped
+			static void WriteResult(FILE* const file, const char* const name, const SpriteBenchResult& result);
+
+			inline CSpriteRenderer* GetRenderer() const	{ return m_Renderer; }
+		};
+	};
+};
+
+#endif
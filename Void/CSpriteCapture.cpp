@@ -0,0 +1,293 @@
+#include "../Header/CSpriteCapture.h"
+#include "../Header/CSpriteRenderer.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteCaptureWriter::CSpriteCaptureWriter()
+			:	m_File(NULL),
+				m_LayerCnt(0)
+		{
+		}
+
+		CSpriteCaptureWriter::~CSpriteCaptureWriter()
+		{
+			this->Close();
+		}
+
+		bool CSpriteCaptureWriter::Open(const char* const path, const float32 screenWidth, const float32 screenHeight)
+		{
+			this->Close();
+
+			m_File = fopen(path, "wb");
+			if(m_File == NULL)
+			{
+				DEBUG_MSG("Open Capture File Failed. [CSpriteCaptureWriter::Open]");
+				return false;
+			}
+
+			SpriteCaptureHeader header;
+			header.Magic		= SPRITECAPTURE_MAGIC;
+			header.Version		= SPRITECAPTURE_VERSION;
+			header.SpriteSize	= sizeof(RenderJob_Sprite::Sprite);
+			header.ScreenWidth	= screenWidth;
+			header.ScreenHeight	= screenHeight;
+			if(fwrite(&header, sizeof(SpriteCaptureHeader), 1, m_File) != 1)
+			{
+				DEBUG_MSG("Write Capture Header Failed. [CSpriteCaptureWriter::Open]");
+				this->Close();
+				return false;
+			}
+
+			m_LayerCnt = 0;
+			return true;
+		}
+
+		void CSpriteCaptureWriter::Close()
+		{
+			if(m_File != NULL)
+			{
+				fclose(m_File);
+				m_File = NULL;
+			}
+			std::vector<uint8>().swap(m_Record);
+		}
+
+		void CSpriteCaptureWriter::WriteLayer(const uint8 curtain, const std::deque<RenderJob_Sprite* const>& jobQueue, const uint32 firstRetained)
+		{
+			if(m_File == NULL)
+				return;
+
+			uint32 jobCnt = jobQueue.size();
+			uint32 spriteCnt = 0;
+			for(uint32 i = 0; i < jobCnt; ++i)
+				spriteCnt += jobQueue[i]->SpriteCnt;
+
+			//whole record in one write
+			uint32 jobBytes = jobCnt * sizeof(SpriteCaptureJob);
+			uint32 spriteBytes = spriteCnt * sizeof(RenderJob_Sprite::Sprite);
+			m_Record.resize(sizeof(SpriteCaptureLayer) + jobBytes + spriteBytes);
+
+			SpriteCaptureLayer* layer = (SpriteCaptureLayer*)&m_Record[0];
+			layer->Magic		= SPRITECAPTURE_LAYER_MAGIC;
+			layer->Curtain		= curtain;
+			layer->JobCnt		= jobCnt;
+			layer->SpriteCnt	= spriteCnt;
+
+			SpriteCaptureJob* jobs = (SpriteCaptureJob*)&m_Record[sizeof(SpriteCaptureLayer)];
+			uint8* sprites = &m_Record[sizeof(SpriteCaptureLayer) + jobBytes];
+			for(uint32 i = 0; i < jobCnt; ++i)
+			{
+				const RenderJob_Sprite* job = jobQueue[i];
+				jobs[i].SortingKey	= job->SortingKey;
+				jobs[i].FinalAlpha	= job->FinalAlpha;
+				jobs[i].SpriteCnt	= job->SpriteCnt;
+				jobs[i].EffectId	= job->EffectId;
+				jobs[i].TextureId	= job->TextureId;
+				jobs[i].Flags		= (job->IsCurtain ? SPRITECAPTURE_CURTAIN : 0) | (i >= firstRetained ? SPRITECAPTURE_RETAINED : 0);
+				jobs[i].Reserved	= 0;
+
+				uint32 bytes = job->SpriteCnt * sizeof(RenderJob_Sprite::Sprite);
+				if(bytes > 0)
+					memcpy(sprites, job->SpritePtr, bytes);
+				sprites += bytes;
+			}
+
+			if(fwrite(&m_Record[0], m_Record.size(), 1, m_File) != 1)
+			{
+				DEBUG_MSG("Write Capture Layer Failed. [CSpriteCaptureWriter::WriteLayer]");
+				this->Close();
+				return;
+			}
+			++m_LayerCnt;
+		}
+
+		CSpriteCaptureReplay::CSpriteCaptureReplay()
+			:	m_File(NULL),
+				m_Mapping(NULL),
+				m_Data(NULL),
+				m_Size(0)
+		{
+			memset(&m_Header, 0, sizeof(SpriteCaptureHeader));
+		}
+
+		CSpriteCaptureReplay::~CSpriteCaptureReplay()
+		{
+			this->Close();
+		}
+
+		bool CSpriteCaptureReplay::MapFile(const char* const path)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if(file == INVALID_HANDLE_VALUE)
+			{
+				DEBUG_MSG("Open Capture File Failed. [CSpriteCaptureReplay::MapFile]");
+				return false;
+			}
+			m_File = file;
+
+			LARGE_INTEGER size;
+			if(!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(SpriteCaptureHeader))
+			{
+				DEBUG_MSG("Capture File Too Small. [CSpriteCaptureReplay::MapFile]");
+				return false;
+			}
+			m_Size = size.QuadPart;
+
+			m_Mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if(m_Mapping != NULL)
+				m_Data = (const uint8*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+			int file = open(path, O_RDONLY);
+			if(file < 0)
+			{
+				DEBUG_MSG("Open Capture File Failed. [CSpriteCaptureReplay::MapFile]");
+				return false;
+			}
+
+			struct stat info;
+			if(fstat(file, &info) != 0 || info.st_size < (off_t)sizeof(SpriteCaptureHeader))
+			{
+				DEBUG_MSG("Capture File Too Small. [CSpriteCaptureReplay::MapFile]");
+				close(file);
+				return false;
+			}
+			m_Size = info.st_size;
+
+			//the mapping keeps the file open on its own
+			void* data = mmap(NULL, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+			close(file);
+			if(data != MAP_FAILED)
+				m_Data = (const uint8*)data;
+#endif
+			if(m_Data == NULL)
+			{
+				DEBUG_MSG("Map Capture File Failed. [CSpriteCaptureReplay::MapFile]");
+				return false;
+			}
+			return true;
+		}
+
+		void CSpriteCaptureReplay::UnmapFile()
+		{
+#ifdef _WIN32
+			if(m_Data != NULL)
+				UnmapViewOfFile(m_Data);
+			if(m_Mapping != NULL)
+				CloseHandle(m_Mapping);
+			if(m_File != NULL)
+				CloseHandle(m_File);
+#else
+			if(m_Data != NULL)
+				munmap((void*)m_Data, m_Size);
+#endif
+			m_Data		= NULL;
+			m_Mapping	= NULL;
+			m_File		= NULL;
+			m_Size		= 0;
+		}
+
+		bool CSpriteCaptureReplay::Open(const char* const path)
+		{
+			this->Close();
+
+			if(!this->MapFile(path))
+			{
+				this->Close();
+				return false;
+			}
+
+			memcpy(&m_Header, m_Data, sizeof(SpriteCaptureHeader));
+			if(	m_Header.Magic != SPRITECAPTURE_MAGIC || m_Header.Version != SPRITECAPTURE_VERSION ||
+				m_Header.SpriteSize != sizeof(RenderJob_Sprite::Sprite))
+			{
+				DEBUG_MSG("Capture File Not Compatible. [CSpriteCaptureReplay::Open]");
+				this->Close();
+				return false;
+			}
+
+			//a truncated last record (capture not closed) is dropped
+			uint64 offset = sizeof(SpriteCaptureHeader);
+			while(offset + sizeof(SpriteCaptureLayer) <= m_Size)
+			{
+				const SpriteCaptureLayer* layer = (const SpriteCaptureLayer*)(m_Data + offset);
+				uint64 recordSize = sizeof(SpriteCaptureLayer) + (uint64)layer->JobCnt * sizeof(SpriteCaptureJob) + (uint64)layer->SpriteCnt * m_Header.SpriteSize;
+				if(layer->Magic != SPRITECAPTURE_LAYER_MAGIC || offset + recordSize > m_Size)
+					break;
+
+				m_Layers.push_back(offset);
+				offset += recordSize;
+			}
+			return true;
+		}
+
+		void CSpriteCaptureReplay::Close()
+		{
+			this->UnmapFile();
+			m_Layers.clear();
+			m_Jobs.clear();
+		}
+
+		bool CSpriteCaptureReplay::ReplayLayer(CSpriteRenderer* const renderer, const uint32 layer, CSpriteCommandSink* const sink)
+		{
+			if(layer >= m_Layers.size())
+				return false;
+
+			const SpriteCaptureLayer* header = (const SpriteCaptureLayer*)(m_Data + m_Layers[layer]);
+			const SpriteCaptureJob* jobs = (const SpriteCaptureJob*)(header + 1);
+			const RenderJob_Sprite::Sprite* sprites = (const RenderJob_Sprite::Sprite*)(jobs + header->JobCnt);
+
+			//the renderer keeps the pointers until the layer is rendered below
+			m_Jobs.resize(header->JobCnt);
+			for(uint32 i = 0; i < header->JobCnt; ++i)
+			{
+				RenderJob_Sprite& job = m_Jobs[i];
+				job.SortingKey	= jobs[i].SortingKey;
+				job.FinalAlpha	= jobs[i].FinalAlpha;
+				job.SpriteCnt	= jobs[i].SpriteCnt;
+				job.EffectId	= (EffectId)jobs[i].EffectId;
+				job.TextureId	= (TextureId)jobs[i].TextureId;
+				//the layer it was drawn in, even if the flag changed while the job was queued
+				job.IsCurtain	= (header->Curtain != 0);
+
+				//the mapping is read-only, the renderer never writes through SpritePtr
+				job.SpritePtr	= const_cast<RenderJob_Sprite::Sprite*>(sprites);
+				sprites += jobs[i].SpriteCnt;
+
+				//retained jobs are replayed like any other, the draw order stays the same
+				renderer->AddRenderJob(&job, true);
+			}
+
+			if(header->Curtain == 0)
+				renderer->BuildBackground(m_List);
+			else
+				renderer->BuildForeground(m_List);
+			renderer->Execute(m_List, sink);
+			return true;
+		}
+
+		uint32 CSpriteCaptureReplay::ReplayAll(CSpriteRenderer* const renderer, const uint32 loops, CSpriteCommandSink* const sink)
+		{
+			uint32 replayed = 0;
+			for(uint32 loop = 0; loop < loops; ++loop)
+			{
+				for(uint32 i = 0; i < m_Layers.size(); ++i)
+				{
+					if(this->ReplayLayer(renderer, i, sink))
+						++replayed;
+				}
+			}
+			return replayed;
+		}
+	};
+};
\ No newline at end of file
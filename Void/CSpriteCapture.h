@@ -0,0 +1,125 @@
+/*
+	Binary capture of the sprite jobs every Render call draws,
+	and replay of such files. A capture is a file header and one
+	record per Render call: layer header, job records, then the
+	sprites of all jobs back to back. Replay maps the file,
+	points the jobs straight at the mapped sprites and executes
+	the built lists on the device or into a command sink.
+*/
+
+#ifndef _CSPRITECAPTURE_H_
+#define _CSPRITECAPTURE_H_
+
+#include <stdio.h>
+#include <deque>
+#include <vector>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+#include "CSpriteCommandList.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		class CSpriteRenderer;
+
+		#define SPRITECAPTURE_MAGIC			0x43505356	//"VSPC"
+		#define SPRITECAPTURE_LAYER_MAGIC	0x5259414C	//"LAYR"
+		#define SPRITECAPTURE_VERSION		2
+
+		//job flags
+		#define SPRITECAPTURE_CURTAIN		0x1
+		#define SPRITECAPTURE_RETAINED		0x2
+
+		struct SpriteCaptureHeader
+		{
+			uint32		Magic;
+			uint32		Version;
+			uint32		SpriteSize;		//sizeof(RenderJob_Sprite::Sprite) of the capturing build
+			float32		ScreenWidth;
+			float32		ScreenHeight;
+		};
+
+		struct SpriteCaptureLayer
+		{
+			uint32		Magic;
+			uint32		Curtain;
+			uint32		JobCnt;
+			uint32		SpriteCnt;
+		};
+
+		//fixed width fields without padding, every byte written to the file is set
+		struct SpriteCaptureJob
+		{
+			uint64		SortingKey;
+			float32		FinalAlpha;
+			uint32		SpriteCnt;
+			uint32		EffectId;
+			uint32		TextureId;
+			uint32		Flags;
+			uint32		Reserved;	//0
+		};
+		static_assert(sizeof(SpriteCaptureJob) == 32, "SpriteCaptureJob has to be 32 bytes without padding");
+
+		class CSpriteCaptureWriter
+		{
+		private:
+			FILE*				m_File;
+			std::vector<uint8>		m_Record;
+			uint32				m_LayerCnt;
+
+		public:
+			CSpriteCaptureWriter();
+			~CSpriteCaptureWriter();
+
+			bool Open(const char* const path, const float32 screenWidth, const float32 screenHeight);
+			void Close();
+
+			//jobs from firstRetained on are the layer's retained jobs
+			void WriteLayer(const uint8 curtain, const std::deque<RenderJob_Sprite* const>& jobQueue, const uint32 firstRetained);
+
+			inline bool IsOpen() const		{ return m_File != NULL; }
+			inline uint32 GetLayerCount() const	{ return m_LayerCnt; }
+		};
+
+		class CSpriteCaptureReplay
+		{
+		private:
+			//file and mapping handles on windows, posix keeps nothing but the mapped view
+			void*				m_File;
+			void*				m_Mapping;
+			const uint8*			m_Data;
+			uint64				m_Size;
+			SpriteCaptureHeader		m_Header;
+
+			//byte offset of every layer record
+			std::vector<uint64>		m_Layers;
+			std::vector<RenderJob_Sprite>	m_Jobs;
+			CSpriteCommandList		m_List;
+
+		private:
+			bool MapFile(const char* const path);
+			void UnmapFile();
+
+		public:
+			CSpriteCaptureReplay();
+			~CSpriteCaptureReplay();
+
+			//maps the file read-only and indexes its layers
+			bool Open(const char* const path);
+			void Close();
+
+			//submits the jobs of one layer with their captured keys, builds it and executes the list
+			//into sink, NULL executes on the renderer's device like RenderBackground/RenderForeground
+			bool ReplayLayer(CSpriteRenderer* const renderer, const uint32 layer, CSpriteCommandSink* const sink = NULL);
+
+			//every layer in order, loops times, returns the layers replayed
+			uint32 ReplayAll(CSpriteRenderer* const renderer, const uint32 loops, CSpriteCommandSink* const sink = NULL);
+
+			inline uint32 GetLayerCount() const				{ return m_Layers.size(); }
+			inline const SpriteCaptureHeader& GetHeader() const	{ return m_Header; }
+		};
+	};
+};
+
+#endif
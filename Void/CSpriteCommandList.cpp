@@ -0,0 +1,279 @@
+#include "../Header/CSpriteCommandList.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteCommandList::CSpriteCommandList()
+			:	m_DrawCnt(0),
+				m_UploadBytes(0),
+				m_StreamInRing(false),
+				m_RingElement(0),
+				m_SpriteSize(0),
+				m_StreamSpriteCnt(0)
+		{
+			memset(&m_Info, 0, sizeof(SpriteCommandListInfo));
+		}
+
+		CSpriteCommandList::~CSpriteCommandList()
+		{
+			this->Release();
+		}
+
+		void CSpriteCommandList::Reset(const uint8 curtain, const uint32 spriteSize)
+		{
+			m_Commands.clear();
+			m_DrawCnt			= 0;
+			m_UploadBytes		= 0;
+			m_StreamInRing		= false;
+			m_RingElement		= 0;
+			m_SpriteSize		= spriteSize;
+			m_StreamSpriteCnt	= 0;
+
+			memset(&m_Info, 0, sizeof(SpriteCommandListInfo));
+			m_Info.Curtain = curtain;
+		}
+
+		void CSpriteCommandList::Release()
+		{
+			std::vector<SpriteCommand>().swap(m_Commands);
+			std::vector<uint8>().swap(m_Stream);
+			std::vector<uint8>().swap(m_Upload);
+			m_DrawCnt			= 0;
+			m_UploadBytes		= 0;
+			m_StreamInRing		= false;
+			m_StreamSpriteCnt	= 0;
+		}
+
+		uint8* CSpriteCommandList::ReserveStream(const uint32 spriteCnt)
+		{
+			//the fill overwrites every reserved byte, only growth needs the vector to initialize anything
+			uint32 bytes = spriteCnt * m_SpriteSize;
+			if(m_Stream.size() < bytes)
+				m_Stream.resize(bytes);
+
+			m_StreamSpriteCnt = spriteCnt;
+			m_StreamInRing = false;
+			return spriteCnt > 0 ? &m_Stream[0] : NULL;
+		}
+
+		void CSpriteCommandList::SetRingStream(const uint32 spriteCnt, const uint32 ringElement)
+		{
+			m_StreamSpriteCnt	= spriteCnt;
+			m_StreamInRing		= true;
+			m_RingElement		= ringElement;
+		}
+
+		uint8* CSpriteCommandList::AddUploadRetained(const uint32 firstSlot, const uint32 spriteCnt)
+		{
+			SpriteCommand command = { SPRITECMD_UPLOAD_RETAINED, 0, firstSlot, spriteCnt, m_UploadBytes, 0.0f };
+			m_Commands.push_back(command);
+
+			m_UploadBytes += spriteCnt * m_SpriteSize;
+			if(m_Upload.size() < m_UploadBytes)
+				m_Upload.resize(m_UploadBytes);
+			return &m_Upload[command.Offset];
+		}
+
+		void CSpriteCommandList::AddBindEffect(const EffectId id)
+		{
+			SpriteCommand command = { SPRITECMD_BIND_EFFECT, id, 0, 0, 0, 0.0f };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandList::AddBindTexture(const TextureId id)
+		{
+			SpriteCommand command = { SPRITECMD_BIND_TEXTURE, id, 0, 0, 0, 0.0f };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandList::AddSetAlpha(const float32 alpha)
+		{
+			SpriteCommand command = { SPRITECMD_SET_ALPHA, 0, 0, 0, 0, alpha };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandList::AddDraw(const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			SpriteCommand command = { SPRITECMD_DRAW, 0, firstSprite, spriteCnt, 0, 0.0f };
+			m_Commands.push_back(command);
+			++m_DrawCnt;
+		}
+
+		void CSpriteCommandList::AddDrawRetained(const uint32 firstSlot, const uint32 spriteCnt)
+		{
+			SpriteCommand command = { SPRITECMD_DRAW_RETAINED, 0, firstSlot, spriteCnt, 0, 0.0f };
+			m_Commands.push_back(command);
+			++m_DrawCnt;
+		}
+
+		void CSpriteCommandList::Replay(CSpriteCommandSink* const sink) const
+		{
+			sink->Begin(*this);
+			for(uint32 i = 0; i < m_Commands.size(); ++i)
+			{
+				const SpriteCommand& command = m_Commands[i];
+				switch(command.Type)
+				{
+				case SPRITECMD_BIND_EFFECT:
+					sink->BindEffect((EffectId)command.Id);
+					break;
+				case SPRITECMD_BIND_TEXTURE:
+					sink->BindTexture((TextureId)command.Id);
+					break;
+				case SPRITECMD_SET_ALPHA:
+					sink->SetAlpha(command.Alpha);
+					break;
+				case SPRITECMD_UPLOAD_RETAINED:
+					sink->UploadRetained(command.First, command.Count, &m_Upload[command.Offset]);
+					break;
+				case SPRITECMD_DRAW:
+					sink->Draw(command.First, command.Count);
+					break;
+				case SPRITECMD_DRAW_RETAINED:
+					sink->DrawRetained(command.First, command.Count);
+					break;
+				}
+			}
+			sink->End();
+		}
+
+		CSpriteCommandRecorder::CSpriteCommandRecorder()
+			:	m_List(NULL),
+				m_DrawCnt(0)
+		{
+		}
+
+		CSpriteCommandRecorder::~CSpriteCommandRecorder()
+		{
+		}
+
+		void CSpriteCommandRecorder::Clear()
+		{
+			m_Commands.clear();
+			m_DrawnData.clear();
+			m_DrawCnt = 0;
+		}
+
+		void CSpriteCommandRecorder::Begin(const CSpriteCommandList& list)
+		{
+			m_List = &list;
+		}
+
+		void CSpriteCommandRecorder::BindEffect(const EffectId id)
+		{
+			SpriteCommand command = { SPRITECMD_BIND_EFFECT, id, 0, 0, 0, 0.0f };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandRecorder::BindTexture(const TextureId id)
+		{
+			SpriteCommand command = { SPRITECMD_BIND_TEXTURE, id, 0, 0, 0, 0.0f };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandRecorder::SetAlpha(const float32 alpha)
+		{
+			SpriteCommand command = { SPRITECMD_SET_ALPHA, 0, 0, 0, 0, alpha };
+			m_Commands.push_back(command);
+		}
+
+		void CSpriteCommandRecorder::UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data)
+		{
+			SpriteCommand command = { SPRITECMD_UPLOAD_RETAINED, 0, firstSlot, spriteCnt, 0, 0.0f };
+			m_Commands.push_back(command);
+
+			uint32 spriteSize = m_List->GetSpriteSize();
+			if(m_RetainedData.size() < (firstSlot + spriteCnt) * spriteSize)
+				m_RetainedData.resize((firstSlot + spriteCnt) * spriteSize);
+			memcpy(&m_RetainedData[firstSlot * spriteSize], data, spriteCnt * spriteSize);
+		}
+
+		void CSpriteCommandRecorder::Draw(const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			SpriteCommand command = { SPRITECMD_DRAW, 0, firstSprite, spriteCnt, 0, 0.0f };
+			m_Commands.push_back(command);
+			++m_DrawCnt;
+
+			const uint8* data = m_List->GetStreamData(firstSprite);
+			m_DrawnData.insert(m_DrawnData.end(), data, data + spriteCnt * m_List->GetSpriteSize());
+		}
+
+		void CSpriteCommandRecorder::DrawRetained(const uint32 firstSlot, const uint32 spriteCnt)
+		{
+			SpriteCommand command = { SPRITECMD_DRAW_RETAINED, 0, firstSlot, spriteCnt, 0, 0.0f };
+			m_Commands.push_back(command);
+			++m_DrawCnt;
+
+			//slots never uploaded to this recorder have nothing to show
+			uint32 spriteSize = m_List->GetSpriteSize();
+			if((firstSlot + spriteCnt) * spriteSize <= m_RetainedData.size())
+			{
+				const uint8* data = &m_RetainedData[firstSlot * spriteSize];
+				m_DrawnData.insert(m_DrawnData.end(), data, data + spriteCnt * spriteSize);
+			}
+		}
+
+		void CSpriteCommandRecorder::End()
+		{
+			m_List = NULL;
+		}
+
+		CSpriteNullSink::CSpriteNullSink()
+			:	m_List(NULL),
+				m_DrawCnt(0),
+				m_SpriteCnt(0),
+				m_BytesCopied(0)
+		{
+		}
+
+		CSpriteNullSink::~CSpriteNullSink()
+		{
+		}
+
+		void CSpriteNullSink::Clear()
+		{
+			m_DrawCnt		= 0;
+			m_SpriteCnt		= 0;
+			m_BytesCopied	= 0;
+		}
+
+		void CSpriteNullSink::Copy(const uint8* const data, const uint32 size)
+		{
+			//grows to the largest draw once, later frames copy into warm memory like a ring would
+			if(m_Ring.size() < size)
+				m_Ring.resize(size);
+
+			memcpy(&m_Ring[0], data, size);
+			m_BytesCopied += size;
+		}
+
+		void CSpriteNullSink::Begin(const CSpriteCommandList& list)
+		{
+			m_List = &list;
+		}
+
+		void CSpriteNullSink::UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data)
+		{
+			this->Copy(data, spriteCnt * m_List->GetSpriteSize());
+		}
+
+		void CSpriteNullSink::Draw(const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			this->Copy(m_List->GetStreamData(firstSprite), spriteCnt * m_List->GetSpriteSize());
+			m_SpriteCnt += spriteCnt;
+			++m_DrawCnt;
+		}
+
+		void CSpriteNullSink::DrawRetained(const uint32 firstSlot, const uint32 spriteCnt)
+		{
+			m_SpriteCnt += spriteCnt;
+			++m_DrawCnt;
+		}
+
+		void CSpriteNullSink::End()
+		{
+			m_List = NULL;
+		}
+	};
+};
\ No newline at end of file
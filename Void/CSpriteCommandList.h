@@ -0,0 +1,210 @@
+/*
+	Backend neutral record of one sprite layer: state binds and
+	draw ranges in submission order, plus the vertex payload the
+	draws read from. Building a list does not touch the device,
+	so it can happen on a worker while the device thread replays
+	the previous one into a CSpriteCommandSink.
+*/
+
+#ifndef _CSPRITECOMMANDLIST_H_
+#define _CSPRITECOMMANDLIST_H_
+
+#include <vector>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+#include "CSpriteRenderStats.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		enum SpriteCommandType
+		{
+			SPRITECMD_BIND_EFFECT = 0x0,	//Id
+			SPRITECMD_BIND_TEXTURE,			//Id, for the bound effect
+			SPRITECMD_SET_ALPHA,			//Alpha, for the bound effect
+			SPRITECMD_UPLOAD_RETAINED,		//Count sprites from Offset of the upload payload to retained slot First
+			SPRITECMD_DRAW,					//Count sprites from sprite First of the stream payload
+			SPRITECMD_DRAW_RETAINED			//Count sprites from retained slot First
+		};
+
+		struct SpriteCommand
+		{
+			SpriteCommandType	Type;
+			uint32			Id;
+			uint32			First;
+			uint32			Count;
+			uint32			Offset;
+			float32			Alpha;
+		};
+
+		//what the build saw, handed to the renderer's counters when the list is executed
+		struct SpriteCommandListInfo
+		{
+			uint8			Curtain;
+			uint32			JobCnt;
+			uint32			BatchCnt;
+			uint32			AtlasJobCnt;
+			uint32			RetainedSpriteCnt;
+			uint32			RebuiltSpriteCnt;
+			uint32			ScreenCulledCnt;
+			uint32			ClipCulledCnt;
+			uint32			OverdrawCulledCnt;
+			SpriteFrameStats	BuildStats;
+		};
+
+		class CSpriteCommandList;
+
+		class CSpriteCommandSink
+		{
+		public:
+			virtual ~CSpriteCommandSink() {}
+
+			virtual void Begin(const CSpriteCommandList& list) = 0;
+			virtual void BindEffect(const EffectId id) = 0;
+			virtual void BindTexture(const TextureId id) = 0;
+			virtual void SetAlpha(const float32 alpha) = 0;
+			virtual void UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data) = 0;
+			virtual void Draw(const uint32 firstSprite, const uint32 spriteCnt) = 0;
+			virtual void DrawRetained(const uint32 firstSlot, const uint32 spriteCnt) = 0;
+			virtual void End() = 0;
+		};
+
+		class CSpriteCommandList
+		{
+		private:
+			std::vector<SpriteCommand>	m_Commands;
+			uint32				m_DrawCnt;
+
+			//streamed sprites in draw order, and rebuilt retained regions
+			//both only grow, the bytes in use are tracked so a reset never touches them
+			std::vector<uint8>		m_Stream;
+			std::vector<uint8>		m_Upload;
+			uint32				m_UploadBytes;
+
+			//the stream went straight into the device's ring at m_RingElement instead of m_Stream
+			bool				m_StreamInRing;
+			uint32				m_RingElement;
+
+			//bytes per sprite in both payloads, depends on the renderer's mode and vertex format
+			uint32				m_SpriteSize;
+			uint32				m_StreamSpriteCnt;
+
+			SpriteCommandListInfo		m_Info;
+
+		public:
+			CSpriteCommandList();
+			~CSpriteCommandList();
+
+			//keeps the memory of earlier frames
+			void Reset(const uint8 curtain, const uint32 spriteSize);
+			void Release();
+
+			//spriteCnt sprites worth of stream payload, replaces what was reserved before
+			uint8* ReserveStream(const uint32 spriteCnt);
+
+			//the renderer filled spriteCnt sprites into its ring itself, only its device can execute the list then
+			void SetRingStream(const uint32 spriteCnt, const uint32 ringElement);
+
+			//payload for a retained region, written right away and uploaded on replay
+			uint8* AddUploadRetained(const uint32 firstSlot, const uint32 spriteCnt);
+
+			void AddBindEffect(const EffectId id);
+			void AddBindTexture(const TextureId id);
+			void AddSetAlpha(const float32 alpha);
+			void AddDraw(const uint32 firstSprite, const uint32 spriteCnt);
+			void AddDrawRetained(const uint32 firstSlot, const uint32 spriteCnt);
+
+			//the list is not changed and can be replayed any number of times
+			void Replay(CSpriteCommandSink* const sink) const;
+
+			inline const uint8* GetStreamData(const uint32 sprite) const
+			{
+				return &m_Stream[sprite * m_SpriteSize];
+			}
+
+			inline bool IsEmpty() const								{ return m_Commands.empty(); }
+			inline uint32 GetCommandCount() const					{ return m_Commands.size(); }
+			inline uint32 GetDrawCount() const						{ return m_DrawCnt; }
+			inline const SpriteCommand& GetCommand(const uint32 index) const	{ return m_Commands[index]; }
+			inline uint32 GetSpriteSize() const						{ return m_SpriteSize; }
+			inline uint32 GetStreamSpriteCount() const				{ return m_StreamSpriteCnt; }
+			inline uint32 GetUploadBytes() const					{ return m_UploadBytes; }
+			inline bool IsStreamInRing() const						{ return m_StreamInRing; }
+			inline uint32 GetRingElement() const					{ return m_RingElement; }
+			inline SpriteCommandListInfo& GetInfo()					{ return m_Info; }
+			inline const SpriteCommandListInfo& GetInfo() const		{ return m_Info; }
+		};
+
+		//keeps every replayed command and the payload of every draw, stands in for the device in tests and tools
+		//retained uploads land in a slot copy like the device's retained buffer, retained draws are read from it
+		class CSpriteCommandRecorder : public CSpriteCommandSink
+		{
+		private:
+			const CSpriteCommandList*	m_List;
+			std::vector<SpriteCommand>	m_Commands;
+			std::vector<uint8>		m_DrawnData;
+			std::vector<uint8>		m_RetainedData;
+			uint32				m_DrawCnt;
+
+		public:
+			CSpriteCommandRecorder();
+			virtual ~CSpriteCommandRecorder();
+
+			//forgets commands and drawn data, retained slots stay uploaded like on the device
+			void Clear();
+
+			virtual void Begin(const CSpriteCommandList& list);
+			virtual void BindEffect(const EffectId id);
+			virtual void BindTexture(const TextureId id);
+			virtual void SetAlpha(const float32 alpha);
+			virtual void UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data);
+			virtual void Draw(const uint32 firstSprite, const uint32 spriteCnt);
+			virtual void DrawRetained(const uint32 firstSlot, const uint32 spriteCnt);
+			virtual void End();
+
+			inline const std::vector<SpriteCommand>& GetCommands() const	{ return m_Commands; }
+			inline const std::vector<uint8>& GetRetainedData() const		{ return m_RetainedData; }
+			inline const std::vector<uint8>& GetDrawnData() const			{ return m_DrawnData; }
+			inline uint32 GetDrawCount() const								{ return m_DrawCnt; }
+		};
+
+		//drops every command, payloads are copied the way the device ring would take them
+		//stands in for the device where only the cost of building lists is of interest
+		class CSpriteNullSink : public CSpriteCommandSink
+		{
+		private:
+			const CSpriteCommandList*	m_List;
+			std::vector<uint8>		m_Ring;
+			uint32				m_DrawCnt;
+			uint32				m_SpriteCnt;
+			uint64				m_BytesCopied;
+
+		private:
+			void Copy(const uint8* const data, const uint32 size);
+
+		public:
+			CSpriteNullSink();
+			virtual ~CSpriteNullSink();
+
+			void Clear();
+
+			virtual void Begin(const CSpriteCommandList& list);
+			virtual void BindEffect(const EffectId id)			{}
+			virtual void BindTexture(const TextureId id)		{}
+			virtual void SetAlpha(const float32 alpha)			{}
+			virtual void UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data);
+			virtual void Draw(const uint32 firstSprite, const uint32 spriteCnt);
+			virtual void DrawRetained(const uint32 firstSlot, const uint32 spriteCnt);
+			virtual void End();
+
+			//summed since the last Clear
+			inline uint32 GetDrawCount() const		{ return m_DrawCnt; }
+			inline uint32 GetSpriteCount() const	{ return m_SpriteCnt; }
+			inline uint64 GetBytesCopied() const	{ return m_BytesCopied; }
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "../Header/CSpriteCuller.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteCuller::CSpriteCuller()
+			:	m_ScreenWidth(0.0f),
+				m_ScreenHeight(0.0f),
+				m_ScreenCull(true),
+				m_OverdrawCull(false),
+				m_Layer(0),
+				m_TilesX(0),
+				m_TilesY(0),
+				m_SurvivorCnt(0),
+				m_ScreenCulledCnt(0),
+				m_ClipCulledCnt(0),
+				m_OverdrawCulledCnt(0)
+		{
+			m_HasClipRect[0] = false;
+			m_HasClipRect[1] = false;
+		}
+
+		CSpriteCuller::~CSpriteCuller()
+		{
+			this->Release();
+		}
+
+		void CSpriteCuller::Initialize(const float32 screenWidth, const float32 screenHeight)
+		{
+			m_ScreenWidth	= screenWidth;
+			m_ScreenHeight	= screenHeight;
+			m_TilesX		= ((uint32)screenWidth + SPRITECULL_TILE_SIZE - 1) / SPRITECULL_TILE_SIZE;
+			m_TilesY		= ((uint32)screenHeight + SPRITECULL_TILE_SIZE - 1) / SPRITECULL_TILE_SIZE;
+			m_CoveredTiles.assign(m_TilesX * m_TilesY, 0);
+		}
+
+		void CSpriteCuller::Release()
+		{
+			std::vector<RenderJob_Sprite::Sprite>().swap(m_Survivors);
+			std::vector<uint8>().swap(m_Keep);
+			std::vector<uint8>().swap(m_CoveredTiles);
+			m_OpaqueTextures.clear();
+			m_OpaqueEffects.clear();
+			m_HasClipRect[0]	= false;
+			m_HasClipRect[1]	= false;
+			m_SurvivorCnt		= 0;
+		}
+
+		void CSpriteCuller::SetStages(const bool screenCull, const bool overdrawCull)
+		{
+			m_ScreenCull	= screenCull;
+			m_OverdrawCull	= overdrawCull;
+		}
+
+		void CSpriteCuller::SetClipRect(const uint8 curtain, const CVector2& min, const CVector2& max)
+		{
+			m_ClipRects[curtain].MinX	= min.X;
+			m_ClipRects[curtain].MinY	= min.Y;
+			m_ClipRects[curtain].MaxX	= max.X;
+			m_ClipRects[curtain].MaxY	= max.Y;
+			m_HasClipRect[curtain]		= true;
+		}
+
+		void CSpriteCuller::ClearClipRect(const uint8 curtain)
+		{
+			m_HasClipRect[curtain] = false;
+		}
+
+		void CSpriteCuller::SetTextureOpaque(const TextureId id, const bool opaque)
+		{
+			if(id >= m_OpaqueTextures.size())
+				m_OpaqueTextures.resize(id + 1, false);
+
+			m_OpaqueTextures[id] = opaque;
+		}
+
+		void CSpriteCuller::SetEffectOpaque(const EffectId id, const bool opaque)
+		{
+			if(id >= m_OpaqueEffects.size())
+				m_OpaqueEffects.resize(id + 1, false);
+
+			m_OpaqueEffects[id] = opaque;
+		}
+
+		void CSpriteCuller::Begin(const uint8 curtain, const uint32 maxSprites, const bool keepCoverage)
+		{
+			m_Layer			= curtain;
+			m_SurvivorCnt	= 0;
+			if(m_Survivors.size() < maxSprites)
+				m_Survivors.resize(maxSprites);
+
+			if(m_OverdrawCull && !keepCoverage && !m_CoveredTiles.empty())
+				memset(&m_CoveredTiles[0], 0, m_CoveredTiles.size());
+
+			m_ScreenCulledCnt	= 0;
+			m_ClipCulledCnt		= 0;
+			m_OverdrawCulledCnt	= 0;
+		}
+
+		void CSpriteCuller::CullJob(const RenderJob_Sprite* const job, const bool keepAll, const RenderJob_Sprite::Sprite*& sprites, uint32& spriteCnt)
+		{
+			sprites		= job->SpritePtr;
+			spriteCnt	= job->SpriteCnt;
+
+			bool clip = m_HasClipRect[m_Layer];
+			bool occluder = m_OverdrawCull && this->IsOccluder(job);
+			if(!occluder && (keepAll || (!m_ScreenCull && !clip && !m_OverdrawCull)))
+				return;
+
+			//back to front, a sprite may only be hidden by the ones after it
+			m_Keep.resize(spriteCnt);
+			uint32 culledCnt = 0;
+			for(int32 i = spriteCnt - 1; i >= 0; --i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+
+				CullRect rect;
+				rect.MinX = sprite.PositionMin.X < sprite.PositionMax.X ? sprite.PositionMin.X : sprite.PositionMax.X;
+				rect.MaxX = sprite.PositionMin.X < sprite.PositionMax.X ? sprite.PositionMax.X : sprite.PositionMin.X;
+				rect.MinY = sprite.PositionMin.Y < sprite.PositionMax.Y ? sprite.PositionMin.Y : sprite.PositionMax.Y;
+				rect.MaxY = sprite.PositionMin.Y < sprite.PositionMax.Y ? sprite.PositionMax.Y : sprite.PositionMin.Y;
+
+				bool keep = true;
+				if(!keepAll)
+				{
+					if(m_ScreenCull && (rect.MaxX <= 0.0f || rect.MinX >= m_ScreenWidth || rect.MaxY <= 0.0f || rect.MinY >= m_ScreenHeight))
+					{
+						++m_ScreenCulledCnt;
+						keep = false;
+					}
+					else if(clip && (	rect.MaxX <= m_ClipRects[m_Layer].MinX || rect.MinX >= m_ClipRects[m_Layer].MaxX ||
+										rect.MaxY <= m_ClipRects[m_Layer].MinY || rect.MinY >= m_ClipRects[m_Layer].MaxY))
+					{
+						++m_ClipCulledCnt;
+						keep = false;
+					}
+					else if(m_OverdrawCull && this->IsCovered(rect))
+					{
+						++m_OverdrawCulledCnt;
+						keep = false;
+					}
+				}
+
+				if(keep && occluder)
+					this->Cover(rect);
+
+				m_Keep[i] = keep;
+				culledCnt += keep ? 0 : 1;
+			}
+
+			if(culledCnt == 0)
+				return;
+
+			//compact the survivors, order within the job is kept
+			RenderJob_Sprite::Sprite* survivors = &m_Survivors[m_SurvivorCnt];
+			uint32 survivorCnt = 0;
+			for(uint32 i = 0; i < spriteCnt; ++i)
+			{
+				if(m_Keep[i])
+					survivors[survivorCnt++] = sprites[i];
+			}
+
+			m_SurvivorCnt	+= survivorCnt;
+			sprites			= survivors;
+			spriteCnt		= survivorCnt;
+		}
+
+		bool CSpriteCuller::IsOccluder(const RenderJob_Sprite* const job) const
+		{
+			//a blending effect lets what is behind show through even with opaque texels
+			return	job->FinalAlpha >= 1.0f &&
+					job->TextureId < m_OpaqueTextures.size() && m_OpaqueTextures[job->TextureId] &&
+					job->EffectId < m_OpaqueEffects.size() && m_OpaqueEffects[job->EffectId];
+		}
+
+		bool CSpriteCuller::IsCovered(const CullRect& rect) const
+		{
+			//only the part on screen has to be hidden
+			float32 minX = rect.MinX > 0.0f ? rect.MinX : 0.0f;
+			float32 minY = rect.MinY > 0.0f ? rect.MinY : 0.0f;
+			float32 maxX = rect.MaxX < m_ScreenWidth ? rect.MaxX : m_ScreenWidth;
+			float32 maxY = rect.MaxY < m_ScreenHeight ? rect.MaxY : m_ScreenHeight;
+			if(maxX <= minX || maxY <= minY)
+				return false;
+
+			//every tile the rect touches
+			uint32 tileX0 = (uint32)(minX / SPRITECULL_TILE_SIZE);
+			uint32 tileY0 = (uint32)(minY / SPRITECULL_TILE_SIZE);
+			uint32 tileX1 = (uint32)ceilf(maxX / SPRITECULL_TILE_SIZE) - 1;
+			uint32 tileY1 = (uint32)ceilf(maxY / SPRITECULL_TILE_SIZE) - 1;
+			if(tileX1 >= m_TilesX)
+				tileX1 = m_TilesX - 1;
+			if(tileY1 >= m_TilesY)
+				tileY1 = m_TilesY - 1;
+
+			for(uint32 y = tileY0; y <= tileY1; ++y)
+			{
+				const uint8* row = &m_CoveredTiles[y * m_TilesX];
+				for(uint32 x = tileX0; x <= tileX1; ++x)
+				{
+					if(row[x] == 0)
+						return false;
+				}
+			}
+			return true;
+		}
+
+		void CSpriteCuller::Cover(const CullRect& rect)
+		{
+			//only tiles lying completely inside the rect, the last row and column end at the screen edge
+			int32 tileX0 = rect.MinX > 0.0f ? (int32)ceilf(rect.MinX / SPRITECULL_TILE_SIZE) : 0;
+			int32 tileY0 = rect.MinY > 0.0f ? (int32)ceilf(rect.MinY / SPRITECULL_TILE_SIZE) : 0;
+			int32 tileX1 = rect.MaxX >= m_ScreenWidth ? (int32)m_TilesX - 1 : (int32)floorf(rect.MaxX / SPRITECULL_TILE_SIZE) - 1;
+			int32 tileY1 = rect.MaxY >= m_ScreenHeight ? (int32)m_TilesY - 1 : (int32)floorf(rect.MaxY / SPRITECULL_TILE_SIZE) - 1;
+
+			for(int32 y = tileY0; y <= tileY1; ++y)
+			{
+				uint8* row = &m_CoveredTiles[y * m_TilesX];
+				for(int32 x = tileX0; x <= tileX1; ++x)
+					row[x] = 1;
+			}
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+	Rejects sprites before they are entered into the vertexbuffer.
+	Stage one drops sprites outside the screen, stage two those
+	outside the layer's clip rect. The optional third stage drops
+	sprites hidden behind opaque sprites drawn later, tracked on a
+	coarse tile grid. Jobs are fed back to front so coverage only
+	ever comes from sprites drawn on top, a layer built after the
+	one in front of it may keep that layer's coverage.
+*/
+
+#ifndef _CSPRITECULLER_H_
+#define _CSPRITECULLER_H_
+
+#include <vector>
+#include <math.h>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//edge length of a coverage tile in pixels
+		#define SPRITECULL_TILE_SIZE		32
+
+		class CSpriteCuller
+		{
+		private:
+			struct CullRect
+			{
+				float32		MinX;
+				float32		MinY;
+				float32		MaxX;
+				float32		MaxY;
+			};
+
+			float32					m_ScreenWidth;
+			float32					m_ScreenHeight;
+			bool					m_ScreenCull;
+			bool					m_OverdrawCull;
+
+			//indexed by IsCurtain
+			CullRect				m_ClipRects[2];
+			bool					m_HasClipRect[2];
+			uint8					m_Layer;
+
+			//opaque flags per TextureId and EffectId, only consulted by the overdraw stage
+			std::vector<bool>			m_OpaqueTextures;
+			std::vector<bool>			m_OpaqueEffects;
+
+			uint32					m_TilesX;
+			uint32					m_TilesY;
+			std::vector<uint8>			m_CoveredTiles;
+
+			//survivors of partly culled jobs, jobs that keep every sprite are not copied
+			std::vector<RenderJob_Sprite::Sprite>	m_Survivors;
+			uint32					m_SurvivorCnt;
+			std::vector<uint8>			m_Keep;
+
+			uint32					m_ScreenCulledCnt;
+			uint32					m_ClipCulledCnt;
+			uint32					m_OverdrawCulledCnt;
+
+		private:
+			bool IsOccluder(const RenderJob_Sprite* const job) const;
+			bool IsCovered(const CullRect& rect) const;
+			void Cover(const CullRect& rect);
+
+		public:
+			CSpriteCuller();
+			~CSpriteCuller();
+
+			void Initialize(const float32 screenWidth, const float32 screenHeight);
+			void Release();
+
+			//screen stage defaults to on, overdraw stage to off
+			void SetStages(const bool screenCull, const bool overdrawCull);
+
+			//sprites entirely outside are dropped, the rect does not clip the ones crossing it
+			void SetClipRect(const uint8 curtain, const CVector2& min, const CVector2& max);
+			void ClearClipRect(const uint8 curtain);
+
+			//marks textures without transparent texels and effects that draw without blending,
+			//only jobs with both at full alpha occlude
+			void SetTextureOpaque(const TextureId id, const bool opaque);
+			void SetEffectOpaque(const EffectId id, const bool opaque);
+
+			//starts a layer, maxSprites bounds the sprites of all jobs fed afterwards
+			//keepCoverage culls against the coverage left by the layer before, which has to be drawn on top
+			void Begin(const uint8 curtain, const uint32 maxSprites, const bool keepCoverage = false);
+
+			//call in reverse draw order, keepAll jobs are never culled but still occlude
+			void CullJob(const RenderJob_Sprite* const job, const bool keepAll, const RenderJob_Sprite::Sprite*& sprites, uint32& spriteCnt);
+
+			//counters since the last Begin
+			inline uint32 GetScreenCulledCount() const	{ return m_ScreenCulledCnt; }
+			inline uint32 GetClipCulledCount() const	{ return m_ClipCulledCnt; }
+			inline uint32 GetOverdrawCulledCount() const	{ return m_OverdrawCulledCnt; }
+		};
+	};
+};
+
+#endif
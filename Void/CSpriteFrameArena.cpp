@@ -0,0 +1,108 @@
+#include "../Header/CSpriteFrameArena.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteFrameArena::CSpriteFrameArena()
+			:	m_Block(0),
+				m_Offset(0),
+				m_BlockSize(FRAMEARENA_BLOCK_SIZE),
+				m_AllocationCnt(0),
+				m_BytesUsed(0),
+				m_HighWater(0),
+				m_BytesReserved(0)
+		{
+		}
+
+		CSpriteFrameArena::~CSpriteFrameArena()
+		{
+			this->Release();
+		}
+
+		void CSpriteFrameArena::Release()
+		{
+			for(uint32 i = 0; i < m_Blocks.size(); ++i)
+				delete[] m_Blocks[i].Data;
+			m_Blocks.clear();
+
+			m_Block			= 0;
+			m_Offset		= 0;
+			m_AllocationCnt	= 0;
+			m_BytesUsed		= 0;
+			m_BytesReserved	= 0;
+		}
+
+		void* CSpriteFrameArena::Allocate(const uint32 size, const uint32 alignment)
+		{
+			//walk on through the blocks kept from earlier frames, append one once they are used up
+			while(true)
+			{
+				if(m_Block < m_Blocks.size())
+				{
+					ArenaBlock& block = m_Blocks[m_Block];
+					size_t address = (size_t)(block.Data + m_Offset);
+					uint32 padding = (uint32)(((address + alignment - 1) & ~(size_t)(alignment - 1)) - address);
+
+					if(m_Offset + padding + size <= block.Size)
+					{
+						void* memory = block.Data + m_Offset + padding;
+						m_Offset		+= padding + size;
+						m_BytesUsed		+= padding + size;
+						++m_AllocationCnt;
+						if(m_BytesUsed > m_HighWater)
+							m_HighWater = m_BytesUsed;
+						return memory;
+					}
+
+					//rest of the block is wasted for this frame
+					m_BytesUsed += block.Size - m_Offset;
+					++m_Block;
+					m_Offset = 0;
+					continue;
+				}
+
+				ArenaBlock block;
+				block.Size = size + alignment > m_BlockSize ? size + alignment : m_BlockSize;
+				block.Data = new(std::nothrow) uint8[block.Size];
+				if(block.Data == NULL)
+				{
+					DEBUG_MSG("Allocate Block Failed. [CSpriteFrameArena::Allocate]");
+					return NULL;
+				}
+
+				m_Blocks.push_back(block);
+				m_BytesReserved += block.Size;
+			}
+		}
+
+		void CSpriteFrameArena::Reset()
+		{
+			m_Block			= 0;
+			m_Offset		= 0;
+			m_AllocationCnt	= 0;
+			m_BytesUsed		= 0;
+		}
+
+		FrameArenaStats CSpriteFrameArena::GetStats() const
+		{
+			FrameArenaStats stats;
+			stats.AllocationCnt	= m_AllocationCnt;
+			stats.BytesUsed		= m_BytesUsed;
+			stats.HighWater		= m_HighWater;
+			stats.BytesReserved	= m_BytesReserved;
+			stats.BlockCnt		= m_Blocks.size();
+			return stats;
+		}
+
+		bool CSpriteFrameArena::Owns(const void* const memory) const
+		{
+			for(uint32 i = 0; i < m_Blocks.size(); ++i)
+			{
+				if(memory >= m_Blocks[i].Data && memory < m_Blocks[i].Data + m_Blocks[i].Size)
+					return true;
+			}
+			return false;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+	Linear allocator for memory that lives exactly one frame.
+	Allocations bump a pointer through a list of blocks, Reset
+	rewinds to the first block without freeing anything. No
+	destructors are run, only hand out plain data.
+*/
+
+#ifndef _CSPRITEFRAMEARENA_H_
+#define _CSPRITEFRAMEARENA_H_
+
+#include <new>
+#include <vector>
+#include "../../Core/Header/Void.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//size of the first block and of every block added when a frame outgrows the arena
+		#define FRAMEARENA_BLOCK_SIZE		(64 * 1024)
+
+		struct FrameArenaStats
+		{
+			uint32			AllocationCnt;	//since the last Reset
+			uint32			BytesUsed;		//since the last Reset, padding and skipped block tails included
+			uint32			HighWater;		//largest BytesUsed any frame reached
+			uint32			BytesReserved;	//held by all blocks
+			uint32			BlockCnt;
+		};
+
+		class CSpriteFrameArena
+		{
+		private:
+			struct ArenaBlock
+			{
+				uint8*			Data;
+				uint32			Size;
+			};
+
+			std::vector<ArenaBlock>		m_Blocks;
+			uint32				m_Block;
+			uint32				m_Offset;
+			uint32				m_BlockSize;
+
+			uint32				m_AllocationCnt;
+			uint32				m_BytesUsed;
+			uint32				m_HighWater;
+			uint32				m_BytesReserved;
+
+		public:
+			CSpriteFrameArena();
+			~CSpriteFrameArena();
+
+			void Release();
+
+			//alignment has to be a power of two, returns NULL only if a new block can not be allocated
+			void* Allocate(const uint32 size, const uint32 alignment);
+
+			//rewinds to the first block, memory handed out before is reused by the next allocations
+			void Reset();
+
+			FrameArenaStats GetStats() const;
+
+			//true if memory lies in one of the blocks, whether handed out this frame or not
+			bool Owns(const void* const memory) const;
+
+			template<typename T>
+			inline T* AllocateArray(const uint32 count)
+			{
+				return (T*)this->Allocate(count * sizeof(T), alignof(T));
+			}
+
+			//default constructed in place
+			template<typename T>
+			inline T* Construct()
+			{
+				void* memory = this->Allocate(sizeof(T), alignof(T));
+				return memory != NULL ? new(memory) T() : NULL;
+			}
+
+			inline void SetBlockSize(const uint32 blockSize)
+			{
+				m_BlockSize = blockSize > 0 ? blockSize : FRAMEARENA_BLOCK_SIZE;
+			}
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "../Header/CSpriteJobSorter.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteJobSorter::CSpriteJobSorter()
+			:	m_Histograms(8 * 256, 0)
+		{
+		}
+
+		CSpriteJobSorter::~CSpriteJobSorter()
+		{
+			this->Release();
+		}
+
+		void CSpriteJobSorter::Release()
+		{
+			std::vector<SortEntry>().swap(m_Entries);
+			std::vector<SortEntry>().swap(m_Scratch);
+		}
+
+		void CSpriteJobSorter::Sort(const std::deque<RenderJob_Sprite* const>& jobQueue, std::vector<RenderJob_Sprite*>& sortedJobs, const uint64* const keys, std::vector<uint32>* const order)
+		{
+			uint32 count = jobQueue.size();
+			sortedJobs.resize(count);
+			if(order != NULL)
+				order->resize(count);
+			if(count == 0)
+				return;
+
+			//gather keys and count descents on the way
+			m_Entries.resize(count);
+			uint32 descents = 0;
+			for(uint32 i = 0; i < count; ++i)
+			{
+				m_Entries[i].Key	= keys != NULL ? keys[i] : jobQueue[i]->SortingKey;
+				m_Entries[i].Index	= i;
+
+				if(i > 0 && m_Entries[i].Key < m_Entries[i-1].Key)
+					++descents;
+			}
+
+			SortEntry* result = &m_Entries[0];
+			if(descents > 0)
+			{
+				if(count < SPRITESORT_INSERTION_THRESHOLD)
+				{
+					this->InsertionSort(result, count, 0xFFFFFFFF);
+				}
+				else
+				{
+					//queues are mostly sorted from frame to frame, try to get away with a few moves
+					bool sorted = false;
+					if(descents <= count / 32)
+						sorted = this->InsertionSort(result, count, count * 2);
+
+					if(!sorted)
+						result = this->RadixSort(count);
+				}
+			}
+
+			for(uint32 i = 0; i < count; ++i)
+				sortedJobs[i] = jobQueue[result[i].Index];
+
+			if(order != NULL)
+			{
+				for(uint32 i = 0; i < count; ++i)
+					(*order)[i] = result[i].Index;
+			}
+		}
+
+		bool CSpriteJobSorter::InsertionSort(SortEntry* const entries, const uint32 count, const uint32 maxMoves)
+		{
+			uint32 moves = 0;
+			for(uint32 i = 1; i < count; ++i)
+			{
+				SortEntry entry = entries[i];
+				uint32 j = i;
+				while(j > 0 && entries[j-1].Key > entry.Key)
+				{
+					entries[j] = entries[j-1];
+					--j;
+
+					//give up, the array stays a valid (partially sorted) permutation
+					if(++moves > maxMoves)
+					{
+						entries[j] = entry;
+						return false;
+					}
+				}
+				entries[j] = entry;
+			}
+			return true;
+		}
+
+		CSpriteJobSorter::SortEntry* CSpriteJobSorter::RadixSort(const uint32 count)
+		{
+			m_Scratch.resize(count);
+			SortEntry* src = &m_Entries[0];
+			SortEntry* dst = &m_Scratch[0];
+
+			//build all eight byte histograms in one sweep
+			uint32* histograms = &m_Histograms[0];
+			memset(histograms, 0, 8 * 256 * sizeof(uint32));
+			for(uint32 i = 0; i < count; ++i)
+			{
+				uint64 key = src[i].Key;
+				for(uint32 pass = 0; pass < 8; ++pass)
+					++histograms[pass * 256 + ((key >> (pass * 8)) & 0xFF)];
+			}
+
+			for(uint32 pass = 0; pass < 8; ++pass)
+			{
+				uint32* histogram = &histograms[pass * 256];
+				uint32 shift = pass * 8;
+
+				//all keys share this byte, pass would not change the order
+				if(histogram[(src[0].Key >> shift) & 0xFF] == count)
+					continue;
+
+				uint32 offset = 0;
+				for(uint32 bucket = 0; bucket < 256; ++bucket)
+				{
+					uint32 bucketCnt = histogram[bucket];
+					histogram[bucket] = offset;
+					offset += bucketCnt;
+				}
+
+				for(uint32 i = 0; i < count; ++i)
+					dst[histogram[(src[i].Key >> shift) & 0xFF]++] = src[i];
+
+				SortEntry* tmp = src;
+				src = dst;
+				dst = tmp;
+			}
+
+			return src;
+		}
+	};
+};
\ No newline at end of file
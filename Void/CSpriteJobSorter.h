@@ -0,0 +1,53 @@
+/*
+	Sorts sprite render jobs by their 64-bit sorting key.
+	Keys are pulled into a contiguous (key, index) array and
+	radix-sorted, scratch buffers are kept between frames.
+*/
+
+#ifndef _CSPRITEJOBSORTER_H_
+#define _CSPRITEJOBSORTER_H_
+
+#include <deque>
+#include <vector>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//below this count a plain insertion sort beats the radix passes
+		#define SPRITESORT_INSERTION_THRESHOLD	64
+
+		class CSpriteJobSorter
+		{
+		private:
+			struct SortEntry
+			{
+				uint64	Key;
+				uint32	Index;
+			};
+
+			std::vector<SortEntry>			m_Entries;
+			std::vector<SortEntry>			m_Scratch;
+			std::vector<uint32>			m_Histograms;
+
+		private:
+			bool InsertionSort(SortEntry* const entries, const uint32 count, const uint32 maxMoves);
+			SortEntry* RadixSort(const uint32 count);
+
+		public:
+			CSpriteJobSorter();
+			~CSpriteJobSorter();
+
+			void Release();
+
+			//writes the jobs of jobQueue to sortedJobs in ascending key order (stable)
+			//keys replaces the SortingKey of every queued job when given, order receives the queue index of every sorted job
+			void Sort(const std::deque<RenderJob_Sprite* const>& jobQueue, std::vector<RenderJob_Sprite*>& sortedJobs, const uint64* const keys = NULL, std::vector<uint32>* const order = NULL);
+		};
+	};
+};
+
+#endif
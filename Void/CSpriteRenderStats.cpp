@@ -0,0 +1,124 @@
+#include "../Header/CSpriteRenderStats.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteRenderStats::CSpriteRenderStats()
+			:	m_History(SPRITESTATS_HISTORY_SIZE),
+				m_HistoryPos(0),
+				m_HistoryCnt(0),
+				m_BudgetCallback(NULL),
+				m_BudgetContext(NULL)
+		{
+			for(uint32 i = 0; i < SPRITESTAT_COUNT; ++i)
+			{
+				m_Budgets[i] = -1.0f;
+				m_BudgetHits[i] = 0;
+			}
+		}
+
+		CSpriteRenderStats::~CSpriteRenderStats()
+		{
+		}
+
+		void CSpriteRenderStats::Commit(const SpriteFrameStats& frame)
+		{
+			m_History[m_HistoryPos] = frame;
+			m_HistoryPos = (m_HistoryPos + 1) % SPRITESTATS_HISTORY_SIZE;
+			if(m_HistoryCnt < SPRITESTATS_HISTORY_SIZE)
+				++m_HistoryCnt;
+
+			for(uint32 i = 0; i < SPRITESTAT_COUNT; ++i)
+			{
+				if(m_Budgets[i] < 0.0f)
+					continue;
+
+				float32 value = GetField(frame, (SpriteStatField)i);
+				if(value <= m_Budgets[i])
+					continue;
+
+				++m_BudgetHits[i];
+				if(m_BudgetCallback != NULL)
+					m_BudgetCallback(m_BudgetContext, (SpriteStatField)i, value, m_Budgets[i]);
+			}
+		}
+
+		void CSpriteRenderStats::Clear()
+		{
+			m_HistoryPos = 0;
+			m_HistoryCnt = 0;
+			memset(m_BudgetHits, 0, sizeof(m_BudgetHits));
+		}
+
+		float32 CSpriteRenderStats::GetField(const SpriteFrameStats& frame, const SpriteStatField field)
+		{
+			switch(field)
+			{
+			case SPRITESTAT_JOBS_BACKGROUND:		return (float32)frame.JobCnt[0];
+			case SPRITESTAT_JOBS_FOREGROUND:		return (float32)frame.JobCnt[1];
+			case SPRITESTAT_SPRITES_BACKGROUND:		return (float32)frame.SpriteCnt[0];
+			case SPRITESTAT_SPRITES_FOREGROUND:		return (float32)frame.SpriteCnt[1];
+			case SPRITESTAT_DRAWS:					return (float32)frame.DrawCnt;
+			case SPRITESTAT_EFFECT_CHANGES:			return (float32)frame.EffectChanges;
+			case SPRITESTAT_TEXTURE_CHANGES:		return (float32)frame.TextureChanges;
+			case SPRITESTAT_ALPHA_CHANGES:			return (float32)frame.AlphaChanges;
+			case SPRITESTAT_SORT_TIME:				return frame.SortTime;
+			case SPRITESTAT_LOCK_FILL_TIME:			return frame.LockFillTime;
+			case SPRITESTAT_BYTES_UPLOADED:			return (float32)frame.BytesUploaded;
+			default:								return 0.0f;
+			}
+		}
+
+		void CSpriteRenderStats::Accumulate(SpriteFrameStats& frame, const SpriteFrameStats& other)
+		{
+			frame.JobCnt[0]			+= other.JobCnt[0];
+			frame.JobCnt[1]			+= other.JobCnt[1];
+			frame.SpriteCnt[0]		+= other.SpriteCnt[0];
+			frame.SpriteCnt[1]		+= other.SpriteCnt[1];
+			frame.DrawCnt			+= other.DrawCnt;
+			frame.EffectChanges		+= other.EffectChanges;
+			frame.TextureChanges	+= other.TextureChanges;
+			frame.AlphaChanges		+= other.AlphaChanges;
+			frame.SortTime			+= other.SortTime;
+			frame.LockFillTime		+= other.LockFillTime;
+			frame.BytesUploaded		+= other.BytesUploaded;
+		}
+
+		bool CSpriteRenderStats::GetPercentile(const SpriteStatField field, const float32 percentile, float32& value)
+		{
+			if(m_HistoryCnt == 0)
+				return false;
+
+			m_Scratch.resize(m_HistoryCnt);
+			for(uint32 i = 0; i < m_HistoryCnt; ++i)
+				m_Scratch[i] = GetField(m_History[i], field);
+
+			//nearest rank
+			float32 clamped = percentile < 0.0f ? 0.0f : (percentile > 100.0f ? 100.0f : percentile);
+			uint32 rank = (uint32)(clamped / 100.0f * (m_HistoryCnt - 1) + 0.5f);
+			std::nth_element(m_Scratch.begin(), m_Scratch.begin() + rank, m_Scratch.end());
+			value = m_Scratch[rank];
+			return true;
+		}
+
+		bool CSpriteRenderStats::GetFrame(const uint32 frameOffset, SpriteFrameStats& frame) const
+		{
+			if(frameOffset >= m_HistoryCnt)
+				return false;
+
+			frame = m_History[(m_HistoryPos + SPRITESTATS_HISTORY_SIZE - 1 - frameOffset) % SPRITESTATS_HISTORY_SIZE];
+			return true;
+		}
+
+		void CSpriteRenderStats::SetBudget(const SpriteStatField field, const float32 budget)
+		{
+			m_Budgets[field] = budget;
+		}
+
+		void CSpriteRenderStats::ClearBudget(const SpriteStatField field)
+		{
+			m_Budgets[field] = -1.0f;
+		}
+	};
+};
\ No newline at end of file
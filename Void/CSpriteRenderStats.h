@@ -0,0 +1,133 @@
+/*
+	Per frame counters of the sprite renderer. Frames are kept
+	in a fixed ring for percentile queries, budgets call back
+	once per frame for every counter above its threshold.
+	Counting only happens with VOID_SPRITE_STATS defined.
+*/
+
+#ifndef _CSPRITERENDERSTATS_H_
+#define _CSPRITERENDERSTATS_H_
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <string.h>
+#include "../../Core/Header/Void.h"
+
+//statements wrapped in SPRITESTATS vanish unless VOID_SPRITE_STATS is defined
+#ifdef VOID_SPRITE_STATS
+	#define SPRITESTATS(statement)		statement
+#else
+	#define SPRITESTATS(statement)
+#endif
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//frames kept for percentiles
+		#define SPRITESTATS_HISTORY_SIZE	256
+
+		enum SpriteStatField
+		{
+			SPRITESTAT_JOBS_BACKGROUND = 0x0,
+			SPRITESTAT_JOBS_FOREGROUND,
+			SPRITESTAT_SPRITES_BACKGROUND,
+			SPRITESTAT_SPRITES_FOREGROUND,
+			SPRITESTAT_DRAWS,
+			SPRITESTAT_EFFECT_CHANGES,
+			SPRITESTAT_TEXTURE_CHANGES,
+			SPRITESTAT_ALPHA_CHANGES,
+			SPRITESTAT_SORT_TIME,			//milliseconds
+			SPRITESTAT_LOCK_FILL_TIME,		//milliseconds, entering sprites plus vertexbuffer lock to unlock
+			SPRITESTAT_BYTES_UPLOADED,
+			SPRITESTAT_COUNT
+		};
+
+		//jobs and sprites are indexed by IsCurtain, sprites are counted before culling
+		struct SpriteFrameStats
+		{
+			uint32		JobCnt[2];
+			uint32		SpriteCnt[2];
+			uint32		DrawCnt;
+			uint32		EffectChanges;
+			uint32		TextureChanges;
+			uint32		AlphaChanges;
+			float32		SortTime;
+			float32		LockFillTime;
+			uint32		BytesUploaded;
+		};
+
+		typedef void (*SpriteBudgetCallback)(void* const context, const SpriteStatField field, const float32 value, const float32 budget);
+
+		class CSpriteRenderStats
+		{
+		public:
+			typedef std::chrono::high_resolution_clock::time_point TimePoint;
+
+		private:
+			std::vector<SpriteFrameStats>	m_History;
+			uint32				m_HistoryPos;
+			uint32				m_HistoryCnt;
+
+			//negative disables the budget
+			float32				m_Budgets[SPRITESTAT_COUNT];
+			SpriteBudgetCallback		m_BudgetCallback;
+			void*				m_BudgetContext;
+			uint32				m_BudgetHits[SPRITESTAT_COUNT];
+
+			std::vector<float32>		m_Scratch;
+
+		public:
+			CSpriteRenderStats();
+			~CSpriteRenderStats();
+
+			//stores the frame and checks it against the budgets
+			void Commit(const SpriteFrameStats& frame);
+			void Clear();
+
+			static float32 GetField(const SpriteFrameStats& frame, const SpriteStatField field);
+
+			//adds every counter of other to frame
+			static void Accumulate(SpriteFrameStats& frame, const SpriteFrameStats& other);
+
+			//percentile in [0,100] over the frames in the history, false if it is empty
+			bool GetPercentile(const SpriteStatField field, const float32 percentile, float32& value);
+
+			//frameOffset 0 is the last committed frame
+			bool GetFrame(const uint32 frameOffset, SpriteFrameStats& frame) const;
+
+			void SetBudget(const SpriteStatField field, const float32 budget);
+			void ClearBudget(const SpriteStatField field);
+
+			inline void SetBudgetCallback(SpriteBudgetCallback callback, void* const context)
+			{
+				m_BudgetCallback = callback;
+				m_BudgetContext = context;
+			}
+
+			//frames a field went over its budget since the last Clear
+			inline uint32 GetBudgetHits(const SpriteStatField field) const
+			{
+				return m_BudgetHits[field];
+			}
+
+			inline uint32 GetFrameCount() const
+			{
+				return m_HistoryCnt;
+			}
+
+			static inline TimePoint Now()
+			{
+				return std::chrono::high_resolution_clock::now();
+			}
+
+			static inline float32 ElapsedMs(const TimePoint& start)
+			{
+				return std::chrono::duration<float32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+		};
+	};
+};
+
+#endif
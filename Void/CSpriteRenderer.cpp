@@ -1,486 +1,1549 @@
-#include "../Header/CSpriteRenderer.h"
-
-namespace Void
-{
-	namespace Renderer
-	{
-		CSpriteRenderer::CSpriteRenderer()
-			:	m_Device(NULL),
-				m_ResourceManager(NULL),
-				m_VertexDeclaration(NULL),
-				m_VertexBuffer(NULL),
-				m_IndexBuffer(NULL),
-				m_ScreenWidth(0.0f),
-				m_ScreenHeight(0.0f),
-				m_ActiveQueueBackground(0),
-				m_ActiveQueueForeground(0)
-		{
-			m_BackgroundQueueCnt[0]	= 0;
-			m_BackgroundQueueCnt[1]	= 0;
-			m_ForegroundQueueCnt[0]	= 0;
-			m_ForegroundQueueCnt[1]	= 0;
-		}
-
-		CSpriteRenderer::~CSpriteRenderer()
-		{
-			this->Release();
-		}
-
-		void CSpriteRenderer::Release()
-		{
-			SAFE_RELEASE(m_VertexBuffer);
-			SAFE_RELEASE(m_IndexBuffer);
-			SAFE_RELEASE(m_VertexDeclaration);
-			m_JobQueueBackground[0].clear();
-			m_JobQueueBackground[1].clear();
-			m_JobQueueForeground[0].clear();
-			m_JobQueueForeground[1].clear();
-			m_Device				= NULL;
-			m_ScreenWidth			= 0.0f;
-			m_ScreenHeight			= 0.0f;
-			m_BackgroundQueueCnt[0]	= 0;
-			m_BackgroundQueueCnt[1]	= 0;
-			m_ForegroundQueueCnt[0]	= 0;
-			m_ForegroundQueueCnt[1]	= 0;
-		}
-
-		bool CSpriteRenderer::Initialize(IDirect3DDevice9* const device, const float32 width, const float32 height)
-		{
-			m_Device = device;
-			m_ScreenWidth = width;
-			m_ScreenHeight = height;
-
-			const D3DVERTEXELEMENT9 decl[3] = 
-			{
-			  {0, 0,  D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
-			  {0, 4*3, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},
-			  D3DDECL_END()
-			};
-			HRESULT hr = m_Device->CreateVertexDeclaration(decl, &m_VertexDeclaration);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("CreateVertexDeclaration Failed. [CSpriteRenderer::Initialize]");
-				return false;
-			}
-
-			hr = m_Device->CreateVertexBuffer(	MAX_NUM_SPRITES * sizeof(Vertex_Sprite) * 4,
-												D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
-												NULL,
-												D3DPOOL_DEFAULT,
-												&m_VertexBuffer,
-												NULL);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("CreateVertexBuffer Failed. [CSpriteRenderer::Initialize]");
-				return false;
-			}
-			
-			hr = m_Device->CreateIndexBuffer(	MAX_NUM_SPRITES * sizeof(uint16) * 6,
-												D3DUSAGE_WRITEONLY,
-												D3DFMT_INDEX16,
-												D3DPOOL_MANAGED,
-												&m_IndexBuffer,
-												NULL);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("CreateIndexBuffer Failed. [CSpriteRenderer::Initialize]");
-				return false;
-			}
-
-			uint16* pIndices;
-			hr = m_IndexBuffer->Lock(0, 0, (void**)&pIndices, NULL);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Lock IndexBuffer Failed. [CSpriteRenderer::Initialize]");
-				return false;
-			}
-
-			uint32 j = 0;
-			uint32 k = 0;
-			for(uint32 i = 0; i < MAX_NUM_SPRITES; ++i)
-			{
-				//1st tri
-				pIndices[j+0] = k+0;
-				pIndices[j+1] = k+1;
-				pIndices[j+2] = k+3;
-
-				//2nd tri
-				pIndices[j+3] = k+3;
-				pIndices[j+4] = k+1;
-				pIndices[j+5] = k+2;
-
-				j += 6;
-				k += 4;
-			}
-			hr = m_IndexBuffer->Unlock();
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Unlock IndexBuffer Failed. [CSpriteRenderer::Initialize]");
-				return false;
-			}
-
-			m_SpriteProjMatrix.OrthoLH(m_ScreenWidth, m_ScreenHeight, -10000.0f, 10000.0f);
-			m_SpriteViewMatrix.LookAtLH(CVector3(m_ScreenWidth/2, m_ScreenHeight/2, -1.0f),
-										CVector3(m_ScreenWidth/2, m_ScreenHeight/2, 0.0f),
-										CVector3(0.0f, 1.0f, 0.0f));
-			m_SpriteWorldMatrix.Identity();
-
-			return true;
-		}
-
-		void CSpriteRenderer::AddRenderJob(RenderJob_Sprite* const job)
-		{
-			if(job->SpriteCnt == 0)
-				return;
-
-			if(!job->IsCurtain)
-			{
-				if((m_BackgroundQueueCnt[m_ActiveQueueBackground] + job->SpriteCnt) < MAX_NUM_SPRITES)
-				{
-					job->RebuildSortingKey();
-					m_BackgroundQueueCnt[m_ActiveQueueBackground] += job->SpriteCnt;
-					m_JobQueueBackground[m_ActiveQueueBackground].push_back(job);
-				}
-				else
-				{
-					DEBUG_MSG("Exceeded MAX_NUM_SPRITES. [CSpriteRenderer::AddRenderJob]");
-				}
-			}
-			else
-			{
-				if((m_ForegroundQueueCnt[m_ActiveQueueForeground] + job->SpriteCnt) < MAX_NUM_SPRITES)
-				{
-					job->RebuildSortingKey();
-					m_ForegroundQueueCnt[m_ActiveQueueForeground] += job->SpriteCnt;
-					m_JobQueueForeground[m_ActiveQueueForeground].push_back(job);
-				}
-				else
-				{
-					DEBUG_MSG("Exceeded MAX_NUM_SPRITES. [CSpriteRenderer::AddRenderJob]");
-				}
-			}
-		}
-
-		void CSpriteRenderer::Render(std::deque<RenderJob_Sprite* const>& jobQueue)
-		{
-			if(jobQueue.empty())
-				return;
-
-			std::sort(jobQueue.begin(), jobQueue.end(), RenderJob_Sprite::Compare);
-
-			//prepare vertexbuffer
-			Vertex_Sprite* vertices;
-			HRESULT hr = m_VertexBuffer->Lock(0, 0, (void**)&vertices, D3DLOCK_DISCARD);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Lock VertexBuffer Failed. [CSpriteRenderer::Render]");
-			}
-
-			//enter sprites into vertexbuffer
-			uint16 currentVertexPos = 0;
-			uint16 size = jobQueue.size();
-			for(uint16 i = 0; i < size; ++i)
-			{
-				this->EnterSpriteIntoBuffer(&vertices[currentVertexPos], jobQueue[i]);
-				currentVertexPos += 4 * jobQueue[i]->SpriteCnt;
-			}			
-
-			hr = m_VertexBuffer->Unlock();
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Unlock VertexBuffer Failed. [CSpriteRenderer::Render]");
-			}
-			
-			//do render
-			hr = m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(Vertex_Sprite));
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::Render]");
-			}
-
-			hr = m_Device->SetVertexDeclaration(m_VertexDeclaration);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetVertexDeclaration Failed. [CSpriteRenderer::Render]");
-			}
-
-			hr = m_Device->SetIndices(m_IndexBuffer);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetIndices Failed. [CSpriteRenderer::Render]");
-			}
-			
-			TextureId currentTexId = TextureId_Default;
-			EffectId currentFxId = EffectId_Default;
-			float32 currentFAlpha = -1.0f;
-
-			CEffect* effect			= NULL;
- 			uint16 minVertexIndex	= 0;
- 			uint16 startIndex		= 0;
-			
-			for(uint16 i = 0; i < size; ++i)
-			{
-				bool newFx = (jobQueue[i]->EffectId != currentFxId);
-				if(newFx)
-				{
-					currentFxId = jobQueue[i]->EffectId;
-					effect = m_ResourceManager->GetEffectById(currentFxId);
-					effect->SetMatrix("matProj", &m_SpriteProjMatrix);
-					effect->SetMatrix("matView", &m_SpriteViewMatrix);
-				}
-				
-				bool newTex = (jobQueue[i]->TextureId != currentTexId);
-				if(newTex)
-					currentTexId = jobQueue[i]->TextureId;
-
-				if(newFx || newTex)
-					effect->SetTexture("diffuseTexture", m_ResourceManager->GetTextureById(currentTexId));
-
-				if(jobQueue[i]->FinalAlpha != currentFAlpha || newFx)
-				{
-					currentFAlpha = jobQueue[i]->FinalAlpha;
-					effect->SetFloat("finalAlpha", currentFAlpha);
-				}
-
-				uint16 numPasses = effect->BeginRender();
-				for(uint16 pass = 0; pass < numPasses; pass++)
-				{
-					effect->BeginPass(pass);
-					
-					hr = m_Device->DrawIndexedPrimitive(	D3DPT_TRIANGLELIST, 
-															0, 
-															minVertexIndex, 
-															jobQueue[i]->SpriteCnt * 4, 
-															startIndex, 
-															jobQueue[i]->SpriteCnt * 2);
-					if(FAILED(hr))
-					{
-						DEBUG_MSG("DrawIndexedPrimitive Failed. [CSpriteRenderer::Render]");
-					}
-
-					effect->EndPass();
-				}
-				effect->EndRender();
-
-				minVertexIndex += jobQueue[i]->SpriteCnt * 4;
-				startIndex += jobQueue[i]->SpriteCnt * 6;
-			}
-			
-			jobQueue.clear();
-		}
-
-		void CSpriteRenderer::EnterSpriteIntoBuffer(Vertex_Sprite* const vertices, const RenderJob_Sprite* const job)
-		{			
-			uint16 index = 0;
-			float32 minX, minY, maxX, maxY = 0.0f;
-			RenderJob_Sprite::Sprite sprite;
-
-			uint16 size = job->SpriteCnt;
-			for(uint16 i = 0; i < size; ++i)
-			{
-				sprite = job->SpritePtr[i];
-				vertices[0+index].Texture0_U		= sprite.TexCoordMin.X;
-				vertices[0+index].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-				vertices[1+index].Texture0_U		= sprite.TexCoordMin.X;
-				vertices[1+index].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-				vertices[2+index].Texture0_U		= sprite.TexCoordMax.X;
-				vertices[2+index].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-				vertices[3+index].Texture0_U		= sprite.TexCoordMax.X;
-				vertices[3+index].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-				minX = sprite.PositionMin.X;
-				minY = m_ScreenHeight - sprite.PositionMin.Y;
-				maxX = sprite.PositionMax.X;
-				maxY = m_ScreenHeight - sprite.PositionMax.Y;
-				
-				vertices[0+index].Position	= CVector3(minX, minY, 0.0f);
-				vertices[1+index].Position	= CVector3(minX, maxY, 0.0f);
-				vertices[2+index].Position	= CVector3(maxX, maxY, 0.0f);
-				vertices[3+index].Position	= CVector3(maxX, minY, 0.0f);
-
-				index += 4;
-			}
-		}
-
-		void CSpriteRenderer::RenderQuad(CTexture* const quadTexture)
-		{
-			//prepare vertexbuffer
-			Vertex_Sprite* vertices;
-			HRESULT hr = m_VertexBuffer->Lock(0, 4, (void**)&vertices, D3DLOCK_DISCARD);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Lock VertexBuffer Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			
-			RenderJob_Sprite::Sprite sprite = RenderJob_Sprite::Sprite();
-			sprite.PositionMin = CVector2(0.0f, 0.0f);
-			sprite.PositionMax = CVector2(m_ScreenWidth, m_ScreenHeight);
-			
-			vertices[0].Texture0_U		= sprite.TexCoordMin.X;
-			vertices[0].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-			vertices[1].Texture0_U		= sprite.TexCoordMin.X;
-			vertices[1].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-			vertices[2].Texture0_U		= sprite.TexCoordMax.X;
-			vertices[2].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-			vertices[3].Texture0_U		= sprite.TexCoordMax.X;
-			vertices[3].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-			float32 minX = sprite.PositionMin.X - 1;
-			float32 minY = m_ScreenHeight - sprite.PositionMin.Y + 1;
-			float32 maxX = sprite.PositionMax.X;
-			float32 maxY = m_ScreenHeight - sprite.PositionMax.Y;
-			
-			vertices[0].Position	= CVector3(minX, minY, 0.0f);
-			vertices[1].Position	= CVector3(minX, maxY, 0.0f);
-			vertices[2].Position	= CVector3(maxX, maxY, 0.0f);
-			vertices[3].Position	= CVector3(maxX, minY, 0.0f);		
-
-			hr = m_VertexBuffer->Unlock();
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Unlock VertexBuffer Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			//do render
-			hr = m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(Vertex_Sprite));
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			hr = m_Device->SetVertexDeclaration(m_VertexDeclaration);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetVertexDeclaration Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			hr = m_Device->SetIndices(m_IndexBuffer);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetIndices Failed. [CSpriteRenderer::RenderQuad]");
-			}
-			
-			CEffect* effect = m_ResourceManager->GetPostProcessingEffect();
-			effect->SetMatrix("matProj", &m_SpriteProjMatrix);
-			effect->SetMatrix("matView", &m_SpriteViewMatrix);
-			effect->SetTexture("diffuseTexture", quadTexture);
-			
-			uint16 numPasses = effect->BeginRender();
-			for(uint16 pass = 0; pass < numPasses; pass++)
-			{
-				effect->BeginPass(pass);
-				
-				hr = m_Device->DrawIndexedPrimitive(	D3DPT_TRIANGLELIST, 
-														0, 
-														0, 
-														4, 
-														0, 
-														2);
-				if(FAILED(hr))
-				{
-					DEBUG_MSG("DrawIndexedPrimitive Failed. [CSpriteRenderer::RenderQuad]");
-				}
-
-				effect->EndPass();
-			}
-			effect->EndRender();
-		}
-		
-		void CSpriteRenderer::RenderDeferredQuad(CTexture* const diffuseTexture, CTexture* const depthTexture, CTexture* const normalTexture)
-		{
-			//prepare vertexbuffer
-			Vertex_Sprite* vertices;
-			HRESULT hr = m_VertexBuffer->Lock(0, 4, (void**)&vertices, D3DLOCK_DISCARD);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Lock VertexBuffer Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			
-			RenderJob_Sprite::Sprite sprite = RenderJob_Sprite::Sprite();
-			sprite.PositionMin = CVector2(0.0f, 0.0f);
-			sprite.PositionMax = CVector2(m_ScreenWidth, m_ScreenHeight);
-			
-			vertices[0].Texture0_U		= sprite.TexCoordMin.X;
-			vertices[0].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-			vertices[1].Texture0_U		= sprite.TexCoordMin.X;
-			vertices[1].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-			vertices[2].Texture0_U		= sprite.TexCoordMax.X;
-			vertices[2].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
-
-			vertices[3].Texture0_U		= sprite.TexCoordMax.X;
-			vertices[3].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
-
-			float32 minX = sprite.PositionMin.X - 1;
-			float32 minY = m_ScreenHeight - sprite.PositionMin.Y + 1;
-			float32 maxX = sprite.PositionMax.X;
-			float32 maxY = m_ScreenHeight - sprite.PositionMax.Y;
-			
-			vertices[0].Position	= CVector3(minX, minY, 0.0f);
-			vertices[1].Position	= CVector3(minX, maxY, 0.0f);
-			vertices[2].Position	= CVector3(maxX, maxY, 0.0f);
-			vertices[3].Position	= CVector3(maxX, minY, 0.0f);		
-
-			hr = m_VertexBuffer->Unlock();
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("Unlock VertexBuffer Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			//do render
-			hr = m_Device->SetStreamSource(0, m_VertexBuffer, 0, sizeof(Vertex_Sprite));
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			hr = m_Device->SetVertexDeclaration(m_VertexDeclaration);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetVertexDeclaration Failed. [CSpriteRenderer::RenderQuad]");
-			}
-
-			hr = m_Device->SetIndices(m_IndexBuffer);
-			if(FAILED(hr))
-			{
-				DEBUG_MSG("SetIndices Failed. [CSpriteRenderer::RenderQuad]");
-			}
-			
-			CEffect* effect = m_ResourceManager->GetPostProcessingEffect();
-			effect->SetMatrix("matProj", &m_SpriteProjMatrix);
-			effect->SetMatrix("matView", &m_SpriteViewMatrix);
-			effect->SetTexture("diffuseTexture", diffuseTexture);
-			effect->SetTexture("depthTexture", depthTexture);
-			effect->SetTexture("normalTexture", normalTexture);
-			
-			uint16 numPasses = effect->BeginRender();
-			for(uint16 pass = 0; pass < numPasses; pass++)
-			{
-				effect->BeginPass(pass);
-				
-				hr = m_Device->DrawIndexedPrimitive(	D3DPT_TRIANGLELIST, 
-														0, 
-														0, 
-														4, 
-														0, 
-														2);
-				if(FAILED(hr))
-				{
-					DEBUG_MSG("DrawIndexedPrimitive Failed. [CSpriteRenderer::RenderQuad]");
-				}
-
-				effect->EndPass();
-			}
-			effect->EndRender();
-		}
-	};
+#include "../Header/CSpriteRenderer.h"
+#include <immintrin.h>
+#include <chrono>
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//parameters of sprite and full screen effects, resolved to handles through EffectParameterCache
+		static const CHashedString s_MatProj("matProj");
+		static const CHashedString s_MatView("matView");
+		static const CHashedString s_DiffuseTexture("diffuseTexture");
+		static const CHashedString s_DepthTexture("depthTexture");
+		static const CHashedString s_NormalTexture("normalTexture");
+		static const CHashedString s_FinalAlpha("finalAlpha");
+
+		//registers effects with EffectParameterCache the first time their parameters are asked for
+		static ID3DXEffect* GetD3DXEffect(const CEffect* const effect)
+		{
+			return effect->GetD3DXEffect();
+		}
+
+		//tells renderers apart in the thread local cache, even if one is reallocated at the same address
+		static std::atomic<uint32> s_NextInstanceId(1);
+
+		struct SubmitBufferCache
+		{
+			uint32			InstanceId;
+			SpriteSubmitBuffer*	Buffer;
+		};
+		static thread_local SubmitBufferCache s_SubmitBufferCache = { 0, NULL };
+
+		static void DropSubmitBuffer(SpriteSubmitBuffer* const buffer)
+		{
+			if(buffer->Refs.fetch_sub(1) == 1)
+				delete buffer;
+		}
+
+		static bool IsSubmitBufferEmpty(const SpriteSubmitBuffer* const buffer)
+		{
+			return	buffer->Jobs[0][0].empty() && buffer->Jobs[0][1].empty() &&
+					buffer->Jobs[1][0].empty() && buffer->Jobs[1][1].empty();
+		}
+
+		//buffers of every renderer the thread submitted to, let go when it exits
+		struct SubmitBufferHolder
+		{
+			std::vector<SpriteSubmitBuffer*>	Buffers;
+
+			~SubmitBufferHolder()
+			{
+				for(uint32 i = 0; i < Buffers.size(); ++i)
+				{
+					//a build left open would keep the render thread waiting at the next swap
+					if(Buffers[i]->OpenJob != NULL)
+					{
+						Buffers[i]->OpenJob = NULL;
+						Buffers[i]->Busy.fetch_sub(1);
+					}
+					DropSubmitBuffer(Buffers[i]);
+				}
+			}
+
+			//buffers of released renderers are only held by this thread anymore
+			void Prune()
+			{
+				for(uint32 i = 0; i < Buffers.size();)
+				{
+					if(Buffers[i]->Refs.load() == 1)
+					{
+						delete Buffers[i];
+						Buffers[i] = Buffers.back();
+						Buffers.pop_back();
+					}
+					else
+						++i;
+				}
+			}
+		};
+		static thread_local SubmitBufferHolder s_SubmitBufferHolder;
+
+		CSpriteRenderer::CSpriteRenderer()
+			:	m_Device(NULL),
+				m_ResourceManager(NULL),
+				m_RenderMode(SPRITE_MODE_VERTEX),
+				m_VertexDeclaration(NULL),
+				m_InstanceDeclaration(NULL),
+				m_CompactDeclaration(NULL),
+				m_VertexBuffer(NULL),
+				m_QuadCornerBuffer(NULL),
+				m_FullScreenQuadBuffer(NULL),
+				m_IndexBuffer(NULL),
+				m_ScreenWidth(0.0f),
+				m_ScreenHeight(0.0f),
+				m_VertexKernel(&CSpriteVertexKernel::FillScalar),
+				m_InstanceKernel(&CSpriteVertexKernel::FillInstancesScalar),
+				m_CompactKernel(&CSpriteVertexKernel::FillCompactUNormScalar),
+				m_VertexFormat(SPRITE_FORMAT_FLOAT),
+				m_SpriteVertexSize(sizeof(Vertex_Sprite)),
+				m_ActiveQueueBackground(0),
+				m_ActiveQueueForeground(0),
+				m_FillGrainSize(1024),
+				m_FillThreshold(4096),
+				m_VertexRingSize(0),
+				m_VertexRingPos(0),
+				m_FillRing(false),
+				m_InstanceId(s_NextInstanceId.fetch_add(1)),
+				m_LastJobCnt(0),
+				m_LastBatchCnt(0),
+				m_LastDrawCnt(0),
+				m_Atlas(NULL),
+				m_RetainedVertexBuffer(NULL),
+				m_BuildCnt(0),
+				m_BoundSpriteStream(NULL),
+				m_LastAtlasJobCnt(0),
+				m_LastRetainedSpriteCnt(0),
+				m_LastRebuiltSpriteCnt(0),
+				m_LastScreenCulledCnt(0),
+				m_LastClipCulledCnt(0),
+				m_LastOverdrawCulledCnt(0)
+		{
+			m_BackgroundQueueCnt[0]	= 0;
+			m_BackgroundQueueCnt[1]	= 0;
+			m_ForegroundQueueCnt[0]	= 0;
+			m_ForegroundQueueCnt[1]	= 0;
+			memset(m_LastArenaStats, 0, sizeof(m_LastArenaStats));
+			memset(&m_FrameStats, 0, sizeof(SpriteFrameStats));
+		}
+
+		CSpriteRenderer::~CSpriteRenderer()
+		{
+			this->Release();
+		}
+
+		void CSpriteRenderer::Release()
+		{
+			SAFE_RELEASE(m_VertexBuffer);
+			SAFE_RELEASE(m_RetainedVertexBuffer);
+			SAFE_RELEASE(m_QuadCornerBuffer);
+			SAFE_RELEASE(m_FullScreenQuadBuffer);
+			SAFE_RELEASE(m_IndexBuffer);
+			SAFE_RELEASE(m_VertexDeclaration);
+			SAFE_RELEASE(m_InstanceDeclaration);
+			SAFE_RELEASE(m_CompactDeclaration);
+			m_JobQueueBackground[0].clear();
+			m_JobQueueBackground[1].clear();
+			m_JobQueueForeground[0].clear();
+			m_JobQueueForeground[1].clear();
+
+			//producers must be done submitting at this point
+			{
+				std::lock_guard<std::mutex> lock(m_SubmitLock);
+				for(uint32 i = 0; i < m_SubmitBuffers.size(); ++i)
+					DropSubmitBuffer(m_SubmitBuffers[i]);
+				m_SubmitBuffers.clear();
+				m_InstanceId = s_NextInstanceId.fetch_add(1);
+			}
+
+			m_JobSorter.Release();
+			m_SortedJobs.clear();
+			m_SortKeys.clear();
+			m_QueueAtlasEntries.clear();
+			m_SortOrder.clear();
+			m_Batches.clear();
+			m_JobSpriteOffsets.clear();
+			m_RetainedJobs.clear();
+			m_RetainedFreeHandles.clear();
+			m_RetainedLookup.clear();
+			m_RetainedFreeSlots.clear();
+			m_JobStates.clear();
+			m_Culler.Release();
+			m_CommandList.Release();
+			m_Capture.Close();
+			m_BoundSpriteStream		= NULL;
+			m_FillPool.Release();
+			m_VertexRingSize		= 0;
+			m_VertexRingPos			= 0;
+			m_Device				= NULL;
+			m_ScreenWidth			= 0.0f;
+			m_ScreenHeight			= 0.0f;
+			m_BackgroundQueueCnt[0]	= 0;
+			m_BackgroundQueueCnt[1]	= 0;
+			m_ForegroundQueueCnt[0]	= 0;
+			m_ForegroundQueueCnt[1]	= 0;
+			memset(m_LastArenaStats, 0, sizeof(m_LastArenaStats));
+			memset(&m_FrameStats, 0, sizeof(SpriteFrameStats));
+			m_Stats.Clear();
+		}
+
+		bool CSpriteRenderer::Initialize(IDirect3DDevice9* const device, const float32 width, const float32 height, const SpriteRenderMode mode, const SpriteVertexFormat format)
+		{
+			m_Device = device;
+			m_ScreenWidth = width;
+			m_ScreenHeight = height;
+			m_RenderMode = mode;
+
+#ifndef VOID_SPRITE_INSTANCING
+			//instance records drawn with the per vertex techniques would end up as garbage, headless lists are fine
+			if(m_RenderMode == SPRITE_MODE_INSTANCED && m_Device != NULL)
+			{
+				DEBUG_MSG("Instanced Sprites Are Headless Only, Using Vertices. [CSpriteRenderer::Initialize]");
+				m_RenderMode = SPRITE_MODE_VERTEX;
+			}
+#endif
+			m_VertexFormat = (m_RenderMode == SPRITE_MODE_VERTEX) ? format : SPRITE_FORMAT_FLOAT;
+			m_SpriteVertexSize = sizeof(Vertex_Sprite);
+
+			m_Culler.Initialize(width, height);
+
+			CCpuFeatures::SimdLevel kernelLevel = CCpuFeatures::DetectLevel();
+			m_VertexKernel = CSpriteVertexKernel::GetKernel(kernelLevel);
+			m_InstanceKernel = CSpriteVertexKernel::GetInstanceKernel(kernelLevel);
+			m_CompactKernel = CSpriteVertexKernel::GetCompactKernel(kernelLevel, m_VertexFormat == SPRITE_FORMAT_COMPACT_HALF);
+
+			SpriteSlotRange freeSlots = { 0, MAX_NUM_RETAINED_SPRITES };
+			m_RetainedFreeSlots.clear();
+			m_RetainedFreeSlots.push_back(freeSlots);
+
+			m_SpriteProjMatrix.OrthoLH(m_ScreenWidth, m_ScreenHeight, -10000.0f, 10000.0f);
+			m_SpriteViewMatrix.LookAtLH(CVector3(m_ScreenWidth/2, m_ScreenHeight/2, -1.0f),
+										CVector3(m_ScreenWidth/2, m_ScreenHeight/2, 0.0f),
+										CVector3(0.0f, 1.0f, 0.0f));
+			m_SpriteWorldMatrix.Identity();
+
+			//headless, lists are built as usual and can only be executed into a sink
+			if(m_Device == NULL)
+			{
+				if(m_VertexFormat != SPRITE_FORMAT_FLOAT)
+					m_SpriteVertexSize = sizeof(Vertex_SpriteCompact);
+				return true;
+			}
+
+			//effects loaded by the resource manager register on first use unless the host installed its own source
+			if(EffectParameterCache->GetEffectSource() == NULL)
+				EffectParameterCache->SetEffectSource(&GetD3DXEffect);
+
+			//full screen quads always go through this one
+			const D3DVERTEXELEMENT9 decl[3] = 
+			{
+			  {0, 0,  D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+			  {0, 4*3, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},
+			  D3DDECL_END()
+			};
+			HRESULT hr = m_Device->CreateVertexDeclaration(decl, &m_VertexDeclaration);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("CreateVertexDeclaration Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			if(m_VertexFormat != SPRITE_FORMAT_FLOAT)
+			{
+				//SHORT2 is always there, the normalized and half texcoord types are optional
+				D3DCAPS9 caps;
+				DWORD texCoordCap = (m_VertexFormat == SPRITE_FORMAT_COMPACT_HALF) ? D3DDTCAPS_FLOAT16_2 : D3DDTCAPS_USHORT2N;
+				hr = m_Device->GetDeviceCaps(&caps);
+				if(FAILED(hr) || (caps.DeclTypes & texCoordCap) == 0)
+				{
+					DEBUG_MSG("Compact sprite vertices not supported, using floats. [CSpriteRenderer::Initialize]");
+					m_VertexFormat = SPRITE_FORMAT_FLOAT;
+				}
+			}
+
+			if(m_VertexFormat != SPRITE_FORMAT_FLOAT)
+			{
+				//the shader sees the same (x, y, 0, 1) position and (u, v) texcoord as with floats
+				BYTE texCoordType = (m_VertexFormat == SPRITE_FORMAT_COMPACT_HALF) ? D3DDECLTYPE_FLOAT16_2 : D3DDECLTYPE_USHORT2N;
+				const D3DVERTEXELEMENT9 compactDecl[3] = 
+				{
+				  {0, 0,  D3DDECLTYPE_SHORT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+				  {0, 2*2, texCoordType, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},
+				  D3DDECL_END()
+				};
+				hr = m_Device->CreateVertexDeclaration(compactDecl, &m_CompactDeclaration);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("CreateVertexDeclaration Failed. [CSpriteRenderer::Initialize]");
+					return false;
+				}
+				m_SpriteVertexSize = sizeof(Vertex_SpriteCompact);
+			}
+
+			//instanced sprites need 6 indices only, the unit quad is shared by all of them
+			uint32 indexedQuadCnt = MAX_NUM_SPRITES;
+			uint32 spriteSize = m_SpriteVertexSize * 4;
+			if(m_RenderMode == SPRITE_MODE_INSTANCED)
+			{
+				indexedQuadCnt = 1;
+				spriteSize = sizeof(Instance_Sprite);
+
+				//stream 0: unit quad corner, stream 1: position and texcoord rect per instance
+				const D3DVERTEXELEMENT9 instanceDecl[4] = 
+				{
+				  {0, 0,  D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+				  {1, 0,  D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0},
+				  {1, 4*4, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1},
+				  D3DDECL_END()
+				};
+				hr = m_Device->CreateVertexDeclaration(instanceDecl, &m_InstanceDeclaration);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("CreateVertexDeclaration Failed. [CSpriteRenderer::Initialize]");
+					return false;
+				}
+
+				hr = m_Device->CreateVertexBuffer(	sizeof(Vertex_SpriteCorner) * 4,
+													D3DUSAGE_WRITEONLY,
+													NULL,
+													D3DPOOL_MANAGED,
+													&m_QuadCornerBuffer,
+													NULL);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("CreateVertexBuffer Failed. [CSpriteRenderer::Initialize]");
+					return false;
+				}
+
+				Vertex_SpriteCorner* corners;
+				hr = m_QuadCornerBuffer->Lock(0, 0, (void**)&corners, NULL);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("Lock QuadCornerBuffer Failed. [CSpriteRenderer::Initialize]");
+					return false;
+				}
+				memcpy(corners, CSpriteVertexKernel::UnitQuadCorners, sizeof(Vertex_SpriteCorner) * 4);
+				hr = m_QuadCornerBuffer->Unlock();
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("Unlock QuadCornerBuffer Failed. [CSpriteRenderer::Initialize]");
+					return false;
+				}
+			}
+
+			//several chunks, so most locks append behind the last one instead of renaming the buffer
+			m_VertexRingSize = SPRITE_RING_CHUNKS * MAX_NUM_SPRITES * spriteSize;
+			m_VertexRingPos = m_VertexRingSize;
+
+			hr = m_Device->CreateVertexBuffer(	m_VertexRingSize,
+												D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+												NULL,
+												D3DPOOL_DEFAULT,
+												&m_VertexBuffer,
+												NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("CreateVertexBuffer Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			//retained regions are rewritten rarely, a static buffer keeps them out of the streaming path
+			hr = m_Device->CreateVertexBuffer(	MAX_NUM_RETAINED_SPRITES * spriteSize,
+												D3DUSAGE_WRITEONLY,
+												NULL,
+												D3DPOOL_MANAGED,
+												&m_RetainedVertexBuffer,
+												NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("CreateVertexBuffer Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			hr = m_Device->CreateIndexBuffer(	indexedQuadCnt * sizeof(uint16) * 6,
+												D3DUSAGE_WRITEONLY,
+												D3DFMT_INDEX16,
+												D3DPOOL_MANAGED,
+												&m_IndexBuffer,
+												NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("CreateIndexBuffer Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			uint16* pIndices;
+			hr = m_IndexBuffer->Lock(0, 0, (void**)&pIndices, NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Lock IndexBuffer Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			uint32 j = 0;
+			uint32 k = 0;
+			for(uint32 i = 0; i < indexedQuadCnt; ++i)
+			{
+				//1st tri
+				pIndices[j+0] = k+0;
+				pIndices[j+1] = k+1;
+				pIndices[j+2] = k+3;
+
+				//2nd tri
+				pIndices[j+3] = k+3;
+				pIndices[j+4] = k+1;
+				pIndices[j+5] = k+2;
+
+				j += 6;
+				k += 4;
+			}
+			hr = m_IndexBuffer->Unlock();
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Unlock IndexBuffer Failed. [CSpriteRenderer::Initialize]");
+				return false;
+			}
+
+			//full screen quads never change, they draw from their own static buffer
+			if(!this->CreateFullScreenQuad())
+				return false;
+
+			return true;
+		}
+
+		void CSpriteRenderer::AddRenderJob(RenderJob_Sprite* const job, const bool keepSortingKey)
+		{
+			if(job->SpriteCnt == 0)
+				return;
+
+			//no cap here, Render streams queues of any size through the ring buffer
+			if(!keepSortingKey)
+				job->RebuildSortingKey();
+
+			//busy flag first, then the queue index: a swap either sees us busy or we see the new queue
+			//counted, an open build of this thread holds the flag as well
+			SpriteSubmitBuffer* buffer = this->GetSubmitBuffer();
+			buffer->Busy.fetch_add(1);
+			if(!job->IsCurtain)
+				this->PushJob(buffer, job, 0, m_ActiveQueueBackground.load());
+			else
+				this->PushJob(buffer, job, 1, m_ActiveQueueForeground.load());
+			buffer->Busy.fetch_sub(1);
+		}
+
+		RenderJob_Sprite* CSpriteRenderer::BeginSpriteJob(const bool curtain, const uint32 spriteCnt)
+		{
+			SpriteSubmitBuffer* buffer = this->GetSubmitBuffer();
+			if(buffer->OpenJob != NULL)
+			{
+				DEBUG_MSG("Job Already Open. [CSpriteRenderer::BeginSpriteJob]");
+				return NULL;
+			}
+
+			//held until EndSpriteJob, so the queue read here is still the one merged next
+			buffer->Busy.fetch_add(1);
+			uint8 layer = curtain ? 1 : 0;
+			uint8 queue = curtain ? m_ActiveQueueForeground.load() : m_ActiveQueueBackground.load();
+
+			CSpriteFrameArena& arena = buffer->Arenas[layer][queue];
+			RenderJob_Sprite* job = arena.Construct<RenderJob_Sprite>();
+			RenderJob_Sprite::Sprite* sprites = arena.AllocateArray<RenderJob_Sprite::Sprite>(spriteCnt);
+			if(job == NULL || sprites == NULL)
+			{
+				buffer->Busy.fetch_sub(1);
+				return NULL;
+			}
+
+			job->SpritePtr	= sprites;
+			job->SpriteCnt	= spriteCnt;
+			job->IsCurtain	= curtain;
+
+			buffer->OpenJob		= job;
+			buffer->OpenCurtain	= layer;
+			buffer->OpenQueue	= queue;
+			return job;
+		}
+
+		void CSpriteRenderer::EndSpriteJob(RenderJob_Sprite* const job)
+		{
+			SpriteSubmitBuffer* buffer = this->GetSubmitBuffer();
+			if(job == NULL || buffer->OpenJob != job)
+			{
+				DEBUG_MSG("Job Not Open. [CSpriteRenderer::EndSpriteJob]");
+				return;
+			}
+
+			//the layer is fixed at BeginSpriteJob, its memory belongs to that queue
+			buffer->OpenJob = NULL;
+			if(job->SpriteCnt > 0)
+			{
+				job->IsCurtain = (buffer->OpenCurtain == 1);
+				job->RebuildSortingKey();
+				this->PushJob(buffer, job, buffer->OpenCurtain, buffer->OpenQueue);
+			}
+			buffer->Busy.fetch_sub(1);
+		}
+
+		void CSpriteRenderer::PushJob(SpriteSubmitBuffer* const buffer, RenderJob_Sprite* const job, const uint8 curtain, const uint8 queue)
+		{
+			if(curtain == 0)
+				m_BackgroundQueueCnt[queue].fetch_add(job->SpriteCnt);
+			else
+				m_ForegroundQueueCnt[queue].fetch_add(job->SpriteCnt);
+			buffer->Jobs[curtain][queue].push_back(job);
+		}
+
+		SpriteSubmitBuffer* CSpriteRenderer::GetSubmitBuffer()
+		{
+			if(s_SubmitBufferCache.InstanceId == m_InstanceId)
+				return s_SubmitBufferCache.Buffer;
+
+			//first submission of this thread (or a different renderer), look up or register
+			std::lock_guard<std::mutex> lock(m_SubmitLock);
+			std::thread::id self = std::this_thread::get_id();
+
+			//ids of exited threads get reused, their buffers are left to drain
+			SpriteSubmitBuffer* buffer = NULL;
+			for(uint32 i = 0; i < m_SubmitBuffers.size(); ++i)
+			{
+				if(m_SubmitBuffers[i]->Owner == self && m_SubmitBuffers[i]->Refs.load() == 2)
+				{
+					buffer = m_SubmitBuffers[i];
+					break;
+				}
+			}
+
+			if(buffer == NULL)
+			{
+				buffer = new SpriteSubmitBuffer();
+				buffer->Owner		= self;
+				buffer->OpenJob		= NULL;
+				buffer->OpenCurtain	= 0;
+				buffer->OpenQueue	= 0;
+				buffer->Busy.store(0);
+				buffer->Refs.store(2);
+				m_SubmitBuffers.push_back(buffer);
+
+				s_SubmitBufferHolder.Prune();
+				s_SubmitBufferHolder.Buffers.push_back(buffer);
+			}
+
+			s_SubmitBufferCache.InstanceId	= m_InstanceId;
+			s_SubmitBufferCache.Buffer		= buffer;
+			return buffer;
+		}
+
+		void CSpriteRenderer::MergeSubmitBuffers(const uint8 curtain, const uint8 queue, std::deque<RenderJob_Sprite* const>& jobQueue)
+		{
+			//queue index was swapped already, registration order keeps the merge deterministic per thread
+			std::lock_guard<std::mutex> lock(m_SubmitLock);
+			for(uint32 i = 0; i < m_SubmitBuffers.size(); ++i)
+			{
+				SpriteSubmitBuffer* buffer = m_SubmitBuffers[i];
+
+				//a producer that read the old index before the swap is still appending, that takes
+				//a push or a short build, back off to sleeping only if it got descheduled meanwhile
+				for(uint32 spin = 0; buffer->Busy.load() != 0; ++spin)
+				{
+					if(spin < 64)
+						_mm_pause();
+					else if(spin < 128)
+						std::this_thread::yield();
+					else
+						std::this_thread::sleep_for(std::chrono::microseconds(50));
+				}
+
+				std::vector<RenderJob_Sprite*>& jobs = buffer->Jobs[curtain][queue];
+				jobQueue.insert(jobQueue.end(), jobs.begin(), jobs.end());
+				jobs.clear();
+			}
+		}
+
+		bool CSpriteRenderer::IsFrameMemory(const void* const memory)
+		{
+			std::lock_guard<std::mutex> lock(m_SubmitLock);
+			for(uint32 i = 0; i < m_SubmitBuffers.size(); ++i)
+			{
+				for(uint32 curtain = 0; curtain < 2; ++curtain)
+				{
+					for(uint32 queue = 0; queue < 2; ++queue)
+					{
+						if(m_SubmitBuffers[i]->Arenas[curtain][queue].Owns(memory))
+							return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		void CSpriteRenderer::ResetFrameArenas(const uint8 curtain, const uint8 queue)
+		{
+			//the queue was merged and rendered, producers are on the other one by now
+			std::lock_guard<std::mutex> lock(m_SubmitLock);
+			FrameArenaStats& total = m_LastArenaStats[curtain];
+			memset(&total, 0, sizeof(FrameArenaStats));
+			for(uint32 i = 0; i < m_SubmitBuffers.size(); ++i)
+			{
+				CSpriteFrameArena& arena = m_SubmitBuffers[i]->Arenas[curtain][queue];
+				FrameArenaStats stats = arena.GetStats();
+				total.AllocationCnt	+= stats.AllocationCnt;
+				total.BytesUsed		+= stats.BytesUsed;
+				total.HighWater		= stats.HighWater > total.HighWater ? stats.HighWater : total.HighWater;
+				total.BytesReserved	+= stats.BytesReserved;
+				total.BlockCnt		+= stats.BlockCnt;
+				arena.Reset();
+
+				//the producer exited and all it submitted was built, nothing points into its arenas anymore
+				SpriteSubmitBuffer* buffer = m_SubmitBuffers[i];
+				if(buffer->Refs.load() == 1 && IsSubmitBufferEmpty(buffer))
+				{
+					DropSubmitBuffer(buffer);
+					m_SubmitBuffers.erase(m_SubmitBuffers.begin() + i);
+					--i;
+				}
+			}
+		}
+
+		void CSpriteRenderer::Build(std::deque<RenderJob_Sprite* const>& jobQueue, const uint8 curtain, CSpriteCommandList& list, const bool keepCoverage)
+		{
+			bool instanced = (m_RenderMode == SPRITE_MODE_INSTANCED);
+			uint32 spriteSize = instanced ? sizeof(Instance_Sprite) : m_SpriteVertexSize * 4;
+			list.Reset(curtain, spriteSize);
+			SpriteCommandListInfo& info = list.GetInfo();
+
+			//retained jobs of this layer take part in sorting like any other job
+			uint32 firstRetained = jobQueue.size();
+			for(uint32 i = 0; i < m_RetainedJobs.size(); ++i)
+			{
+				const RetainedSpriteJob& retained = m_RetainedJobs[i];
+				if(retained.Alive && retained.Job->SpriteCnt > 0 && (uint8)retained.Job->IsCurtain == curtain)
+					jobQueue.push_back(retained.Job);
+			}
+
+			//empty layers are recorded as well, replay keeps the call sequence
+			if(m_Capture.IsOpen())
+				m_Capture.WriteLayer(curtain, jobQueue, firstRetained);
+
+			if(jobQueue.empty())
+				return;
+
+			//jobs whose texture lives in the atlas draw from its page, they sort with the page in their key
+			//so jobs on one page end up next to each other, their texcoords are remapped on fill
+			uint32 size = jobQueue.size();
+			const uint64* sortKeys = NULL;
+			if(m_Atlas != NULL)
+			{
+				m_QueueAtlasEntries.resize(size);
+				m_SortKeys.resize(size);
+				for(uint32 i = 0; i < size; ++i)
+				{
+					RenderJob_Sprite* job = jobQueue[i];
+					const AtlasEntry* entry = m_Atlas->Lookup(job->TextureId);
+					m_QueueAtlasEntries[i] = entry;
+					m_SortKeys[i] = job->SortingKey;
+					if(entry == NULL)
+						continue;
+
+					//the job keeps its own texture and key, the page is only borrowed for the sort
+					TextureId texId = job->TextureId;
+					job->TextureId = m_Atlas->GetPageId(entry->Page);
+					job->RebuildSortingKey();
+					std::swap(m_SortKeys[i], job->SortingKey);
+					job->TextureId = texId;
+				}
+				sortKeys = &m_SortKeys[0];
+			}
+
+			SPRITESTATS(CSpriteRenderStats::TimePoint sortStart = CSpriteRenderStats::Now());
+			m_JobSorter.Sort(jobQueue, m_SortedJobs, sortKeys, sortKeys != NULL ? &m_SortOrder : NULL);
+			SPRITESTATS(info.BuildStats.SortTime += CSpriteRenderStats::ElapsedMs(sortStart));
+
+			m_JobStates.resize(size);
+			uint32 queuedSpriteCnt = 0;
+			for(uint32 i = 0; i < size; ++i)
+			{
+				SpriteJobState& state = m_JobStates[i];
+				state.Sprites	= m_SortedJobs[i]->SpritePtr;
+				state.SpriteCnt	= m_SortedJobs[i]->SpriteCnt;
+				state.Slot		= SPRITE_SLOT_NONE;
+				queuedSpriteCnt += state.SpriteCnt;
+
+				const AtlasEntry* entry = sortKeys != NULL ? m_QueueAtlasEntries[m_SortOrder[i]] : NULL;
+				if(entry != NULL)
+				{
+					state.TextureId		= m_Atlas->GetPageId(entry->Page);
+					state.TexTransform	= entry->TexTransform;
+					++info.AtlasJobCnt;
+				}
+				else
+				{
+					state.TextureId		= m_SortedJobs[i]->TextureId;
+					state.TexTransform	= CSpriteVertexKernel::IdentityTexTransform;
+				}
+			}
+
+			SPRITESTATS(info.BuildStats.JobCnt[curtain] += size);
+			SPRITESTATS(info.BuildStats.SpriteCnt[curtain] += queuedSpriteCnt);
+
+			//retained jobs draw from their region, re-entered only when changed
+			++m_BuildCnt;
+			for(uint32 i = 0; i < size && !m_RetainedJobs.empty(); ++i)
+			{
+				std::unordered_map<const RenderJob_Sprite*, uint32>::iterator iter = m_RetainedLookup.find(m_SortedJobs[i]);
+				if(iter == m_RetainedLookup.end())
+					continue;
+
+				//queued through AddRenderJob as well, one draw is enough
+				RetainedSpriteJob& retained = m_RetainedJobs[iter->second];
+				if(retained.DrawnBuild == m_BuildCnt)
+				{
+					m_JobStates[i].SpriteCnt = 0;
+					continue;
+				}
+
+				retained.DrawnBuild = m_BuildCnt;
+				m_JobStates[i].Slot = this->PrepareRetainedJob(retained, m_JobStates[i].TextureId, m_JobStates[i].TexTransform, list);
+			}
+
+			//drop sprites nobody will see, back to front so only sprites drawn later can hide earlier ones
+			m_Culler.Begin(curtain, queuedSpriteCnt, keepCoverage);
+			//queued jobs are never empty, an empty state is a dropped copy of a retained job
+			for(int32 i = size - 1; i >= 0; --i)
+			{
+				if(m_JobStates[i].SpriteCnt > 0)
+					m_Culler.CullJob(m_SortedJobs[i], m_JobStates[i].Slot != SPRITE_SLOT_NONE, m_JobStates[i].Sprites, m_JobStates[i].SpriteCnt);
+			}
+
+			info.ScreenCulledCnt	= m_Culler.GetScreenCulledCount();
+			info.ClipCulledCnt		= m_Culler.GetClipCulledCount();
+			info.OverdrawCulledCnt	= m_Culler.GetOverdrawCulledCount();
+
+			//output offset of every streamed job is the prefix sum of the sprite counts
+			m_JobSpriteOffsets.resize(size + 1);
+			m_JobSpriteOffsets[0] = 0;
+			for(uint32 i = 0; i < size; ++i)
+				m_JobSpriteOffsets[i+1] = m_JobSpriteOffsets[i] + (m_JobStates[i].Slot == SPRITE_SLOT_NONE ? m_JobStates[i].SpriteCnt : 0);
+			uint32 spriteCnt = m_JobSpriteOffsets[size];
+			info.RebuiltSpriteCnt += spriteCnt;
+
+			//enter the whole stream at once, jobs write disjoint ranges so workers may split them
+			//a list executed on the device right away is filled into the locked ring, saving the copy
+			SPRITESTATS(CSpriteRenderStats::TimePoint fillStart = CSpriteRenderStats::Now());
+			uint8* output = NULL;
+			if(m_FillRing && spriteCnt > 0 && spriteCnt * spriteSize <= m_VertexRingSize)
+			{
+				uint32 ringStride = instanced ? sizeof(Instance_Sprite) : m_SpriteVertexSize;
+				uint32 ringElement = 0;
+				output = (uint8*)this->LockVertexRing(spriteCnt * spriteSize, ringStride, ringElement);
+				if(output != NULL)
+					list.SetRingStream(spriteCnt, ringElement);
+			}
+			bool inRing = (output != NULL);
+			if(!inRing)
+				output = list.ReserveStream(spriteCnt);
+
+			if(spriteCnt > 0)
+			{
+				FillContext context = { this, output, 0 };
+				if(m_FillPool.GetThreadCount() > 0 && spriteCnt >= m_FillThreshold)
+					m_FillPool.ParallelFor(spriteCnt, m_FillGrainSize, &CSpriteRenderer::FillTask, &context);
+				else
+					this->EnterSpritesIntoBuffer(output, 0, 0, spriteCnt);
+				SPRITESTATS(info.BuildStats.LockFillTime += CSpriteRenderStats::ElapsedMs(fillStart));
+			}
+
+			if(inRing)
+			{
+				HRESULT hr = m_VertexBuffer->Unlock();
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("Unlock VertexBuffer Failed. [CSpriteRenderer::Build]");
+				}
+				SPRITESTATS(info.BuildStats.BytesUploaded += spriteCnt * spriteSize);
+			}
+
+			//fold runs of state-compatible jobs into single draws
+			uint32 batchCnt = CoalesceBatches(m_SortedJobs, m_Batches, &m_JobStates[0]);
+
+			//record state changes only where they happen
+			TextureId currentTexId = TextureId_Default;
+			EffectId currentFxId = EffectId_Default;
+			float32 currentFAlpha = -1.0f;
+			bool effectBound = false;
+
+			for(uint32 i = 0; i < batchCnt; ++i)
+			{
+				const SpriteBatch& batch = m_Batches[i];
+
+				bool newFx = (batch.EffectId != currentFxId || !effectBound);
+				if(newFx)
+				{
+					currentFxId = batch.EffectId;
+					effectBound = true;
+					list.AddBindEffect(currentFxId);
+					SPRITESTATS(++info.BuildStats.EffectChanges);
+				}
+				
+				bool newTex = (batch.TextureId != currentTexId);
+				if(newTex)
+				{
+					currentTexId = batch.TextureId;
+					SPRITESTATS(++info.BuildStats.TextureChanges);
+				}
+
+				if(newFx || newTex)
+					list.AddBindTexture(currentTexId);
+
+				if(batch.FinalAlpha != currentFAlpha || newFx)
+				{
+					SPRITESTATS(info.BuildStats.AlphaChanges += (batch.FinalAlpha != currentFAlpha) ? 1 : 0);
+					currentFAlpha = batch.FinalAlpha;
+					list.AddSetAlpha(currentFAlpha);
+				}
+
+				if(batch.Retained)
+					list.AddDrawRetained(batch.FirstSprite, batch.SpriteCnt);
+				else
+					list.AddDraw(batch.FirstSprite, batch.SpriteCnt);
+			}
+
+			info.JobCnt		= size;
+			info.BatchCnt	= batchCnt;
+			
+			jobQueue.clear();
+		}
+
+		void CSpriteRenderer::Execute(const CSpriteCommandList& list, CSpriteCommandSink* const sink)
+		{
+			m_LastDrawCnt = 0;
+			if(!list.IsEmpty())
+			{
+				if(sink != NULL)
+				{
+					//other sinks know nothing about effect passes, every draw counts once
+					list.Replay(sink);
+					m_LastDrawCnt = list.GetDrawCount();
+				}
+				else if(m_Device != NULL)
+				{
+					DeviceSink deviceSink(this);
+					list.Replay(&deviceSink);
+				}
+				else
+					DEBUG_MSG("No Device To Execute On. [CSpriteRenderer::Execute]");
+			}
+
+			const SpriteCommandListInfo& info = list.GetInfo();
+			m_LastJobCnt				= info.JobCnt;
+			m_LastBatchCnt				= info.BatchCnt;
+			m_LastAtlasJobCnt			= info.AtlasJobCnt;
+			m_LastRetainedSpriteCnt		= info.RetainedSpriteCnt;
+			m_LastRebuiltSpriteCnt		= info.RebuiltSpriteCnt;
+			m_LastScreenCulledCnt		= info.ScreenCulledCnt;
+			m_LastClipCulledCnt			= info.ClipCulledCnt;
+			m_LastOverdrawCulledCnt		= info.OverdrawCulledCnt;
+
+			SPRITESTATS(CSpriteRenderStats::Accumulate(m_FrameStats, info.BuildStats));
+			SPRITESTATS(m_FrameStats.DrawCnt += m_LastDrawCnt);
+
+			//the foreground is drawn last, it closes the frame
+			if(info.Curtain == 1)
+			{
+				SPRITESTATS(m_Stats.Commit(m_FrameStats));
+				SPRITESTATS(memset(&m_FrameStats, 0, sizeof(SpriteFrameStats)));
+			}
+		}
+
+		CSpriteRenderer::DeviceSink::DeviceSink(CSpriteRenderer* const renderer)
+			:	m_Renderer(renderer),
+				m_List(NULL),
+				m_Effect(NULL),
+				m_TextureHandle(NULL),
+				m_AlphaParameter(NULL),
+				m_ChunkBegin(0),
+				m_ChunkEnd(0),
+				m_RingElement(0)
+		{
+		}
+
+		void CSpriteRenderer::DeviceSink::Begin(const CSpriteCommandList& list)
+		{
+			m_List			= &list;
+			m_Effect		= NULL;
+			m_ChunkBegin	= 0;
+			m_ChunkEnd		= 0;
+
+			HRESULT hr;
+			if(m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED)
+			{
+				//instance stream offset changes per draw, see DrawSprites
+				hr = m_Renderer->m_Device->SetStreamSource(0, m_Renderer->m_QuadCornerBuffer, 0, sizeof(Vertex_SpriteCorner));
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::DeviceSink::Begin]");
+				}
+
+				hr = m_Renderer->m_Device->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetStreamSourceFreq Failed. [CSpriteRenderer::DeviceSink::Begin]");
+				}
+			}
+			else
+			{
+				hr = m_Renderer->m_Device->SetStreamSource(0, m_Renderer->m_VertexBuffer, 0, m_Renderer->m_SpriteVertexSize);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::DeviceSink::Begin]");
+				}
+				m_Renderer->m_BoundSpriteStream = m_Renderer->m_VertexBuffer;
+			}
+
+			IDirect3DVertexDeclaration9* declaration = m_Renderer->m_VertexDeclaration;
+			if(m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED)
+				declaration = m_Renderer->m_InstanceDeclaration;
+			else if(m_Renderer->m_VertexFormat != SPRITE_FORMAT_FLOAT)
+				declaration = m_Renderer->m_CompactDeclaration;
+
+			hr = m_Renderer->m_Device->SetVertexDeclaration(declaration);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("SetVertexDeclaration Failed. [CSpriteRenderer::DeviceSink::Begin]");
+			}
+
+			hr = m_Renderer->m_Device->SetIndices(m_Renderer->m_IndexBuffer);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("SetIndices Failed. [CSpriteRenderer::DeviceSink::Begin]");
+			}
+		}
+
+		void CSpriteRenderer::DeviceSink::BindEffect(const EffectId id)
+		{
+			m_Effect = m_Renderer->m_ResourceManager->GetEffectById(id);
+			m_Renderer->SetScreenMatrices(m_Effect);
+
+			//texture and alpha change far more often than the effect
+			const EffectParameterMap* parameters = EffectParameterCache->GetParameters(m_Effect);
+			m_TextureHandle	= CEffectParameterCache::GetHandle(parameters, s_DiffuseTexture);
+			m_AlphaParameter	= CEffectParameterCache::FindParameter(parameters, s_FinalAlpha);
+		}
+
+		void CSpriteRenderer::DeviceSink::BindTexture(const TextureId id)
+		{
+			m_Effect->SetTexture(EFFECT_PARAMETER(m_TextureHandle, s_DiffuseTexture), m_Renderer->m_ResourceManager->GetTextureById(id));
+		}
+
+		void CSpriteRenderer::DeviceSink::SetAlpha(const float32 alpha)
+		{
+			m_Effect->SetFloat(EFFECT_PARAMETER(m_AlphaParameter != NULL ? m_AlphaParameter->Handle : NULL, s_FinalAlpha), alpha);
+			EffectParameterCache->InvalidateUpload(m_Effect, m_AlphaParameter);
+		}
+
+		void CSpriteRenderer::DeviceSink::UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data)
+		{
+			uint32 spriteSize = m_List->GetSpriteSize();
+
+			SPRITESTATS(CSpriteRenderStats::TimePoint fillStart = CSpriteRenderStats::Now());
+			void* output = NULL;
+			HRESULT hr = m_Renderer->m_RetainedVertexBuffer->Lock(firstSlot * spriteSize, spriteCnt * spriteSize, &output, NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Lock RetainedVertexBuffer Failed. [CSpriteRenderer::DeviceSink::UploadRetained]");
+				return;
+			}
+
+			memcpy(output, data, spriteCnt * spriteSize);
+
+			hr = m_Renderer->m_RetainedVertexBuffer->Unlock();
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Unlock RetainedVertexBuffer Failed. [CSpriteRenderer::DeviceSink::UploadRetained]");
+			}
+			SPRITESTATS(m_Renderer->m_FrameStats.LockFillTime += CSpriteRenderStats::ElapsedMs(fillStart));
+			SPRITESTATS(m_Renderer->m_FrameStats.BytesUploaded += spriteCnt * spriteSize);
+		}
+
+		bool CSpriteRenderer::DeviceSink::UploadChunk(const uint32 firstSprite)
+		{
+			uint32 streamCnt = m_List->GetStreamSpriteCount();
+			uint32 chunkCnt = (streamCnt - firstSprite) > MAX_NUM_SPRITES ? MAX_NUM_SPRITES : streamCnt - firstSprite;
+			uint32 spriteSize = m_List->GetSpriteSize();
+			uint32 ringStride = m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED ? sizeof(Instance_Sprite) : m_Renderer->m_SpriteVertexSize;
+
+			//filled by the build already, a chunk only moves the window the index buffer reaches
+			if(m_List->IsStreamInRing())
+			{
+				uint32 elementsPerSprite = m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED ? 1 : 4;
+				m_RingElement	= m_List->GetRingElement() + firstSprite * elementsPerSprite;
+				m_ChunkBegin	= firstSprite;
+				m_ChunkEnd		= firstSprite + chunkCnt;
+				return true;
+			}
+
+			SPRITESTATS(CSpriteRenderStats::TimePoint fillStart = CSpriteRenderStats::Now());
+			void* output = m_Renderer->LockVertexRing(chunkCnt * spriteSize, ringStride, m_RingElement);
+			if(output == NULL)
+				return false;
+
+			memcpy(output, m_List->GetStreamData(firstSprite), chunkCnt * spriteSize);
+
+			HRESULT hr = m_Renderer->m_VertexBuffer->Unlock();
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Unlock VertexBuffer Failed. [CSpriteRenderer::DeviceSink::UploadChunk]");
+			}
+			SPRITESTATS(m_Renderer->m_FrameStats.LockFillTime += CSpriteRenderStats::ElapsedMs(fillStart));
+			SPRITESTATS(m_Renderer->m_FrameStats.BytesUploaded += chunkCnt * spriteSize);
+
+			m_ChunkBegin	= firstSprite;
+			m_ChunkEnd		= firstSprite + chunkCnt;
+			return true;
+		}
+
+		void CSpriteRenderer::DeviceSink::Draw(const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			//ranges crossing the end of the chunk continue in the next one
+			uint32 sprite = firstSprite;
+			uint32 end = firstSprite + spriteCnt;
+			while(sprite < end)
+			{
+				if((sprite < m_ChunkBegin || sprite >= m_ChunkEnd) && !this->UploadChunk(sprite))
+					return;
+
+				uint32 drawEnd = end < m_ChunkEnd ? end : m_ChunkEnd;
+				this->DrawPasses(m_Renderer->m_VertexBuffer, m_RingElement, sprite - m_ChunkBegin, drawEnd - sprite);
+				sprite = drawEnd;
+			}
+		}
+
+		void CSpriteRenderer::DeviceSink::DrawRetained(const uint32 firstSlot, const uint32 spriteCnt)
+		{
+			bool instanced = (m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED);
+			this->DrawPasses(m_Renderer->m_RetainedVertexBuffer, instanced ? firstSlot : firstSlot * 4, 0, spriteCnt);
+		}
+
+		void CSpriteRenderer::DeviceSink::DrawPasses(IDirect3DVertexBuffer9* const buffer, const uint32 baseElement, const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			uint16 numPasses = m_Effect->BeginRender();
+			for(uint16 pass = 0; pass < numPasses; pass++)
+			{
+				m_Effect->BeginPass(pass);
+				m_Renderer->DrawSprites(buffer, baseElement, firstSprite, spriteCnt);
+				m_Effect->EndPass();
+				++m_Renderer->m_LastDrawCnt;
+			}
+			m_Effect->EndRender();
+		}
+
+		void CSpriteRenderer::DeviceSink::End()
+		{
+			//leave the streams the way full screen quads and other renderers expect them
+			if(m_Renderer->m_RenderMode == SPRITE_MODE_INSTANCED)
+			{
+				m_Renderer->m_Device->SetStreamSourceFreq(0, 1);
+				m_Renderer->m_Device->SetStreamSourceFreq(1, 1);
+				m_Renderer->m_Device->SetStreamSource(1, NULL, 0, 0);
+			}
+			m_List = NULL;
+		}
+
+		void* CSpriteRenderer::LockVertexRing(const uint32 size, const uint32 stride, uint32& firstElement)
+		{
+			//vertices and instance records share the ring, keep every allocation on its own stride
+			uint32 offset = ((m_VertexRingPos + stride - 1) / stride) * stride;
+
+			//append behind data the gpu may still read, start over with a fresh buffer on wrap-around
+			DWORD flags = D3DLOCK_NOOVERWRITE;
+			if(offset + size > m_VertexRingSize)
+			{
+				flags = D3DLOCK_DISCARD;
+				offset = 0;
+			}
+
+			void* data = NULL;
+			HRESULT hr = m_VertexBuffer->Lock(offset, size, &data, flags);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Lock VertexBuffer Failed. [CSpriteRenderer::LockVertexRing]");
+				return NULL;
+			}
+
+			firstElement = offset / stride;
+			m_VertexRingPos = offset + size;
+			return data;
+		}
+
+		void CSpriteRenderer::DrawSprites(IDirect3DVertexBuffer9* const buffer, const uint32 baseElement, const uint32 firstSprite, const uint32 spriteCnt)
+		{
+			HRESULT hr;
+			if(m_RenderMode == SPRITE_MODE_INSTANCED)
+			{
+				//the unit quad is drawn spriteCnt times, each instance reads the next record
+				hr = m_Device->SetStreamSource(1, buffer, (baseElement + firstSprite) * sizeof(Instance_Sprite), sizeof(Instance_Sprite));
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::DrawSprites]");
+				}
+
+				hr = m_Device->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | spriteCnt);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("SetStreamSourceFreq Failed. [CSpriteRenderer::DrawSprites]");
+				}
+
+				hr = m_Device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, 4, 0, 2);
+			}
+			else
+			{
+				//ring and retained buffer alternate only where retained batches sit between streamed ones
+				if(buffer != m_BoundSpriteStream)
+				{
+					hr = m_Device->SetStreamSource(0, buffer, 0, m_SpriteVertexSize);
+					if(FAILED(hr))
+					{
+						DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::DrawSprites]");
+					}
+					m_BoundSpriteStream = buffer;
+				}
+
+				//indices restart at the chunk, the buffer offset goes in as base vertex
+				hr = m_Device->DrawIndexedPrimitive(	D3DPT_TRIANGLELIST, 
+														baseElement, 
+														firstSprite * 4, 
+														spriteCnt * 4, 
+														firstSprite * 6, 
+														spriteCnt * 2);
+			}
+
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("DrawIndexedPrimitive Failed. [CSpriteRenderer::DrawSprites]");
+			}
+		}
+
+		uint32 CSpriteRenderer::CoalesceBatches(const std::vector<RenderJob_Sprite*>& jobs, std::vector<SpriteBatch>& batches, const SpriteJobState* const jobStates)
+		{
+			batches.clear();
+
+			uint32 streamSprite = 0;
+			uint32 size = jobs.size();
+			for(uint32 i = 0; i < size; ++i)
+			{
+				const RenderJob_Sprite* job = jobs[i];
+				uint32 spriteCnt = jobStates != NULL ? jobStates[i].SpriteCnt : job->SpriteCnt;
+				TextureId texId = jobStates != NULL ? jobStates[i].TextureId : job->TextureId;
+				bool retained = (jobStates != NULL && jobStates[i].Slot != SPRITE_SLOT_NONE);
+				uint32 firstSprite = retained ? jobStates[i].Slot : streamSprite;
+
+				//culled away entirely
+				if(spriteCnt == 0)
+					continue;
+
+				//streamed jobs are entered back to back, retained ones merge only if their regions touch
+				if(!batches.empty())
+				{
+					SpriteBatch& last = batches.back();
+					if(	last.EffectId == job->EffectId &&
+						last.TextureId == texId &&
+						last.FinalAlpha == job->FinalAlpha &&
+						last.Retained == retained &&
+						last.FirstSprite + last.SpriteCnt == firstSprite)
+					{
+						last.SpriteCnt += spriteCnt;
+						if(!retained)
+							streamSprite += spriteCnt;
+						continue;
+					}
+				}
+
+				SpriteBatch batch;
+				batch.EffectId		= job->EffectId;
+				batch.TextureId		= texId;
+				batch.FinalAlpha	= job->FinalAlpha;
+				batch.FirstSprite	= firstSprite;
+				batch.SpriteCnt		= spriteCnt;
+				batch.Retained		= retained;
+				batches.push_back(batch);
+
+				if(!retained)
+					streamSprite += spriteCnt;
+			}
+
+			return batches.size();
+		}
+
+		void CSpriteRenderer::EnterSpritesIntoBuffer(void* const output, const uint32 firstSprite, const uint32 beginSprite, const uint32 endSprite)
+		{
+			if(beginSprite >= endSprite)
+				return;
+
+			//last job starting at or before beginSprite
+			uint32 job = std::upper_bound(m_JobSpriteOffsets.begin(), m_JobSpriteOffsets.end(), beginSprite) - m_JobSpriteOffsets.begin() - 1;
+
+			uint32 sprite = beginSprite;
+			while(sprite < endSprite)
+			{
+				uint32 jobBegin = m_JobSpriteOffsets[job];
+				uint32 jobEnd = m_JobSpriteOffsets[job+1];
+				uint32 end = jobEnd < endSprite ? jobEnd : endSprite;
+
+				//retained jobs take no room in the stream
+				if(end == sprite)
+				{
+					++job;
+					continue;
+				}
+
+				const RenderJob_Sprite::Sprite* sprites = &m_JobStates[job].Sprites[sprite - jobBegin];
+				if(m_RenderMode == SPRITE_MODE_INSTANCED)
+					m_InstanceKernel(&((Instance_Sprite*)output)[sprite - firstSprite], sprites, end - sprite, m_ScreenHeight, m_JobStates[job].TexTransform);
+				else if(m_VertexFormat != SPRITE_FORMAT_FLOAT)
+					m_CompactKernel(&((Vertex_SpriteCompact*)output)[(sprite - firstSprite) * 4], sprites, end - sprite, m_ScreenHeight, m_JobStates[job].TexTransform);
+				else
+					m_VertexKernel(&((Vertex_Sprite*)output)[(sprite - firstSprite) * 4], sprites, end - sprite, m_ScreenHeight, m_JobStates[job].TexTransform);
+
+				sprite = end;
+				++job;
+			}
+		}
+
+		void CSpriteRenderer::FillTask(void* const context, const uint32 beginSprite, const uint32 endSprite)
+		{
+			FillContext* fill = (FillContext*)context;
+			fill->Renderer->EnterSpritesIntoBuffer(fill->Output, fill->FirstSprite, fill->FirstSprite + beginSprite, fill->FirstSprite + endSprite);
+		}
+
+		SpriteJobHandle CSpriteRenderer::AddRetainedJob(RenderJob_Sprite* const job)
+		{
+			//frame memory is recycled after one frame, a retained job would keep pointing into it
+			if(this->IsFrameMemory(job) || this->IsFrameMemory(job->SpritePtr))
+			{
+				DEBUG_MSG("Retained Job In Frame Memory. [CSpriteRenderer::AddRetainedJob]");
+				return SpriteJobHandle_Invalid;
+			}
+
+			//sorted with the rest of the queue every frame, the key has to be current
+			job->RebuildSortingKey();
+
+			std::unordered_map<const RenderJob_Sprite*, uint32>::iterator iter = m_RetainedLookup.find(job);
+			if(iter != m_RetainedLookup.end())
+				return iter->second + 1;
+
+			RetainedSpriteJob retained;
+			retained.Job				= job;
+			retained.Alive				= true;
+			retained.Generation			= 1;
+			retained.BuiltGeneration	= 0;
+			retained.FirstSlot			= 0;
+			retained.SlotCnt			= 0;
+			retained.DrawnBuild			= 0;
+			retained.BuiltTexture		= TextureId_Default;
+			retained.BuiltTexTransform	= CSpriteVertexKernel::IdentityTexTransform;
+
+			uint32 index = m_RetainedJobs.size();
+			if(!m_RetainedFreeHandles.empty())
+			{
+				index = m_RetainedFreeHandles.back();
+				m_RetainedFreeHandles.pop_back();
+				m_RetainedJobs[index] = retained;
+			}
+			else
+				m_RetainedJobs.push_back(retained);
+
+			m_RetainedLookup[job] = index;
+			return index + 1;
+		}
+
+		void CSpriteRenderer::RemoveRetainedJob(const SpriteJobHandle handle)
+		{
+			if(handle == SpriteJobHandle_Invalid || handle > m_RetainedJobs.size() || !m_RetainedJobs[handle-1].Alive)
+				return;
+
+			RetainedSpriteJob& retained = m_RetainedJobs[handle-1];
+			if(retained.SlotCnt > 0)
+				this->FreeRetainedSlots(retained.FirstSlot, retained.SlotCnt);
+
+			m_RetainedLookup.erase(retained.Job);
+			retained.Job		= NULL;
+			retained.Alive		= false;
+			retained.SlotCnt	= 0;
+			m_RetainedFreeHandles.push_back(handle - 1);
+		}
+
+		void CSpriteRenderer::MarkRetainedJobDirty(const SpriteJobHandle handle)
+		{
+			if(handle == SpriteJobHandle_Invalid || handle > m_RetainedJobs.size() || !m_RetainedJobs[handle-1].Alive)
+				return;
+
+			m_RetainedJobs[handle-1].Job->RebuildSortingKey();
+			++m_RetainedJobs[handle-1].Generation;
+		}
+
+		bool CSpriteRenderer::AllocateRetainedSlots(const uint32 count, uint32& firstSlot)
+		{
+			//first fit, the free list is kept sorted and merged
+			for(uint32 i = 0; i < m_RetainedFreeSlots.size(); ++i)
+			{
+				SpriteSlotRange& range = m_RetainedFreeSlots[i];
+				if(range.Count < count)
+					continue;
+
+				firstSlot = range.First;
+				range.First += count;
+				range.Count -= count;
+				if(range.Count == 0)
+					m_RetainedFreeSlots.erase(m_RetainedFreeSlots.begin() + i);
+				return true;
+			}
+			return false;
+		}
+
+		void CSpriteRenderer::FreeRetainedSlots(const uint32 firstSlot, const uint32 count)
+		{
+			uint32 i = 0;
+			while(i < m_RetainedFreeSlots.size() && m_RetainedFreeSlots[i].First < firstSlot)
+				++i;
+
+			SpriteSlotRange range = { firstSlot, count };
+			m_RetainedFreeSlots.insert(m_RetainedFreeSlots.begin() + i, range);
+
+			//merge with the following and the preceding range
+			if(i + 1 < m_RetainedFreeSlots.size() && m_RetainedFreeSlots[i].First + m_RetainedFreeSlots[i].Count == m_RetainedFreeSlots[i+1].First)
+			{
+				m_RetainedFreeSlots[i].Count += m_RetainedFreeSlots[i+1].Count;
+				m_RetainedFreeSlots.erase(m_RetainedFreeSlots.begin() + i + 1);
+			}
+
+			if(i > 0 && m_RetainedFreeSlots[i-1].First + m_RetainedFreeSlots[i-1].Count == m_RetainedFreeSlots[i].First)
+			{
+				m_RetainedFreeSlots[i-1].Count += m_RetainedFreeSlots[i].Count;
+				m_RetainedFreeSlots.erase(m_RetainedFreeSlots.begin() + i);
+			}
+		}
+
+		uint32 CSpriteRenderer::PrepareRetainedJob(RetainedSpriteJob& retained, const TextureId texId, const SpriteTexTransform& texTransform, CSpriteCommandList& list)
+		{
+			uint32 spriteCnt = retained.Job->SpriteCnt;
+			bool rebuild =	retained.BuiltGeneration != retained.Generation ||
+							retained.BuiltTexture != texId ||
+							memcmp(&retained.BuiltTexTransform, &texTransform, sizeof(SpriteTexTransform)) != 0;
+
+			//outgrew its region, move it
+			if(spriteCnt > retained.SlotCnt)
+			{
+				if(retained.SlotCnt > 0)
+					this->FreeRetainedSlots(retained.FirstSlot, retained.SlotCnt);
+				retained.SlotCnt = 0;
+
+				//buffer full, the job is streamed until room frees up
+				if(!this->AllocateRetainedSlots(spriteCnt, retained.FirstSlot))
+					return SPRITE_SLOT_NONE;
+
+				retained.SlotCnt = spriteCnt;
+				rebuild = true;
+			}
+
+			if(!rebuild)
+			{
+				list.GetInfo().RetainedSpriteCnt += spriteCnt;
+				return retained.FirstSlot;
+			}
+
+			//entered now, the region is written when the list executes
+			SPRITESTATS(CSpriteRenderStats::TimePoint fillStart = CSpriteRenderStats::Now());
+			uint8* output = list.AddUploadRetained(retained.FirstSlot, spriteCnt);
+
+			if(m_RenderMode == SPRITE_MODE_INSTANCED)
+				m_InstanceKernel((Instance_Sprite*)output, retained.Job->SpritePtr, spriteCnt, m_ScreenHeight, texTransform);
+			else if(m_VertexFormat != SPRITE_FORMAT_FLOAT)
+				m_CompactKernel((Vertex_SpriteCompact*)output, retained.Job->SpritePtr, spriteCnt, m_ScreenHeight, texTransform);
+			else
+				m_VertexKernel((Vertex_Sprite*)output, retained.Job->SpritePtr, spriteCnt, m_ScreenHeight, texTransform);
+
+			SPRITESTATS(list.GetInfo().BuildStats.LockFillTime += CSpriteRenderStats::ElapsedMs(fillStart));
+
+			retained.BuiltGeneration	= retained.Generation;
+			retained.BuiltTexture		= texId;
+			retained.BuiltTexTransform	= texTransform;
+			list.GetInfo().RebuiltSpriteCnt += spriteCnt;
+			return retained.FirstSlot;
+		}
+
+		bool CSpriteRenderer::BeginCapture(const char* const path)
+		{
+			if(!m_Capture.Open(path, m_ScreenWidth, m_ScreenHeight))
+			{
+				DEBUG_MSG("Open Capture Failed. [CSpriteRenderer::BeginCapture]");
+				return false;
+			}
+			return true;
+		}
+
+		void CSpriteRenderer::EndCapture()
+		{
+			m_Capture.Close();
+		}
+
+		bool CSpriteRenderer::SetParallelFill(const uint32 numThreads, const uint32 grainSize, const uint32 threshold)
+		{
+			m_FillGrainSize = grainSize > 0 ? grainSize : 1;
+			m_FillThreshold = threshold;
+
+			if(numThreads == 0)
+			{
+				m_FillPool.Release();
+				return true;
+			}
+
+			if(m_FillPool.GetThreadCount() == numThreads)
+				return true;
+
+			if(!m_FillPool.Initialize(numThreads))
+			{
+				DEBUG_MSG("Initialize FillPool Failed. [CSpriteRenderer::SetParallelFill]");
+				return false;
+			}
+			return true;
+		}
+
+		void CSpriteRenderer::RenderQuad(CTexture* const quadTexture)
+		{
+			CEffect* effect = m_ResourceManager->GetPostProcessingEffect();
+			this->BindFullScreenQuad();
+			this->SetScreenMatrices(effect);
+			effect->SetTexture(EFFECT_PARAMETER(EffectParameterCache->GetHandle(effect, s_DiffuseTexture), s_DiffuseTexture), quadTexture);
+			this->DrawFullScreenQuad(effect);
+		}
+		
+		void CSpriteRenderer::RenderDeferredQuad(CTexture* const diffuseTexture, CTexture* const depthTexture, CTexture* const normalTexture)
+		{
+			CEffect* effect = m_ResourceManager->GetPostProcessingEffect();
+			this->BindFullScreenQuad();
+			this->SetScreenMatrices(effect);
+
+			const EffectParameterMap* parameters = EffectParameterCache->GetParameters(effect);
+			effect->SetTexture(EFFECT_PARAMETER(CEffectParameterCache::GetHandle(parameters, s_DiffuseTexture), s_DiffuseTexture), diffuseTexture);
+			effect->SetTexture(EFFECT_PARAMETER(CEffectParameterCache::GetHandle(parameters, s_DepthTexture), s_DepthTexture), depthTexture);
+			effect->SetTexture(EFFECT_PARAMETER(CEffectParameterCache::GetHandle(parameters, s_NormalTexture), s_NormalTexture), normalTexture);
+			this->DrawFullScreenQuad(effect);
+		}
+
+		bool CSpriteRenderer::CreateFullScreenQuad()
+		{
+			HRESULT hr = m_Device->CreateVertexBuffer(	sizeof(Vertex_Sprite) * 4,
+														D3DUSAGE_WRITEONLY,
+														NULL,
+														D3DPOOL_MANAGED,
+														&m_FullScreenQuadBuffer,
+														NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("CreateVertexBuffer Failed. [CSpriteRenderer::CreateFullScreenQuad]");
+				return false;
+			}
+
+			Vertex_Sprite* vertices;
+			hr = m_FullScreenQuadBuffer->Lock(0, 0, (void**)&vertices, NULL);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Lock FullScreenQuadBuffer Failed. [CSpriteRenderer::CreateFullScreenQuad]");
+				return false;
+			}
+
+			RenderJob_Sprite::Sprite sprite = RenderJob_Sprite::Sprite();
+			sprite.PositionMin = CVector2(0.0f, 0.0f);
+			sprite.PositionMax = CVector2(m_ScreenWidth, m_ScreenHeight);
+			
+			vertices[0].Texture0_U		= sprite.TexCoordMin.X;
+			vertices[0].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
+
+			vertices[1].Texture0_U		= sprite.TexCoordMin.X;
+			vertices[1].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
+
+			vertices[2].Texture0_U		= sprite.TexCoordMax.X;
+			vertices[2].Texture0_V		= 1.0f - sprite.TexCoordMin.Y;
+
+			vertices[3].Texture0_U		= sprite.TexCoordMax.X;
+			vertices[3].Texture0_V		= 1.0f - sprite.TexCoordMax.Y;
+
+			float32 minX = sprite.PositionMin.X - 1;
+			float32 minY = m_ScreenHeight - sprite.PositionMin.Y + 1;
+			float32 maxX = sprite.PositionMax.X;
+			float32 maxY = m_ScreenHeight - sprite.PositionMax.Y;
+			
+			vertices[0].Position	= CVector3(minX, minY, 0.0f);
+			vertices[1].Position	= CVector3(minX, maxY, 0.0f);
+			vertices[2].Position	= CVector3(maxX, maxY, 0.0f);
+			vertices[3].Position	= CVector3(maxX, minY, 0.0f);		
+
+			hr = m_FullScreenQuadBuffer->Unlock();
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("Unlock FullScreenQuadBuffer Failed. [CSpriteRenderer::CreateFullScreenQuad]");
+				return false;
+			}
+			return true;
+		}
+
+		void CSpriteRenderer::BindFullScreenQuad()
+		{
+			HRESULT hr = m_Device->SetStreamSource(0, m_FullScreenQuadBuffer, 0, sizeof(Vertex_Sprite));
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("SetStreamSource Failed. [CSpriteRenderer::BindFullScreenQuad]");
+			}
+			m_BoundSpriteStream = m_FullScreenQuadBuffer;
+
+			hr = m_Device->SetVertexDeclaration(m_VertexDeclaration);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("SetVertexDeclaration Failed. [CSpriteRenderer::BindFullScreenQuad]");
+			}
+
+			//the first quad of the sprite indices, present in both modes
+			hr = m_Device->SetIndices(m_IndexBuffer);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("SetIndices Failed. [CSpriteRenderer::BindFullScreenQuad]");
+			}
+		}
+
+		void CSpriteRenderer::SetScreenMatrices(CEffect* const effect)
+		{
+			const EffectParameterMap* parameters = EffectParameterCache->GetParameters(effect);
+			const EffectParameter* proj = CEffectParameterCache::FindParameter(parameters, s_MatProj);
+			const EffectParameter* view = CEffectParameterCache::FindParameter(parameters, s_MatView);
+			effect->SetMatrix(EFFECT_PARAMETER(proj != NULL ? proj->Handle : NULL, s_MatProj), &m_SpriteProjMatrix);
+			effect->SetMatrix(EFFECT_PARAMETER(view != NULL ? view->Handle : NULL, s_MatView), &m_SpriteViewMatrix);
+
+			//entity constants of the same name have to be sent again
+			EffectParameterCache->InvalidateUpload(effect, proj);
+			EffectParameterCache->InvalidateUpload(effect, view);
+		}
+
+		uint32 CSpriteRenderer::DrawFullScreenQuad(CEffect* const effect)
+		{
+			uint16 numPasses = effect->BeginRender();
+			for(uint16 pass = 0; pass < numPasses; pass++)
+			{
+				effect->BeginPass(pass);
+				
+				HRESULT hr = m_Device->DrawIndexedPrimitive(	D3DPT_TRIANGLELIST, 
+																0, 
+																0, 
+																4, 
+																0, 
+																2);
+				if(FAILED(hr))
+				{
+					DEBUG_MSG("DrawIndexedPrimitive Failed. [CSpriteRenderer::DrawFullScreenQuad]");
+				}
+
+				effect->EndPass();
+			}
+			effect->EndRender();
+			return numPasses;
+		}
+	};
 };
\ No newline at end of file
@@ -1,110 +1,515 @@
-/*
-	Renders screen aligned quads used for GUI or other 
-	2D visualization.
-*/
-
-#ifndef _CSPRITERENDERER_H_
-#define _CSPRITERENDERER_H_
-
-#include <d3d9.h>
-#include <deque>
-#include <algorithm>
-#include <vector>
-#include "../../Core/Header/Void.h"
-#include "../../Core/Header/CTimer.h"
-#include "../../Core/Header/CLog.h"
-#include "../../ResourceManagement/Header/CResourceManager.h"
-#include "../../Math/Header/CMatrix4x4.h"
-#include "RendererTypes.h"
-
-using namespace Void::Core;
-using namespace Void::ResourceManagement;
-using namespace Void::Math;
-
-namespace Void
-{
-	namespace Renderer
-	{
-		#define MAX_NUM_SPRITES		10000
-
-		struct Vertex_Sprite
-		{
-			CVector3	Position;
-			float32		Texture0_U;
-			float32		Texture0_V;
-		};
-
-		class CSpriteRenderer
-		{
-		private:
-			IDirect3DDevice9*					m_Device;
-			CResourceManager*					m_ResourceManager;
-
-			std::deque<RenderJob_Sprite* const>			m_JobQueueBackground[2];
-			uint16							m_BackgroundQueueCnt[2];
-			uint8							m_ActiveQueueBackground;
-
-			std::deque<RenderJob_Sprite* const>			m_JobQueueForeground[2];
-			uint16							m_ForegroundQueueCnt[2];
-			uint8							m_ActiveQueueForeground;
-
-			IDirect3DVertexDeclaration9*				m_VertexDeclaration;
-			IDirect3DVertexBuffer9*					m_VertexBuffer;
-			IDirect3DIndexBuffer9*					m_IndexBuffer;
-
-			CMatrix4x4						m_SpriteViewMatrix;
-			CMatrix4x4						m_SpriteProjMatrix;
-			CMatrix4x4						m_SpriteWorldMatrix;
-			float32							m_ScreenHeight;
-			float32							m_ScreenWidth;
-
-		private:
-			void EnterSpriteIntoBuffer (Vertex_Sprite* const vertices, const RenderJob_Sprite* const job);
-			void Render(std::deque<RenderJob_Sprite* const>& jobQueue);
-
-		public:
-			CSpriteRenderer();
-			~CSpriteRenderer();
-
-			bool Initialize(IDirect3DDevice9* const device, const float32 width, const float32 height);
-			void Release();
-
-			void AddRenderJob(RenderJob_Sprite* const job);
-
-			//used for post processing only
-			void RenderQuad(CTexture* const quadTexture);
-			
-			//testing deferred render
-			void RenderDeferredQuad(CTexture* const diffuseTexture, CTexture* const depthTexture, CTexture* const normalTexture);
-
-			inline void RenderBackground()
-			{
-				//swap queues
-				uint8 oldQueue = m_ActiveQueueBackground;
-				m_ActiveQueueBackground = (m_ActiveQueueBackground + 1) % 2;
-
-				//use old queue for render
-				this->Render(m_JobQueueBackground[oldQueue]);
-				m_BackgroundQueueCnt[oldQueue] = 0;
-			}
-
-			inline void RenderForeground()
-			{
-				//swap queues
-				uint8 oldQueue = m_ActiveQueueForeground;
-				m_ActiveQueueForeground = (m_ActiveQueueForeground + 1) % 2;
-
-				//use old queue for render
-				this->Render(m_JobQueueForeground[oldQueue]);
-				m_ForegroundQueueCnt[oldQueue] = 0;
-			}
-			
-			inline void InjectResourceManager(CResourceManager* const resManager)
-			{
-				m_ResourceManager = resManager;
-			}
-		};
-	};
-};
-
-#endif
+/*
+	Renders screen aligned quads used for GUI or other 
+	2D visualization.
+*/
+
+#ifndef _CSPRITERENDERER_H_
+#define _CSPRITERENDERER_H_
+
+#include <d3d9.h>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "../../Core/Header/Void.h"
+#include "../../Core/Header/CTimer.h"
+#include "../../Core/Header/CLog.h"
+#include "../../ResourceManagement/Header/CResourceManager.h"
+#include "../../Math/Header/CMatrix4x4.h"
+#include "RendererTypes.h"
+#include "CSpriteJobSorter.h"
+#include "CSpriteVertexKernel.h"
+#include "CWorkStealingPool.h"
+#include "CTextureAtlas.h"
+#include "CSpriteCuller.h"
+#include "CSpriteFrameArena.h"
+#include "CSpriteRenderStats.h"
+#include "CSpriteCapture.h"
+#include "CSpriteCommandList.h"
+#include "CEffectParameterCache.h"
+
+using namespace Void::Core;
+using namespace Void::ResourceManagement;
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//sprites held by the streaming vertexbuffer, larger queues are drawn in chunks
+		#define MAX_NUM_SPRITES		10000
+
+		//chunks the streaming ring holds, a frame only discards once all of them were written
+		#define SPRITE_RING_CHUNKS		4
+
+		//sprites the persistent buffer of retained jobs holds
+		#define MAX_NUM_RETAINED_SPRITES	10000
+
+		//marks sorted jobs that are streamed instead of drawn from the retained buffer
+		#define SPRITE_SLOT_NONE		0xFFFFFFFF
+
+		//0 is never handed out
+		typedef uint32 SpriteJobHandle;
+		#define SpriteJobHandle_Invalid		0
+
+		//run of consecutive sprites sharing effect, texture and alpha
+		struct SpriteBatch
+		{
+			EffectId	EffectId;
+			TextureId	TextureId;
+			float32		FinalAlpha;
+			uint32		FirstSprite;	//into the frame's stream, or the retained buffer if Retained
+			uint32		SpriteCnt;
+			bool		Retained;
+		};
+
+		//job registered once and redrawn every frame from its own buffer region
+		struct RetainedSpriteJob
+		{
+			RenderJob_Sprite*	Job;
+			bool			Alive;
+			uint32			Generation;
+			uint32			BuiltGeneration;
+			uint32			FirstSlot;
+			uint32			SlotCnt;
+
+			//last build the job was drawn in, a copy queued through AddRenderJob is dropped
+			uint32			DrawnBuild;
+
+			//texture state the region was built with, a changed atlas remap forces a rebuild
+			TextureId		BuiltTexture;
+			SpriteTexTransform	BuiltTexTransform;
+		};
+
+		//what a sorted job is drawn with during one build
+		struct SpriteJobState
+		{
+			const RenderJob_Sprite::Sprite*	Sprites;	//the job's own array or the culled survivors
+			uint32			SpriteCnt;
+			TextureId		TextureId;	//atlas page or the job's texture
+			SpriteTexTransform	TexTransform;
+			uint32			Slot;		//retained buffer region, SPRITE_SLOT_NONE when streamed
+		};
+
+		struct SpriteSlotRange
+		{
+			uint32		First;
+			uint32		Count;
+		};
+
+		//per producer thread append buffer and frame memory, indexed [IsCurtain][queue]
+		struct SpriteSubmitBuffer
+		{
+			std::thread::id				Owner;
+			std::atomic<uint32>			Busy;
+
+			//renderer and producer thread, the last one to let go deletes the buffer
+			//down to 1 while registered means the thread exited
+			std::atomic<uint32>			Refs;
+			std::vector<RenderJob_Sprite*>		Jobs[2][2];
+			CSpriteFrameArena			Arenas[2][2];
+
+			//job between BeginSpriteJob and EndSpriteJob, at most one per thread
+			RenderJob_Sprite*			OpenJob;
+			uint8					OpenCurtain;
+			uint8					OpenQueue;
+		};
+
+		class CSpriteRenderer
+		{
+		private:
+			//what a fill worker needs to enter its sprite range
+			struct FillContext
+			{
+				CSpriteRenderer*	Renderer;
+				void*			Output;
+				uint32			FirstSprite;
+			};
+
+			//replays command lists on m_Device, streams the payload through the ring in chunks that fit
+			class DeviceSink : public CSpriteCommandSink
+			{
+			private:
+				CSpriteRenderer*		m_Renderer;
+				const CSpriteCommandList*	m_List;
+				CEffect*			m_Effect;
+
+				//NULL while the effect does not know the parameter, its name is passed then
+				//textures are never tracked, alpha is and its upload record is dropped on every set
+				EffectParameterHandle		m_TextureHandle;
+				const EffectParameter*		m_AlphaParameter;
+
+				//stream payload sprites the ring holds right now
+				uint32				m_ChunkBegin;
+				uint32				m_ChunkEnd;
+				uint32				m_RingElement;
+
+			private:
+				bool UploadChunk(const uint32 firstSprite);
+				void DrawPasses(IDirect3DVertexBuffer9* const buffer, const uint32 baseElement, const uint32 firstSprite, const uint32 spriteCnt);
+
+			public:
+				DeviceSink(CSpriteRenderer* const renderer);
+
+				virtual void Begin(const CSpriteCommandList& list);
+				virtual void BindEffect(const EffectId id);
+				virtual void BindTexture(const TextureId id);
+				virtual void SetAlpha(const float32 alpha);
+				virtual void UploadRetained(const uint32 firstSlot, const uint32 spriteCnt, const uint8* const data);
+				virtual void Draw(const uint32 firstSprite, const uint32 spriteCnt);
+				virtual void DrawRetained(const uint32 firstSlot, const uint32 spriteCnt);
+				virtual void End();
+			};
+
+			IDirect3DDevice9*					m_Device;
+			CResourceManager*					m_ResourceManager;
+
+			//sprites pushed into each queue, cleared once the queue was built
+			std::deque<RenderJob_Sprite* const>			m_JobQueueBackground[2];
+			std::atomic<uint32>					m_BackgroundQueueCnt[2];
+			std::atomic<uint8>					m_ActiveQueueBackground;
+
+			std::deque<RenderJob_Sprite* const>			m_JobQueueForeground[2];
+			std::atomic<uint32>					m_ForegroundQueueCnt[2];
+			std::atomic<uint8>					m_ActiveQueueForeground;
+
+			//producers append lock-free into their own buffer, the list only grows under the lock
+			std::mutex						m_SubmitLock;
+			std::vector<SpriteSubmitBuffer*>			m_SubmitBuffers;
+			uint32							m_InstanceId;
+
+			SpriteRenderMode					m_RenderMode;
+			IDirect3DVertexDeclaration9*				m_VertexDeclaration;
+			IDirect3DVertexDeclaration9*				m_InstanceDeclaration;
+			IDirect3DVertexDeclaration9*				m_CompactDeclaration;
+			IDirect3DVertexBuffer9*					m_VertexBuffer;
+			IDirect3DVertexBuffer9*					m_QuadCornerBuffer;
+			IDirect3DVertexBuffer9*					m_FullScreenQuadBuffer;
+			IDirect3DIndexBuffer9*					m_IndexBuffer;
+
+			//streaming ring in bytes, holds vertices or instance records depending on the mode
+			uint32							m_VertexRingSize;
+			uint32							m_VertexRingPos;
+
+			//set while RenderBackground/RenderForeground build, the list is executed on the device right after
+			//so the build fills the ring itself instead of the list's stream
+			bool							m_FillRing;
+
+			CMatrix4x4						m_SpriteViewMatrix;
+			CMatrix4x4						m_SpriteProjMatrix;
+			CMatrix4x4						m_SpriteWorldMatrix;
+			float32							m_ScreenHeight;
+			float32							m_ScreenWidth;
+			SpriteVertexKernel					m_VertexKernel;
+			SpriteInstanceKernel					m_InstanceKernel;
+			SpriteCompactKernel					m_CompactKernel;
+
+			//layout of sprite vertices, full screen quads stay on Vertex_Sprite
+			SpriteVertexFormat					m_VertexFormat;
+			uint32							m_SpriteVertexSize;
+
+			CSpriteJobSorter					m_JobSorter;
+			std::vector<RenderJob_Sprite*>				m_SortedJobs;
+
+			//with an atlas: keys with the page as texture, the entry of every queued job and where it sorted from
+			std::vector<uint64>					m_SortKeys;
+			std::vector<const AtlasEntry*>				m_QueueAtlasEntries;
+			std::vector<uint32>					m_SortOrder;
+			std::vector<SpriteBatch>				m_Batches;
+
+			//first sprite of every sorted job, plus the total at the end
+			std::vector<uint32>					m_JobSpriteOffsets;
+
+			//state every sorted job is batched and drawn with
+			std::vector<SpriteJobState>				m_JobStates;
+			CTextureAtlas*						m_Atlas;
+			CSpriteCuller						m_Culler;
+
+			//retained jobs, the handle is the index plus one
+			std::vector<RetainedSpriteJob>				m_RetainedJobs;
+			uint32							m_BuildCnt;
+			std::vector<uint32>					m_RetainedFreeHandles;
+			std::unordered_map<const RenderJob_Sprite*, uint32>	m_RetainedLookup;
+			std::vector<SpriteSlotRange>				m_RetainedFreeSlots;
+			IDirect3DVertexBuffer9*					m_RetainedVertexBuffer;
+			IDirect3DVertexBuffer9*					m_BoundSpriteStream;
+
+			CWorkStealingPool					m_FillPool;
+			uint32							m_FillGrainSize;
+			uint32							m_FillThreshold;
+
+			uint32							m_LastJobCnt;
+			uint32							m_LastBatchCnt;
+			uint32							m_LastDrawCnt;
+			uint32							m_LastAtlasJobCnt;
+			uint32							m_LastRetainedSpriteCnt;
+			uint32							m_LastRebuiltSpriteCnt;
+			uint32							m_LastScreenCulledCnt;
+			uint32							m_LastClipCulledCnt;
+			uint32							m_LastOverdrawCulledCnt;
+
+			//summed over all producer threads, taken right before the arenas of a queue are reset
+			FrameArenaStats						m_LastArenaStats[2];
+
+			//list RenderBackground and RenderForeground build and execute right away
+			CSpriteCommandList					m_CommandList;
+
+			//only counted with VOID_SPRITE_STATS, the frame is committed by executing a foreground list
+			SpriteFrameStats					m_FrameStats;
+			CSpriteRenderStats					m_Stats;
+
+			//every Render call is written while open
+			CSpriteCaptureWriter					m_Capture;
+
+		private:
+			SpriteSubmitBuffer* GetSubmitBuffer();
+			void PushJob(SpriteSubmitBuffer* const buffer, RenderJob_Sprite* const job, const uint8 curtain, const uint8 queue);
+			void MergeSubmitBuffers(const uint8 curtain, const uint8 queue, std::deque<RenderJob_Sprite* const>& jobQueue);
+			void ResetFrameArenas(const uint8 curtain, const uint8 queue);
+			bool IsFrameMemory(const void* const memory);
+			void* LockVertexRing(const uint32 size, const uint32 stride, uint32& firstElement);
+			void EnterSpritesIntoBuffer(void* const output, const uint32 firstSprite, const uint32 beginSprite, const uint32 endSprite);
+			void DrawSprites(IDirect3DVertexBuffer9* const buffer, const uint32 baseElement, const uint32 firstSprite, const uint32 spriteCnt);
+			static void FillTask(void* const context, const uint32 beginSprite, const uint32 endSprite);
+			bool AllocateRetainedSlots(const uint32 count, uint32& firstSlot);
+			void FreeRetainedSlots(const uint32 firstSlot, const uint32 count);
+			uint32 PrepareRetainedJob(RetainedSpriteJob& retained, const TextureId texId, const SpriteTexTransform& texTransform, CSpriteCommandList& list);
+			void Build(std::deque<RenderJob_Sprite* const>& jobQueue, const uint8 curtain, CSpriteCommandList& list, const bool keepCoverage);
+
+			inline void BuildBackgroundLayer(CSpriteCommandList& list, const bool keepCoverage)
+			{
+				//swap queues
+				uint8 oldQueue = m_ActiveQueueBackground.load();
+				m_ActiveQueueBackground.store((oldQueue + 1) % 2);
+
+				//use old queue for the build
+				this->MergeSubmitBuffers(0, oldQueue, m_JobQueueBackground[oldQueue]);
+				this->Build(m_JobQueueBackground[oldQueue], 0, list, keepCoverage);
+				this->ResetFrameArenas(0, oldQueue);
+				m_BackgroundQueueCnt[oldQueue] = 0;
+			}
+
+			inline void BuildForegroundLayer(CSpriteCommandList& list)
+			{
+				//swap queues
+				uint8 oldQueue = m_ActiveQueueForeground.load();
+				m_ActiveQueueForeground.store((oldQueue + 1) % 2);
+
+				//use old queue for the build
+				this->MergeSubmitBuffers(1, oldQueue, m_JobQueueForeground[oldQueue]);
+				this->Build(m_JobQueueForeground[oldQueue], 1, list, false);
+				this->ResetFrameArenas(1, oldQueue);
+				m_ForegroundQueueCnt[oldQueue] = 0;
+			}
+			bool CreateFullScreenQuad();
+
+		public:
+			CSpriteRenderer();
+			~CSpriteRenderer();
+
+			//a compact format the device can not read falls back to SPRITE_FORMAT_FLOAT, and SPRITE_MODE_INSTANCED
+			//to SPRITE_MODE_VERTEX (see SpriteRenderMode)
+			//a NULL device sets up a headless renderer, its lists have to be executed into a sink
+			bool Initialize(IDirect3DDevice9* const device, const float32 width, const float32 height, const SpriteRenderMode mode = SPRITE_MODE_VERTEX, const SpriteVertexFormat format = SPRITE_FORMAT_FLOAT);
+			void Release();
+
+			//safe to call from any thread, jobs show up in the next RenderBackground/RenderForeground
+			//keepSortingKey skips RebuildSortingKey for jobs whose key was set elsewhere, e.g. replayed captures
+			void AddRenderJob(RenderJob_Sprite* const job, const bool keepSortingKey = false);
+
+			//builds a job in frame memory of the calling thread, nothing has to be kept alive or freed
+			//SpritePtr holds spriteCnt uninitialized sprites, SpriteCnt may be lowered before EndSpriteJob
+			//the memory is recycled once the job's queue was rendered, the render thread waits for open
+			//builds at the queue swap so keep them short, one open build per thread
+			RenderJob_Sprite* BeginSpriteJob(const bool curtain, const uint32 spriteCnt);
+			void EndSpriteJob(RenderJob_Sprite* const job);
+
+			//fills the vertexbuffer on numThreads workers once a queue holds threshold sprites, 0 threads disables
+			bool SetParallelFill(const uint32 numThreads, const uint32 grainSize = 1024, const uint32 threshold = 4096);
+
+			//retained jobs are drawn every frame in their layer until removed, the job must stay alive until then
+			//jobs from BeginSpriteJob live one frame only and are refused
+			//the sorting key is rebuilt here, the job is drawn once even if it is passed to AddRenderJob as well
+			//not thread safe, call from the render thread
+			SpriteJobHandle AddRetainedJob(RenderJob_Sprite* const job);
+			void RemoveRetainedJob(const SpriteJobHandle handle);
+
+			//sprites, their count or the job's state changed, the key is rebuilt and the job re-entered on its next draw
+			void MarkRetainedJobDirty(const SpriteJobHandle handle);
+
+			//screen stage is on by default, the overdraw stage needs opaque textures and effects marked
+			//coverage carries from the foreground into the background only when both are built by BuildFrame
+			inline void SetCulling(const bool screenCull, const bool overdrawCull)
+			{
+				m_Culler.SetStages(screenCull, overdrawCull);
+			}
+
+			inline void SetClipRect(const uint8 curtain, const CVector2& min, const CVector2& max)
+			{
+				m_Culler.SetClipRect(curtain, min, max);
+			}
+
+			inline void ClearClipRect(const uint8 curtain)
+			{
+				m_Culler.ClearClipRect(curtain);
+			}
+
+			inline void SetTextureOpaque(const TextureId id, const bool opaque)
+			{
+				m_Culler.SetTextureOpaque(id, opaque);
+			}
+
+			//effects drawing without blending, sprites of blending effects never hide others
+			inline void SetEffectOpaque(const EffectId id, const bool opaque)
+			{
+				m_Culler.SetEffectOpaque(id, opaque);
+			}
+
+			//merges state-compatible neighbours of a sorted job list, does not touch the device
+			//jobStates overrides sprite count, texture and retained region of the jobs when given
+			static uint32 CoalesceBatches(const std::vector<RenderJob_Sprite*>& jobs, std::vector<SpriteBatch>& batches, const SpriteJobState* const jobStates = NULL);
+
+			//used for post processing only
+			void RenderQuad(CTexture* const quadTexture);
+			
+			//testing deferred render
+			void RenderDeferredQuad(CTexture* const diffuseTexture, CTexture* const depthTexture, CTexture* const normalTexture);
+
+			//binds the static full screen quad with its declaration and indices, any number of
+			//DrawFullScreenQuad calls may follow until other geometry is bound
+			void BindFullScreenQuad();
+
+			//screen space matrices, once per effect is enough while the effect keeps them
+			void SetScreenMatrices(CEffect* const effect);
+
+			//every pass of effect over the bound quad, returns the number of draws
+			uint32 DrawFullScreenQuad(CEffect* const effect);
+
+			//sorts, culls, batches and enters the swapped queue of a layer into list, the device is not touched
+			//list holds copies of the sprites, the queue's frame memory is recycled right after
+			//one build at a time, it may run on a worker while the device thread executes the previous list
+			//retained jobs, capture and atlas registration belong to the building thread then, first atlas
+			//lookups of a texture copy texels and need a multithreaded device off the device thread
+			inline void BuildBackground(CSpriteCommandList& list)
+			{
+				this->BuildBackgroundLayer(list, false);
+			}
+
+			inline void BuildForeground(CSpriteCommandList& list)
+			{
+				this->BuildForegroundLayer(list);
+
+				//the foreground closes the frame, pages both layers used so far stay safe from eviction until here
+				if(m_Atlas != NULL)
+					m_Atlas->NextFrame();
+			}
+
+			//builds both layers front to back, opaque foreground sprites hide background sprites as well
+			//the lists are still executed background first, the frame is closed once both are built
+			inline void BuildFrame(CSpriteCommandList& background, CSpriteCommandList& foreground)
+			{
+				this->BuildForegroundLayer(foreground);
+				this->BuildBackgroundLayer(background, true);
+
+				if(m_Atlas != NULL)
+					m_Atlas->NextFrame();
+			}
+
+			//replays list on the device, call from the thread owning it, a foreground list closes the stats frame
+			//sink replaces the device, e.g. a CSpriteNullSink in benchmarks or a CSpriteCommandRecorder in tests
+			void Execute(const CSpriteCommandList& list, CSpriteCommandSink* const sink = NULL);
+
+			inline void RenderBackground()
+			{
+				m_FillRing = (m_Device != NULL);
+				this->BuildBackground(m_CommandList);
+				m_FillRing = false;
+				this->Execute(m_CommandList);
+			}
+
+			inline void RenderForeground()
+			{
+				m_FillRing = (m_Device != NULL);
+				this->BuildForeground(m_CommandList);
+				m_FillRing = false;
+				this->Execute(m_CommandList);
+			}
+			
+			//counters of the last executed list
+			inline uint32 GetLastJobCount() const		{ return m_LastJobCnt; }
+			inline uint32 GetLastBatchCount() const		{ return m_LastBatchCnt; }
+			inline uint32 GetLastDrawCount() const		{ return m_LastDrawCnt; }
+			inline uint32 GetLastCoalescedJobCount() const	{ return m_LastJobCnt - m_LastBatchCnt; }
+			inline uint32 GetLastAtlasJobCount() const	{ return m_LastAtlasJobCnt; }
+
+			//retained sprites drawn straight from their region vs. sprites entered this call (streamed and dirty retained)
+			inline uint32 GetLastRetainedSpriteCount() const	{ return m_LastRetainedSpriteCnt; }
+			inline uint32 GetLastRebuiltSpriteCount() const	{ return m_LastRebuiltSpriteCnt; }
+
+			//sprites dropped by each culling stage
+			inline uint32 GetLastScreenCulledCount() const	{ return m_LastScreenCulledCnt; }
+			inline uint32 GetLastClipCulledCount() const	{ return m_LastClipCulledCnt; }
+			inline uint32 GetLastOverdrawCulledCount() const	{ return m_LastOverdrawCulledCnt; }
+
+			//writes the jobs of every following build to path, see CSpriteCaptureReplay
+			//not thread safe, call from the building thread
+			bool BeginCapture(const char* const path);
+			void EndCapture();
+
+			//history, percentiles and budgets, stays empty without VOID_SPRITE_STATS
+			inline CSpriteRenderStats& GetStats()
+			{
+				return m_Stats;
+			}
+
+			//sprites submitted to a layer since its last build, what the next build will have to handle
+			//jobs still open between BeginSpriteJob and EndSpriteJob are not counted yet
+			inline uint32 GetPendingSpriteCount(const uint8 curtain) const
+			{
+				if(curtain == 0)
+					return m_BackgroundQueueCnt[m_ActiveQueueBackground.load()].load();
+				return m_ForegroundQueueCnt[m_ActiveQueueForeground.load()].load();
+			}
+
+			//producer threads with a buffer, the buffer of an exited thread goes once its jobs were built
+			inline uint32 GetSubmitBufferCount()
+			{
+				std::lock_guard<std::mutex> lock(m_SubmitLock);
+				return m_SubmitBuffers.size();
+			}
+
+			//frame memory the jobs of the last rendered queue of a layer used, summed over the producers
+			//except HighWater, which is the peak of the busiest single producer
+			inline const FrameArenaStats& GetLastFrameArenaStats(const uint8 curtain) const
+			{
+				return m_LastArenaStats[curtain];
+			}
+
+			inline SpriteRenderMode GetRenderMode() const
+			{
+				return m_RenderMode;
+			}
+
+			inline SpriteVertexFormat GetVertexFormat() const
+			{
+				return m_VertexFormat;
+			}
+
+			inline void InjectResourceManager(CResourceManager* const resManager)
+			{
+				m_ResourceManager = resManager;
+			}
+
+			//atlas page ids have to be known to the resource manager, NULL draws every job with its own texture
+			inline void InjectTextureAtlas(CTextureAtlas* const atlas)
+			{
+				m_Atlas = atlas;
+			}
+		};
+	};
+};
+
+#endif
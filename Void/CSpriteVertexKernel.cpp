@@ -0,0 +1,543 @@
+#include "../Header/CSpriteVertexKernel.h"
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//builds the 5 vectors (80 bytes) of one quad from flipped position and texcoord rects
+		//pos = [minX, H-minY, maxX, H-maxY], tex = [minU, 1-minV, maxU, 1-maxV]
+		static inline void BuildQuad(const __m128 pos, const __m128 tex, const __m128 zero, __m128* const out)
+		{
+			out[0] = _mm_shuffle_ps(pos, _mm_unpacklo_ps(zero, tex), _MM_SHUFFLE(1,0,1,0));
+			out[1] = _mm_shuffle_ps(_mm_shuffle_ps(tex, pos, _MM_SHUFFLE(0,0,3,3)), _mm_unpackhi_ps(pos, zero), _MM_SHUFFLE(1,2,2,0));
+			out[2] = _mm_shuffle_ps(tex, pos, _MM_SHUFFLE(3,2,1,0));
+			out[3] = _mm_shuffle_ps(_mm_unpackhi_ps(zero, tex), _mm_shuffle_ps(tex, pos, _MM_SHUFFLE(2,2,1,1)), _MM_SHUFFLE(2,0,1,0));
+			out[4] = _mm_shuffle_ps(_mm_unpacklo_ps(_mm_shuffle_ps(pos, pos, _MM_SHUFFLE(1,1,1,1)), zero), tex, _MM_SHUFFLE(3,2,1,0));
+		}
+
+		//clamp first, so the scalar and sse2 paths saturate the same way
+		static inline int16 QuantizePosition(const float32 value)
+		{
+			float32 clamped = value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value);
+			return (int16)lrintf(clamped);
+		}
+
+		static inline uint16 QuantizeUNorm(const float32 value)
+		{
+			float32 clamped = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			return (uint16)lrintf(clamped * 65535.0f);
+		}
+
+		//four floats to halfs in the low 16 bits of each lane, same rounding as FloatToHalf
+		static inline __m128i FloatToHalfSSE2(const __m128 value)
+		{
+			const __m128i signMask		= _mm_set1_epi32(0x80000000);
+			const __m128i halfMax		= _mm_set1_epi32((127 + 16) << 23);
+			const __m128i minNormal		= _mm_set1_epi32((127 - 14) << 23);
+			const __m128i subnormMagic	= _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+			const __m128i normalBias	= _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+			const __m128i infinity		= _mm_set1_epi32(0x7C00);
+			const __m128i nanBit		= _mm_set1_epi32(0x200);
+
+			__m128 sign		= _mm_and_ps(_mm_castsi128_ps(signMask), value);
+			__m128 absValue	= _mm_xor_ps(value, sign);
+			__m128i bits	= _mm_castps_si128(absValue);
+
+			__m128i isNaN		= _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+			__m128i isRegular	= _mm_cmpgt_epi32(halfMax, bits);
+			__m128i isSubnorm	= _mm_cmpgt_epi32(minNormal, bits);
+			__m128i infOrNaN	= _mm_or_si128(infinity, _mm_and_si128(isNaN, nanBit));
+
+			//subnormals: let the fpu align the mantissa
+			__m128i subnorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_castsi128_ps(subnormMagic))), subnormMagic);
+
+			//normals: rebias the exponent and round to nearest even
+			__m128i mantOdd	= _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+			__m128i normal	= _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), mantOdd), 13);
+
+			__m128i finite	= _mm_or_si128(_mm_and_si128(isSubnorm, subnorm), _mm_andnot_si128(isSubnorm, normal));
+			__m128i result	= _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNaN));
+			return _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+		}
+
+		static inline void FillCompactScalar(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform, const bool halfTexCoords)
+		{
+			uint32 index = 0;
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				float32 minU = sprite.TexCoordMin.X * texTransform.ScaleU + texTransform.OffsetU;
+				float32 minV = 1.0f - (sprite.TexCoordMin.Y * texTransform.ScaleV + texTransform.OffsetV);
+				float32 maxU = sprite.TexCoordMax.X * texTransform.ScaleU + texTransform.OffsetU;
+				float32 maxV = 1.0f - (sprite.TexCoordMax.Y * texTransform.ScaleV + texTransform.OffsetV);
+
+				uint16 u0 = halfTexCoords ? CSpriteVertexKernel::FloatToHalf(minU) : QuantizeUNorm(minU);
+				uint16 u1 = halfTexCoords ? CSpriteVertexKernel::FloatToHalf(maxU) : QuantizeUNorm(maxU);
+				uint16 v0 = halfTexCoords ? CSpriteVertexKernel::FloatToHalf(minV) : QuantizeUNorm(minV);
+				uint16 v1 = halfTexCoords ? CSpriteVertexKernel::FloatToHalf(maxV) : QuantizeUNorm(maxV);
+
+				int16 minX = QuantizePosition(sprite.PositionMin.X);
+				int16 minY = QuantizePosition(screenHeight - sprite.PositionMin.Y);
+				int16 maxX = QuantizePosition(sprite.PositionMax.X);
+				int16 maxY = QuantizePosition(screenHeight - sprite.PositionMax.Y);
+
+				//same corner order as FillScalar
+				vertices[0+index].PositionX = minX;	vertices[0+index].PositionY = minY;
+				vertices[0+index].Texture0_U = u0;	vertices[0+index].Texture0_V = v1;
+
+				vertices[1+index].PositionX = minX;	vertices[1+index].PositionY = maxY;
+				vertices[1+index].Texture0_U = u0;	vertices[1+index].Texture0_V = v0;
+
+				vertices[2+index].PositionX = maxX;	vertices[2+index].PositionY = maxY;
+				vertices[2+index].Texture0_U = u1;	vertices[2+index].Texture0_V = v0;
+
+				vertices[3+index].PositionX = maxX;	vertices[3+index].PositionY = minY;
+				vertices[3+index].Texture0_U = u1;	vertices[3+index].Texture0_V = v1;
+
+				index += 4;
+			}
+		}
+
+		static inline void FillCompactSSE2(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform, const bool halfTexCoords)
+		{
+			const __m128 flipMask	= _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+			const __m128 height		= _mm_set1_ps(screenHeight);
+			const __m128 one		= _mm_set1_ps(1.0f);
+			const __m128 zero		= _mm_setzero_ps();
+			const __m128 posMin		= _mm_set1_ps(-32768.0f);
+			const __m128 posMax		= _mm_set1_ps(32767.0f);
+			const __m128 unormScale	= _mm_set1_ps(65535.0f);
+			const __m128 texScale	= _mm_setr_ps(texTransform.ScaleU, texTransform.ScaleV, texTransform.ScaleU, texTransform.ScaleV);
+			const __m128 texOffset	= _mm_setr_ps(texTransform.OffsetU, texTransform.OffsetV, texTransform.OffsetU, texTransform.OffsetV);
+
+			//a quad is 32 bytes, two vectors
+			bool aligned = ((size_t)vertices & 0xF) == 0;
+			__m128i* dst = (__m128i*)vertices;
+
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				__m128 pos = _mm_setr_ps(sprite.PositionMin.X, sprite.PositionMin.Y, sprite.PositionMax.X, sprite.PositionMax.Y);
+				__m128 tex = _mm_setr_ps(sprite.TexCoordMin.X, sprite.TexCoordMin.Y, sprite.TexCoordMax.X, sprite.TexCoordMax.Y);
+				tex = _mm_add_ps(_mm_mul_ps(tex, texScale), texOffset);
+
+				//pos = [minX, H-minY, maxX, H-maxY], tex = [minU, 1-minV, maxU, 1-maxV]
+				pos = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(height, pos)), _mm_andnot_ps(flipMask, pos));
+				tex = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(one, tex)), _mm_andnot_ps(flipMask, tex));
+
+				//corners 0,1 and 2,3 side by side
+				__m128 pos01 = _mm_shuffle_ps(pos, pos, _MM_SHUFFLE(3,0,1,0));
+				__m128 pos23 = _mm_shuffle_ps(pos, pos, _MM_SHUFFLE(1,2,3,2));
+				__m128 tex01 = _mm_shuffle_ps(tex, tex, _MM_SHUFFLE(1,0,3,0));
+				__m128 tex23 = _mm_shuffle_ps(tex, tex, _MM_SHUFFLE(3,2,1,2));
+
+				__m128i qPos01 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(pos01, posMax), posMin));
+				__m128i qPos23 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(pos23, posMax), posMin));
+
+				__m128i qTex01;
+				__m128i qTex23;
+				if(halfTexCoords)
+				{
+					qTex01 = FloatToHalfSSE2(tex01);
+					qTex23 = FloatToHalfSSE2(tex23);
+				}
+				else
+				{
+					qTex01 = _mm_cvtps_epi32(_mm_mul_ps(_mm_max_ps(_mm_min_ps(tex01, one), zero), unormScale));
+					qTex23 = _mm_cvtps_epi32(_mm_mul_ps(_mm_max_ps(_mm_min_ps(tex23, one), zero), unormScale));
+				}
+
+				//sign extend the 16 bit patterns so the saturating pack keeps them as they are
+				qTex01 = _mm_srai_epi32(_mm_slli_epi32(qTex01, 16), 16);
+				qTex23 = _mm_srai_epi32(_mm_slli_epi32(qTex23, 16), 16);
+
+				//one 32 bit pair per corner, then interleave position and texcoord pairs
+				__m128i pos16 = _mm_packs_epi32(qPos01, qPos23);
+				__m128i tex16 = _mm_packs_epi32(qTex01, qTex23);
+				__m128i out0 = _mm_unpacklo_epi32(pos16, tex16);
+				__m128i out1 = _mm_unpackhi_epi32(pos16, tex16);
+
+				if(aligned)
+				{
+					_mm_stream_si128(dst + 0, out0);
+					_mm_stream_si128(dst + 1, out1);
+				}
+				else
+				{
+					_mm_storeu_si128(dst + 0, out0);
+					_mm_storeu_si128(dst + 1, out1);
+				}
+				dst += 2;
+			}
+
+			_mm_sfence();
+		}
+
+		void CSpriteVertexKernel::FillScalar(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			uint32 index = 0;
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				float32 minU = sprite.TexCoordMin.X * texTransform.ScaleU + texTransform.OffsetU;
+				float32 minV = sprite.TexCoordMin.Y * texTransform.ScaleV + texTransform.OffsetV;
+				float32 maxU = sprite.TexCoordMax.X * texTransform.ScaleU + texTransform.OffsetU;
+				float32 maxV = sprite.TexCoordMax.Y * texTransform.ScaleV + texTransform.OffsetV;
+
+				vertices[0+index].Texture0_U		= minU;
+				vertices[0+index].Texture0_V		= 1.0f - maxV;
+
+				vertices[1+index].Texture0_U		= minU;
+				vertices[1+index].Texture0_V		= 1.0f - minV;
+
+				vertices[2+index].Texture0_U		= maxU;
+				vertices[2+index].Texture0_V		= 1.0f - minV;
+
+				vertices[3+index].Texture0_U		= maxU;
+				vertices[3+index].Texture0_V		= 1.0f - maxV;
+
+				float32 minX = sprite.PositionMin.X;
+				float32 minY = screenHeight - sprite.PositionMin.Y;
+				float32 maxX = sprite.PositionMax.X;
+				float32 maxY = screenHeight - sprite.PositionMax.Y;
+
+				vertices[0+index].Position	= CVector3(minX, minY, 0.0f);
+				vertices[1+index].Position	= CVector3(minX, maxY, 0.0f);
+				vertices[2+index].Position	= CVector3(maxX, maxY, 0.0f);
+				vertices[3+index].Position	= CVector3(maxX, minY, 0.0f);
+
+				index += 4;
+			}
+		}
+
+		void CSpriteVertexKernel::FillSSE2(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			//only the y components get flipped, x passes through untouched
+			const __m128 flipMask	= _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+			const __m128 height		= _mm_set1_ps(screenHeight);
+			const __m128 one		= _mm_set1_ps(1.0f);
+			const __m128 zero		= _mm_setzero_ps();
+			const __m128 texScale	= _mm_setr_ps(texTransform.ScaleU, texTransform.ScaleV, texTransform.ScaleU, texTransform.ScaleV);
+			const __m128 texOffset	= _mm_setr_ps(texTransform.OffsetU, texTransform.OffsetV, texTransform.OffsetU, texTransform.OffsetV);
+
+			//a quad is 80 bytes, so an aligned base keeps every quad aligned
+			bool aligned = ((size_t)vertices & 0xF) == 0;
+			float32* dst = (float32*)vertices;
+
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				__m128 pos = _mm_setr_ps(sprite.PositionMin.X, sprite.PositionMin.Y, sprite.PositionMax.X, sprite.PositionMax.Y);
+				__m128 tex = _mm_setr_ps(sprite.TexCoordMin.X, sprite.TexCoordMin.Y, sprite.TexCoordMax.X, sprite.TexCoordMax.Y);
+				tex = _mm_add_ps(_mm_mul_ps(tex, texScale), texOffset);
+
+				pos = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(height, pos)), _mm_andnot_ps(flipMask, pos));
+				tex = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(one, tex)), _mm_andnot_ps(flipMask, tex));
+
+				__m128 quad[5];
+				BuildQuad(pos, tex, zero, quad);
+
+				if(aligned)
+				{
+					for(uint32 v = 0; v < 5; ++v)
+						_mm_stream_ps(dst + v*4, quad[v]);
+				}
+				else
+				{
+					for(uint32 v = 0; v < 5; ++v)
+						_mm_storeu_ps(dst + v*4, quad[v]);
+				}
+				dst += 20;
+			}
+
+			_mm_sfence();
+		}
+
+		CPUFEATURES_TARGET_AVX void CSpriteVertexKernel::FillAVX(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			//two sprites per iteration, one in each 128 bit lane
+			const __m256 flipMask	= _mm256_castsi256_ps(_mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1));
+			const __m256 height		= _mm256_set1_ps(screenHeight);
+			const __m256 one		= _mm256_set1_ps(1.0f);
+			const __m256 zero		= _mm256_setzero_ps();
+			const __m256 texScale	= _mm256_setr_ps(	texTransform.ScaleU, texTransform.ScaleV, texTransform.ScaleU, texTransform.ScaleV,
+														texTransform.ScaleU, texTransform.ScaleV, texTransform.ScaleU, texTransform.ScaleV);
+			const __m256 texOffset	= _mm256_setr_ps(	texTransform.OffsetU, texTransform.OffsetV, texTransform.OffsetU, texTransform.OffsetV,
+														texTransform.OffsetU, texTransform.OffsetV, texTransform.OffsetU, texTransform.OffsetV);
+
+			//a quad pair is 160 bytes, so an aligned base keeps every pair aligned
+			bool aligned = ((size_t)vertices & 0x1F) == 0;
+			float32* dst = (float32*)vertices;
+
+			uint32 pairCnt = count / 2;
+			for(uint32 i = 0; i < pairCnt; ++i)
+			{
+				const RenderJob_Sprite::Sprite& a = sprites[i*2+0];
+				const RenderJob_Sprite::Sprite& b = sprites[i*2+1];
+				__m256 pos = _mm256_setr_ps(a.PositionMin.X, a.PositionMin.Y, a.PositionMax.X, a.PositionMax.Y,
+											b.PositionMin.X, b.PositionMin.Y, b.PositionMax.X, b.PositionMax.Y);
+				__m256 tex = _mm256_setr_ps(a.TexCoordMin.X, a.TexCoordMin.Y, a.TexCoordMax.X, a.TexCoordMax.Y,
+											b.TexCoordMin.X, b.TexCoordMin.Y, b.TexCoordMax.X, b.TexCoordMax.Y);
+				tex = _mm256_add_ps(_mm256_mul_ps(tex, texScale), texOffset);
+
+				pos = _mm256_or_ps(_mm256_and_ps(flipMask, _mm256_sub_ps(height, pos)), _mm256_andnot_ps(flipMask, pos));
+				tex = _mm256_or_ps(_mm256_and_ps(flipMask, _mm256_sub_ps(one, tex)), _mm256_andnot_ps(flipMask, tex));
+
+				//same shuffles as BuildQuad, avx shuffles operate per 128 bit lane
+				__m256 o0 = _mm256_shuffle_ps(pos, _mm256_unpacklo_ps(zero, tex), _MM_SHUFFLE(1,0,1,0));
+				__m256 o1 = _mm256_shuffle_ps(_mm256_shuffle_ps(tex, pos, _MM_SHUFFLE(0,0,3,3)), _mm256_unpackhi_ps(pos, zero), _MM_SHUFFLE(1,2,2,0));
+				__m256 o2 = _mm256_shuffle_ps(tex, pos, _MM_SHUFFLE(3,2,1,0));
+				__m256 o3 = _mm256_shuffle_ps(_mm256_unpackhi_ps(zero, tex), _mm256_shuffle_ps(tex, pos, _MM_SHUFFLE(2,2,1,1)), _MM_SHUFFLE(2,0,1,0));
+				__m256 o4 = _mm256_shuffle_ps(_mm256_unpacklo_ps(_mm256_shuffle_ps(pos, pos, _MM_SHUFFLE(1,1,1,1)), zero), tex, _MM_SHUFFLE(3,2,1,0));
+
+				//regroup lanes into memory order: quad a (o0..o4 low) then quad b (o0..o4 high)
+				__m256 s0 = _mm256_permute2f128_ps(o0, o1, 0x20);
+				__m256 s1 = _mm256_permute2f128_ps(o2, o3, 0x20);
+				__m256 s2 = _mm256_permute2f128_ps(o4, o0, 0x30);
+				__m256 s3 = _mm256_permute2f128_ps(o1, o2, 0x31);
+				__m256 s4 = _mm256_permute2f128_ps(o3, o4, 0x31);
+
+				if(aligned)
+				{
+					_mm256_stream_ps(dst + 0, s0);
+					_mm256_stream_ps(dst + 8, s1);
+					_mm256_stream_ps(dst + 16, s2);
+					_mm256_stream_ps(dst + 24, s3);
+					_mm256_stream_ps(dst + 32, s4);
+				}
+				else
+				{
+					_mm256_storeu_ps(dst + 0, s0);
+					_mm256_storeu_ps(dst + 8, s1);
+					_mm256_storeu_ps(dst + 16, s2);
+					_mm256_storeu_ps(dst + 24, s3);
+					_mm256_storeu_ps(dst + 32, s4);
+				}
+				dst += 40;
+			}
+
+			//odd sprite left over
+			if(count & 1)
+				FillSSE2((Vertex_Sprite*)dst, &sprites[count-1], 1, screenHeight, texTransform);
+			else
+				_mm_sfence();
+
+			_mm256_zeroupper();
+		}
+
+		void CSpriteVertexKernel::FillCompactUNormScalar(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			FillCompactScalar(vertices, sprites, count, screenHeight, texTransform, false);
+		}
+
+		void CSpriteVertexKernel::FillCompactUNormSSE2(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			FillCompactSSE2(vertices, sprites, count, screenHeight, texTransform, false);
+		}
+
+		void CSpriteVertexKernel::FillCompactHalfScalar(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			FillCompactScalar(vertices, sprites, count, screenHeight, texTransform, true);
+		}
+
+		void CSpriteVertexKernel::FillCompactHalfSSE2(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			FillCompactSSE2(vertices, sprites, count, screenHeight, texTransform, true);
+		}
+
+		void CSpriteVertexKernel::FillInstancesScalar(Instance_Sprite* const instances, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				Instance_Sprite& instance = instances[i];
+
+				instance.Position[0]	= sprite.PositionMin.X;
+				instance.Position[1]	= screenHeight - sprite.PositionMin.Y;
+				instance.Position[2]	= sprite.PositionMax.X;
+				instance.Position[3]	= screenHeight - sprite.PositionMax.Y;
+
+				instance.TexCoord[0]	= sprite.TexCoordMin.X * texTransform.ScaleU + texTransform.OffsetU;
+				instance.TexCoord[1]	= 1.0f - (sprite.TexCoordMax.Y * texTransform.ScaleV + texTransform.OffsetV);
+				instance.TexCoord[2]	= sprite.TexCoordMax.X * texTransform.ScaleU + texTransform.OffsetU;
+				instance.TexCoord[3]	= 1.0f - (sprite.TexCoordMin.Y * texTransform.ScaleV + texTransform.OffsetV);
+			}
+		}
+
+		void CSpriteVertexKernel::FillInstancesSSE2(Instance_Sprite* const instances, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform)
+		{
+			const __m128 flipMask	= _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+			const __m128 height		= _mm_set1_ps(screenHeight);
+			const __m128 one		= _mm_set1_ps(1.0f);
+			const __m128 texScale	= _mm_setr_ps(texTransform.ScaleU, texTransform.ScaleV, texTransform.ScaleU, texTransform.ScaleV);
+			const __m128 texOffset	= _mm_setr_ps(texTransform.OffsetU, texTransform.OffsetV, texTransform.OffsetU, texTransform.OffsetV);
+
+			//records are 32 bytes, an aligned base keeps all of them aligned
+			bool aligned = ((size_t)instances & 0xF) == 0;
+			float32* dst = (float32*)instances;
+
+			for(uint32 i = 0; i < count; ++i)
+			{
+				const RenderJob_Sprite::Sprite& sprite = sprites[i];
+				__m128 pos = _mm_setr_ps(sprite.PositionMin.X, sprite.PositionMin.Y, sprite.PositionMax.X, sprite.PositionMax.Y);
+				__m128 tex = _mm_setr_ps(sprite.TexCoordMin.X, sprite.TexCoordMax.Y, sprite.TexCoordMax.X, sprite.TexCoordMin.Y);
+				tex = _mm_add_ps(_mm_mul_ps(tex, texScale), texOffset);
+
+				pos = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(height, pos)), _mm_andnot_ps(flipMask, pos));
+				tex = _mm_or_ps(_mm_and_ps(flipMask, _mm_sub_ps(one, tex)), _mm_andnot_ps(flipMask, tex));
+
+				if(aligned)
+				{
+					_mm_stream_ps(dst + 0, pos);
+					_mm_stream_ps(dst + 4, tex);
+				}
+				else
+				{
+					_mm_storeu_ps(dst + 0, pos);
+					_mm_storeu_ps(dst + 4, tex);
+				}
+				dst += 8;
+			}
+
+			_mm_sfence();
+		}
+
+		const SpriteTexTransform CSpriteVertexKernel::IdentityTexTransform = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+		const Vertex_SpriteCorner CSpriteVertexKernel::UnitQuadCorners[4] =
+		{
+			{0.0f, 0.0f},
+			{0.0f, 1.0f},
+			{1.0f, 1.0f},
+			{1.0f, 0.0f}
+		};
+
+		void CSpriteVertexKernel::ExpandInstance(const Instance_Sprite& instance, Vertex_Sprite* const vertices)
+		{
+			//min * (1 - c) + max * c picks min or max exactly for c in {0, 1}, unlike min + (max - min) * c
+			for(uint32 i = 0; i < 4; ++i)
+			{
+				float32 cx = UnitQuadCorners[i].CornerX;
+				float32 cy = UnitQuadCorners[i].CornerY;
+
+				vertices[i].Position	= CVector3(	instance.Position[0] * (1.0f - cx) + instance.Position[2] * cx,
+													instance.Position[1] * (1.0f - cy) + instance.Position[3] * cy,
+													0.0f);
+				vertices[i].Texture0_U	= instance.TexCoord[0] * (1.0f - cx) + instance.TexCoord[2] * cx;
+				vertices[i].Texture0_V	= instance.TexCoord[1] * (1.0f - cy) + instance.TexCoord[3] * cy;
+			}
+		}
+
+		uint16 CSpriteVertexKernel::FloatToHalf(const float32 value)
+		{
+			uint32 bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint32 sign = bits & 0x80000000;
+			bits ^= sign;
+
+			uint32 half;
+			if(bits >= ((127 + 16) << 23))
+			{
+				//too large for a half, or inf/nan already
+				half = bits > 0x7F800000 ? 0x7E00 : 0x7C00;
+			}
+			else if(bits < ((127 - 14) << 23))
+			{
+				//subnormal half, the fpu does the rounding
+				const uint32 magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+				float32 magic;
+				float32 absValue;
+				memcpy(&magic, &magicBits, sizeof(magic));
+				memcpy(&absValue, &bits, sizeof(absValue));
+				absValue += magic;
+				memcpy(&half, &absValue, sizeof(half));
+				half -= magicBits;
+			}
+			else
+			{
+				uint32 mantOdd = (bits >> 13) & 1;
+				bits += 0xFFF - ((127 - 15) << 23);
+				bits += mantOdd;
+				half = bits >> 13;
+			}
+
+			return (uint16)(half | (sign >> 16));
+		}
+
+		float32 CSpriteVertexKernel::HalfToFloat(const uint16 value)
+		{
+			uint32 sign = (uint32)(value & 0x8000) << 16;
+			uint32 exponent = (value >> 10) & 0x1F;
+			uint32 mantissa = value & 0x3FF;
+
+			float32 result;
+			if(exponent == 0x1F)
+			{
+				uint32 bits = sign | 0x7F800000 | (mantissa << 13);
+				memcpy(&result, &bits, sizeof(result));
+			}
+			else if(exponent == 0)
+			{
+				//subnormal, mantissa * 2^-24
+				result = (float32)mantissa * (1.0f / 16777216.0f);
+				if(sign != 0)
+					result = -result;
+			}
+			else
+			{
+				uint32 bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+				memcpy(&result, &bits, sizeof(result));
+			}
+			return result;
+		}
+
+		void CSpriteVertexKernel::ExpandCompactVertex(const Vertex_SpriteCompact& compact, const bool halfTexCoords, Vertex_Sprite& vertex)
+		{
+			vertex.Position = CVector3((float32)compact.PositionX, (float32)compact.PositionY, 0.0f);
+			if(halfTexCoords)
+			{
+				vertex.Texture0_U = HalfToFloat(compact.Texture0_U);
+				vertex.Texture0_V = HalfToFloat(compact.Texture0_V);
+			}
+			else
+			{
+				vertex.Texture0_U = compact.Texture0_U / 65535.0f;
+				vertex.Texture0_V = compact.Texture0_V / 65535.0f;
+			}
+		}
+
+		SpriteVertexKernel CSpriteVertexKernel::GetKernel(const CCpuFeatures::SimdLevel level)
+		{
+			switch(level)
+			{
+			case CCpuFeatures::SIMD_AVX:
+				return &CSpriteVertexKernel::FillAVX;
+			case CCpuFeatures::SIMD_SSE2:
+				return &CSpriteVertexKernel::FillSSE2;
+			default:
+				return &CSpriteVertexKernel::FillScalar;
+			}
+		}
+
+		SpriteInstanceKernel CSpriteVertexKernel::GetInstanceKernel(const CCpuFeatures::SimdLevel level)
+		{
+			//records are too small to gain anything from avx
+			if(level >= CCpuFeatures::SIMD_SSE2)
+				return &CSpriteVertexKernel::FillInstancesSSE2;
+
+			return &CSpriteVertexKernel::FillInstancesScalar;
+		}
+
+		SpriteCompactKernel CSpriteVertexKernel::GetCompactKernel(const CCpuFeatures::SimdLevel level, const bool halfTexCoords)
+		{
+			//quads are only 32 bytes, avx has nothing to add over sse2
+			if(level >= CCpuFeatures::SIMD_SSE2)
+				return halfTexCoords ? &CSpriteVertexKernel::FillCompactHalfSSE2 : &CSpriteVertexKernel::FillCompactUNormSSE2;
+
+			return halfTexCoords ? &CSpriteVertexKernel::FillCompactHalfScalar : &CSpriteVertexKernel::FillCompactUNormScalar;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+	Expands sprite rects into the four vertices of a screen
+	aligned quad. SSE2 and AVX variants write straight into
+	locked vertex memory and match the scalar path bit for bit.
+	Instanced rendering gets one compact record per sprite instead.
+	The compact vertex format quantizes positions to whole pixels
+	and texcoords to 16 bits, 8 bytes per vertex instead of 20.
+*/
+
+#ifndef _CSPRITEVERTEXKERNEL_H_
+#define _CSPRITEVERTEXKERNEL_H_
+
+#include "../../Core/Header/Void.h"
+#include "../../Math/Header/CVector3.h"
+#include "RendererTypes.h"
+#include "CCpuFeatures.h"
+
+using namespace Void::Math;
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//SPRITE_MODE_INSTANCED is headless only for now: lists built in it can be executed into sinks for tests,
+		//captures and benchmarks, but none of the shipped sprite effects has a vertex shader reading Instance_Sprite.
+		//Initialize with a device therefore always switches to SPRITE_MODE_VERTEX, check GetRenderMode afterwards.
+		//Builds whose effects expand instances like CSpriteVertexKernel::ExpandInstance may define
+		//VOID_SPRITE_INSTANCING to draw instanced on the device as well
+		enum SpriteRenderMode
+		{
+			SPRITE_MODE_VERTEX = 0x0,		//four Vertex_Sprite per sprite, indexed quads
+			SPRITE_MODE_INSTANCED		//one Instance_Sprite per sprite over a static unit quad
+		};
+
+		//vertex layout of sprite data in SPRITE_MODE_VERTEX, instanced mode always uses floats
+		enum SpriteVertexFormat
+		{
+			SPRITE_FORMAT_FLOAT = 0x0,		//Vertex_Sprite, 20 bytes
+			SPRITE_FORMAT_COMPACT_UNORM,	//Vertex_SpriteCompact with USHORT2N texcoords, 8 bytes
+			SPRITE_FORMAT_COMPACT_HALF		//Vertex_SpriteCompact with FLOAT16_2 texcoords, 8 bytes
+		};
+
+		struct Vertex_Sprite
+		{
+			CVector3	Position;
+			float32		Texture0_U;
+			float32		Texture0_V;
+		};
+
+		//positions rounded to whole pixels (SHORT2), texcoords as USHORT2N or FLOAT16_2
+		struct Vertex_SpriteCompact
+		{
+			int16		PositionX;
+			int16		PositionY;
+			uint16		Texture0_U;
+			uint16		Texture0_V;
+		};
+
+		//applied to sprite texcoords before the v flip, maps a texture into its atlas region
+		struct SpriteTexTransform
+		{
+			float32		ScaleU;
+			float32		ScaleV;
+			float32		OffsetU;
+			float32		OffsetV;
+		};
+
+		//corner of the static unit quad, (0,0) maps to PositionMin
+		struct Vertex_SpriteCorner
+		{
+			float32		CornerX;
+			float32		CornerY;
+		};
+
+		//per sprite instance data, rects are already flipped like the vertex path
+		//Position = [minX, H-minY, maxX, H-maxY], TexCoord = [minU, 1-maxV, maxU, 1-minV]
+		struct Instance_Sprite
+		{
+			float32		Position[4];
+			float32		TexCoord[4];
+		};
+
+		typedef void (*SpriteVertexKernel)(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+		typedef void (*SpriteCompactKernel)(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+		typedef void (*SpriteInstanceKernel)(Instance_Sprite* const instances, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+		class CSpriteVertexKernel
+		{
+		public:
+			static void FillScalar(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillSSE2(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillAVX(Vertex_Sprite* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+			//unorm texcoords are clamped to [0,1], half texcoords keep wrapping ranges but lose precision towards 1
+			static void FillCompactUNormScalar(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillCompactUNormSSE2(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillCompactHalfScalar(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillCompactHalfSSE2(Vertex_SpriteCompact* const vertices, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+			static void FillInstancesScalar(Instance_Sprite* const instances, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+			static void FillInstancesSSE2(Instance_Sprite* const instances, const RenderJob_Sprite::Sprite* const sprites, const uint32 count, const float32 screenHeight, const SpriteTexTransform& texTransform);
+
+			//leaves texcoords untouched (x * 1 + 0 == x)
+			static const SpriteTexTransform IdentityTexTransform;
+
+			//corners of the static quad in the order FillScalar emits its vertices
+			static const Vertex_SpriteCorner UnitQuadCorners[4];
+
+			//cpu reference of the instancing vertex shader, yields the same quad as FillScalar
+			static void ExpandInstance(const Instance_Sprite& instance, Vertex_Sprite* const vertices);
+
+			//round to nearest even, overflow goes to infinity
+			static uint16 FloatToHalf(const float32 value);
+			static float32 HalfToFloat(const uint16 value);
+
+			//cpu reference of what the compact vertex declaration hands to the shader
+			static void ExpandCompactVertex(const Vertex_SpriteCompact& compact, const bool halfTexCoords, Vertex_Sprite& vertex);
+
+			//levels come from CCpuFeatures::DetectLevel
+			static SpriteVertexKernel GetKernel(const CCpuFeatures::SimdLevel level);
+			static SpriteInstanceKernel GetInstanceKernel(const CCpuFeatures::SimdLevel level);
+			static SpriteCompactKernel GetCompactKernel(const CCpuFeatures::SimdLevel level, const bool halfTexCoords);
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "../Header/CSpriteWorkload.h"
+#include "../Header/CSpriteRenderer.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CSpriteWorkload::CSpriteWorkload()
+			:	m_CurtainJobCnt(0),
+				m_Random(1)
+		{
+			m_Params = GetDefaultParams();
+		}
+
+		CSpriteWorkload::~CSpriteWorkload()
+		{
+			this->Release();
+		}
+
+		void CSpriteWorkload::Release()
+		{
+			std::vector<RenderJob_Sprite>().swap(m_Jobs);
+			std::vector<RenderJob_Sprite::Sprite>().swap(m_Sprites);
+			std::vector<uint32>().swap(m_Order);
+			m_CurtainJobCnt = 0;
+		}
+
+		SpriteWorkloadParams CSpriteWorkload::GetDefaultParams()
+		{
+			SpriteWorkloadParams params;
+			params.JobCnt			= 1000;
+			params.SpritesPerJob	= 8;
+			params.TextureCnt		= 16;
+			params.EffectCnt		= 2;
+			params.AlphaCnt			= 1;
+			params.Sortedness		= 0.9f;
+			params.CurtainShare		= 0.25f;
+			params.ScreenWidth		= 1920.0f;
+			params.ScreenHeight		= 1080.0f;
+			params.SpriteSize		= 32.0f;
+			params.Seed				= 1;
+			return params;
+		}
+
+		uint32 CSpriteWorkload::NextRandom()
+		{
+			//xorshift32, the same seed gives the same workload everywhere
+			m_Random ^= m_Random << 13;
+			m_Random ^= m_Random >> 17;
+			m_Random ^= m_Random << 5;
+			return m_Random;
+		}
+
+		float32 CSpriteWorkload::NextUnit()
+		{
+			return (this->NextRandom() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		void CSpriteWorkload::Generate(const SpriteWorkloadParams& params)
+		{
+			m_Params = params;
+			m_Random = params.Seed != 0 ? params.Seed : 1;
+			uint32 textureCnt = params.TextureCnt > 0 ? params.TextureCnt : 1;
+			uint32 effectCnt = params.EffectCnt > 0 ? params.EffectCnt : 1;
+			uint32 alphaCnt = params.AlphaCnt > 0 ? params.AlphaCnt : 1;
+
+			m_Jobs.resize(params.JobCnt);
+			m_Sprites.resize(params.JobCnt * params.SpritesPerJob);
+			m_CurtainJobCnt = 0;
+
+			for(uint32 i = 0; i < params.JobCnt; ++i)
+			{
+				RenderJob_Sprite& job = m_Jobs[i];
+				job.SpritePtr	= params.SpritesPerJob > 0 ? &m_Sprites[i * params.SpritesPerJob] : NULL;
+				job.SpriteCnt	= params.SpritesPerJob;
+				job.IsCurtain	= this->NextUnit() < params.CurtainShare;
+				job.EffectId	= (EffectId)(EffectId_Default + this->NextRandom() % effectCnt);
+				job.TextureId	= (TextureId)(TextureId_Default + 1 + this->NextRandom() % textureCnt);
+				job.FinalAlpha	= 1.0f - (float32)(this->NextRandom() % alphaCnt) / alphaCnt;
+				job.RebuildSortingKey();
+				m_CurtainJobCnt += job.IsCurtain ? 1 : 0;
+
+				for(uint32 j = 0; j < params.SpritesPerJob; ++j)
+				{
+					RenderJob_Sprite::Sprite& sprite = job.SpritePtr[j];
+					float32 x = this->NextUnit() * (params.ScreenWidth - params.SpriteSize);
+					float32 y = this->NextUnit() * (params.ScreenHeight - params.SpriteSize);
+					sprite.PositionMin = CVector2(x, y);
+					sprite.PositionMax = CVector2(x + params.SpriteSize, y + params.SpriteSize);
+					sprite.TexCoordMin = CVector2(0.0f, 0.0f);
+					sprite.TexCoordMax = CVector2(1.0f, 1.0f);
+				}
+			}
+
+			//key order first, then displace a share of the jobs to random places
+			m_Order.resize(params.JobCnt);
+			for(uint32 i = 0; i < params.JobCnt; ++i)
+				m_Order[i] = i;
+
+			std::vector<RenderJob_Sprite>& jobs = m_Jobs;
+			std::stable_sort(m_Order.begin(), m_Order.end(), [&jobs](const uint32 a, const uint32 b) { return jobs[a].SortingKey < jobs[b].SortingKey; });
+
+			float32 sortedness = params.Sortedness < 0.0f ? 0.0f : (params.Sortedness > 1.0f ? 1.0f : params.Sortedness);
+			uint32 swapCnt = (uint32)((1.0f - sortedness) * params.JobCnt);
+			for(uint32 i = 0; i < swapCnt && params.JobCnt > 1; ++i)
+				std::swap(m_Order[this->NextRandom() % params.JobCnt], m_Order[this->NextRandom() % params.JobCnt]);
+		}
+
+		void CSpriteWorkload::Submit(CSpriteRenderer* const renderer)
+		{
+			for(uint32 i = 0; i < m_Order.size(); ++i)
+				renderer->AddRenderJob(&m_Jobs[m_Order[i]]);
+		}
+
+		void CSpriteWorkload::SubmitInPlace(CSpriteRenderer* const renderer)
+		{
+			for(uint32 i = 0; i < m_Order.size(); ++i)
+			{
+				const RenderJob_Sprite& source = m_Jobs[m_Order[i]];
+				RenderJob_Sprite* job = renderer->BeginSpriteJob(source.IsCurtain, source.SpriteCnt);
+				if(job == NULL)
+					continue;
+
+				job->EffectId	= source.EffectId;
+				job->TextureId	= source.TextureId;
+				job->FinalAlpha	= source.FinalAlpha;
+				memcpy(job->SpritePtr, source.SpritePtr, source.SpriteCnt * sizeof(RenderJob_Sprite::Sprite));
+				renderer->EndSpriteJob(job);
+			}
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+	Generates synthetic sprite job sets for benchmarking and
+	testing the sprite pipeline. Jobs, their sprites and the
+	submission order are built once and can be submitted to a
+	renderer every frame.
+*/
+
+#ifndef _CSPRITEWORKLOAD_H_
+#define _CSPRITEWORKLOAD_H_
+
+#include <vector>
+#include <algorithm>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		class CSpriteRenderer;
+
+		struct SpriteWorkloadParams
+		{
+			uint32		JobCnt;
+			uint32		SpritesPerJob;
+			uint32		TextureCnt;		//distinct TextureIds, starting after TextureId_Default
+			uint32		EffectCnt;		//distinct EffectIds, starting at EffectId_Default
+			uint32		AlphaCnt;		//distinct FinalAlpha values
+			float32		Sortedness;		//1 submits in key order, 0 in random order
+			float32		CurtainShare;	//fraction of jobs in the foreground
+			float32		ScreenWidth;
+			float32		ScreenHeight;
+			float32		SpriteSize;		//edge length in pixels
+			uint32		Seed;
+		};
+
+		class CSpriteWorkload
+		{
+		private:
+			SpriteWorkloadParams			m_Params;
+			std::vector<RenderJob_Sprite>		m_Jobs;
+			std::vector<RenderJob_Sprite::Sprite>	m_Sprites;
+
+			//indices into m_Jobs in submission order
+			std::vector<uint32>			m_Order;
+			uint32					m_CurtainJobCnt;
+			uint32					m_Random;
+
+		private:
+			uint32 NextRandom();
+			float32 NextUnit();
+
+		public:
+			CSpriteWorkload();
+			~CSpriteWorkload();
+
+			void Generate(const SpriteWorkloadParams& params);
+			void Release();
+
+			//AddRenderJob for every job in submission order
+			void Submit(CSpriteRenderer* const renderer);
+
+			//same jobs built in the renderer's frame memory instead
+			void SubmitInPlace(CSpriteRenderer* const renderer);
+
+			static SpriteWorkloadParams GetDefaultParams();
+
+			inline const SpriteWorkloadParams& GetParams() const	{ return m_Params; }
+			inline uint32 GetJobCount() const				{ return m_Jobs.size(); }
+			inline uint32 GetSpriteCount() const			{ return m_Sprites.size(); }
+			inline uint32 GetCurtainJobCount() const		{ return m_CurtainJobCnt; }
+
+			inline RenderJob_Sprite* GetJob(const uint32 index)
+			{
+				return &m_Jobs[m_Order[index]];
+			}
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,393 @@
+#include "../Header/CTextureAtlas.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CTextureAtlas::CTextureAtlas()
+			:	m_MaxEntrySize(0),
+				m_Frame(1),
+				m_PageEvictions(0),
+				m_LookupHits(0),
+				m_LookupMisses(0)
+		{
+		}
+
+		CTextureAtlas::~CTextureAtlas()
+		{
+			this->Release();
+		}
+
+		bool CTextureAtlas::Initialize(const uint32 maxEntrySize)
+		{
+			m_MaxEntrySize = maxEntrySize;
+			return true;
+		}
+
+		void CTextureAtlas::Release()
+		{
+			AtlasEntryMap::iterator iter = m_Entries.begin();
+			while(iter != m_Entries.end())
+			{
+				SAFE_RELEASE(iter->second.Source);
+				iter++;
+			}
+			m_Entries.clear();
+
+			for(uint32 i = 0; i < m_Pages.size(); ++i)
+				SAFE_RELEASE(m_Pages[i].Texture);
+			m_Pages.clear();
+
+			m_PageEvictions	= 0;
+			m_LookupHits	= 0;
+			m_LookupMisses	= 0;
+		}
+
+		bool CTextureAtlas::AddPage(const TextureId pageId, IDirect3DTexture9* const pageTexture)
+		{
+			D3DSURFACE_DESC desc;
+			HRESULT hr = pageTexture->GetLevelDesc(0, &desc);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetLevelDesc Failed. [CTextureAtlas::AddPage]");
+				return false;
+			}
+
+			AtlasPage page;
+			page.PageId			= pageId;
+			page.Texture		= pageTexture;
+			page.Width			= desc.Width;
+			page.Height			= desc.Height;
+			page.UsedArea		= 0;
+			page.LastUsedFrame	= 0;
+
+			SkylineNode node = { 0, 0, desc.Width };
+			page.Skyline.push_back(node);
+
+			pageTexture->AddRef();
+			m_Pages.push_back(page);
+			return true;
+		}
+
+		bool CTextureAtlas::Register(const TextureId id, IDirect3DTexture9* const source)
+		{
+			D3DSURFACE_DESC desc;
+			HRESULT hr = source->GetLevelDesc(0, &desc);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("GetLevelDesc Failed. [CTextureAtlas::Register]");
+				return false;
+			}
+
+			if(desc.Width > m_MaxEntrySize || desc.Height > m_MaxEntrySize)
+				return false;
+
+			this->Unregister(id);
+
+			AtlasEntry entry;
+			entry.Source		= source;
+			entry.Packed		= false;
+			entry.Page			= 0;
+			entry.X				= 0;
+			entry.Y				= 0;
+			entry.Width			= desc.Width;
+			entry.Height		= desc.Height;
+			entry.TexTransform	= CSpriteVertexKernel::IdentityTexTransform;
+
+			source->AddRef();
+			m_Entries.insert(std::pair<const TextureId, AtlasEntry>(id, entry));
+			return true;
+		}
+
+		void CTextureAtlas::Unregister(const TextureId id)
+		{
+			AtlasEntryMap::iterator iter = m_Entries.find(id);
+			if(iter == m_Entries.end())
+				return;
+
+			//its rect stays occupied until the page gets evicted
+			if(iter->second.Packed)
+			{
+				AtlasPage& page = m_Pages[iter->second.Page];
+				page.Entries.erase(std::find(page.Entries.begin(), page.Entries.end(), id));
+				page.UsedArea -= iter->second.Width * iter->second.Height;
+			}
+
+			SAFE_RELEASE(iter->second.Source);
+			m_Entries.erase(iter);
+		}
+
+		const AtlasEntry* CTextureAtlas::Lookup(const TextureId id)
+		{
+			AtlasEntryMap::iterator iter = m_Entries.find(id);
+			if(iter == m_Entries.end())
+				return NULL;
+
+			AtlasEntry& entry = iter->second;
+			if(!entry.Packed && !this->Pack(id, entry))
+			{
+				++m_LookupMisses;
+				return NULL;
+			}
+
+			m_Pages[entry.Page].LastUsedFrame = m_Frame;
+			++m_LookupHits;
+			return &entry;
+		}
+
+		bool CTextureAtlas::Pack(const TextureId id, AtlasEntry& entry)
+		{
+			uint32 width = entry.Width + 2 * ATLAS_PADDING;
+			uint32 height = entry.Height + 2 * ATLAS_PADDING;
+
+			uint32 page = 0;
+			uint32 node = 0;
+			uint32 x = 0;
+			uint32 y = 0;
+			bool found = false;
+			for(page = 0; page < m_Pages.size(); ++page)
+			{
+				if(this->FindPosition(m_Pages[page], width, height, node, x, y))
+				{
+					found = true;
+					break;
+				}
+			}
+
+			//all pages full, make room in the least recently used one not needed this frame
+			if(!found)
+			{
+				uint32 victim = m_Pages.size();
+				for(uint32 i = 0; i < m_Pages.size(); ++i)
+				{
+					if(m_Pages[i].LastUsedFrame == m_Frame)
+						continue;
+
+					if(victim == m_Pages.size() || m_Pages[i].LastUsedFrame < m_Pages[victim].LastUsedFrame)
+						victim = i;
+				}
+
+				if(victim == m_Pages.size())
+					return false;
+
+				this->ResetPage(victim);
+				page = victim;
+				found = this->FindPosition(m_Pages[page], width, height, node, x, y);
+				if(!found)
+					return false;
+			}
+
+			AtlasPage& atlasPage = m_Pages[page];
+			this->PlaceRect(atlasPage, node, x, y, width, height);
+
+			entry.Page	= page;
+			entry.X		= x + ATLAS_PADDING;
+			entry.Y		= y + ATLAS_PADDING;
+
+			//sprite v is flipped after the transform, so the offset is measured from the page bottom
+			entry.TexTransform.ScaleU	= (float32)entry.Width / atlasPage.Width;
+			entry.TexTransform.ScaleV	= (float32)entry.Height / atlasPage.Height;
+			entry.TexTransform.OffsetU	= (float32)entry.X / atlasPage.Width;
+			entry.TexTransform.OffsetV	= 1.0f - (float32)(entry.Y + entry.Height) / atlasPage.Height;
+
+			//space stays taken even if the copy fails, it is reclaimed with the page
+			if(!this->CopyTexels(atlasPage, entry))
+				return false;
+
+			entry.Packed = true;
+			atlasPage.Entries.push_back(id);
+			atlasPage.UsedArea += entry.Width * entry.Height;
+			return true;
+		}
+
+		bool CTextureAtlas::FindPosition(const AtlasPage& page, const uint32 width, const uint32 height, uint32& node, uint32& x, uint32& y) const
+		{
+			//bottom-left rule: lowest resulting top edge, narrowest node on ties
+			uint32 bestTop = 0xFFFFFFFF;
+			uint32 bestWidth = 0xFFFFFFFF;
+			bool found = false;
+
+			uint32 nodeCnt = page.Skyline.size();
+			for(uint32 i = 0; i < nodeCnt; ++i)
+			{
+				uint32 nodeX = page.Skyline[i].X;
+				if(nodeX + width > page.Width)
+					break;
+
+				//rect rests on the highest node it spans
+				uint32 top = 0;
+				uint32 widthLeft = width;
+				bool fits = true;
+				for(uint32 j = i; widthLeft > 0; ++j)
+				{
+					if(page.Skyline[j].Y > top)
+						top = page.Skyline[j].Y;
+
+					if(top + height > page.Height)
+					{
+						fits = false;
+						break;
+					}
+
+					widthLeft = page.Skyline[j].Width < widthLeft ? widthLeft - page.Skyline[j].Width : 0;
+				}
+
+				if(!fits)
+					continue;
+
+				if(top + height < bestTop || (top + height == bestTop && page.Skyline[i].Width < bestWidth))
+				{
+					bestTop		= top + height;
+					bestWidth	= page.Skyline[i].Width;
+					node		= i;
+					x			= nodeX;
+					y			= top;
+					found		= true;
+				}
+			}
+
+			return found;
+		}
+
+		void CTextureAtlas::PlaceRect(AtlasPage& page, const uint32 node, const uint32 x, const uint32 y, const uint32 width, const uint32 height)
+		{
+			std::vector<SkylineNode>& skyline = page.Skyline;
+
+			SkylineNode placed = { x, y + height, width };
+			skyline.insert(skyline.begin() + node, placed);
+
+			//cut the nodes now covered by the new one
+			for(uint32 i = node + 1; i < skyline.size(); )
+			{
+				uint32 prevEnd = skyline[i-1].X + skyline[i-1].Width;
+				if(skyline[i].X >= prevEnd)
+					break;
+
+				uint32 shrink = prevEnd - skyline[i].X;
+				if(skyline[i].Width <= shrink)
+				{
+					skyline.erase(skyline.begin() + i);
+					continue;
+				}
+
+				skyline[i].X += shrink;
+				skyline[i].Width -= shrink;
+				break;
+			}
+
+			//merge neighbours at the same height
+			for(uint32 i = 0; i + 1 < skyline.size(); )
+			{
+				if(skyline[i].Y == skyline[i+1].Y)
+				{
+					skyline[i].Width += skyline[i+1].Width;
+					skyline.erase(skyline.begin() + i + 1);
+					continue;
+				}
+				++i;
+			}
+		}
+
+		bool CTextureAtlas::CopyTexels(const AtlasPage& page, const AtlasEntry& entry)
+		{
+			D3DSURFACE_DESC srcDesc;
+			D3DSURFACE_DESC dstDesc;
+			if(FAILED(entry.Source->GetLevelDesc(0, &srcDesc)) || FAILED(page.Texture->GetLevelDesc(0, &dstDesc)))
+			{
+				DEBUG_MSG("GetLevelDesc Failed. [CTextureAtlas::CopyTexels]");
+				return false;
+			}
+
+			//plain row copies, the page has to share the texel layout
+			if(srcDesc.Format != dstDesc.Format || (srcDesc.Format != D3DFMT_A8R8G8B8 && srcDesc.Format != D3DFMT_X8R8G8B8))
+			{
+				DEBUG_MSG("Unsupported texture format. [CTextureAtlas::CopyTexels]");
+				return false;
+			}
+
+			D3DLOCKED_RECT src;
+			HRESULT hr = entry.Source->LockRect(0, &src, NULL, D3DLOCK_READONLY);
+			if(FAILED(hr))
+			{
+				DEBUG_MSG("LockRect Source Failed. [CTextureAtlas::CopyTexels]");
+				return false;
+			}
+
+			RECT region = { entry.X - ATLAS_PADDING, entry.Y - ATLAS_PADDING, entry.X + entry.Width + ATLAS_PADDING, entry.Y + entry.Height + ATLAS_PADDING };
+			D3DLOCKED_RECT dst;
+			hr = page.Texture->LockRect(0, &dst, &region, NULL);
+			if(FAILED(hr))
+			{
+				entry.Source->UnlockRect(0);
+				DEBUG_MSG("LockRect Page Failed. [CTextureAtlas::CopyTexels]");
+				return false;
+			}
+
+			//the gutter repeats the edge rows and columns, corners take the corner texel
+			uint32 rowSize = entry.Width * 4;
+			for(uint32 row = 0; row < entry.Height + 2 * ATLAS_PADDING; ++row)
+			{
+				uint32 srcRow = row < ATLAS_PADDING ? 0 : (row - ATLAS_PADDING < entry.Height ? row - ATLAS_PADDING : entry.Height - 1);
+				const uint32* srcTexels = (const uint32*)((uint8*)src.pBits + srcRow * src.Pitch);
+				uint32* dstTexels = (uint32*)((uint8*)dst.pBits + row * dst.Pitch);
+
+				for(uint32 i = 0; i < ATLAS_PADDING; ++i)
+				{
+					dstTexels[i] = srcTexels[0];
+					dstTexels[ATLAS_PADDING + entry.Width + i] = srcTexels[entry.Width - 1];
+				}
+				memcpy(dstTexels + ATLAS_PADDING, srcTexels, rowSize);
+			}
+
+			page.Texture->UnlockRect(0);
+			entry.Source->UnlockRect(0);
+			return true;
+		}
+
+		void CTextureAtlas::ResetPage(const uint32 page)
+		{
+			AtlasPage& atlasPage = m_Pages[page];
+			for(uint32 i = 0; i < atlasPage.Entries.size(); ++i)
+				m_Entries[atlasPage.Entries[i]].Packed = false;
+
+			atlasPage.Entries.clear();
+			atlasPage.Skyline.clear();
+			SkylineNode node = { 0, 0, atlasPage.Width };
+			atlasPage.Skyline.push_back(node);
+			atlasPage.UsedArea = 0;
+
+			++m_PageEvictions;
+		}
+
+		AtlasStats CTextureAtlas::GetStats() const
+		{
+			AtlasStats stats;
+			stats.PageCnt			= m_Pages.size();
+			stats.EntryCnt			= m_Entries.size();
+			stats.PackedEntryCnt	= 0;
+			stats.UsedArea			= 0;
+			stats.PageArea			= 0;
+			stats.PageEvictions		= m_PageEvictions;
+			stats.LookupHits		= m_LookupHits;
+			stats.LookupMisses		= m_LookupMisses;
+
+			for(uint32 i = 0; i < m_Pages.size(); ++i)
+			{
+				stats.PackedEntryCnt	+= m_Pages[i].Entries.size();
+				stats.UsedArea			+= m_Pages[i].UsedArea;
+				stats.PageArea			+= m_Pages[i].Width * m_Pages[i].Height;
+			}
+
+			return stats;
+		}
+
+		float32 CTextureAtlas::GetPackingEfficiency() const
+		{
+			AtlasStats stats = this->GetStats();
+			if(stats.PageArea == 0)
+				return 0.0f;
+
+			return (float32)stats.UsedArea / stats.PageArea;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+	Packs small sprite textures into shared atlas pages at
+	runtime (skyline bottom-left). Sprites of packed textures
+	batch on the page instead of their own texture.
+*/
+
+#ifndef _CTEXTUREATLAS_H_
+#define _CTEXTUREATLAS_H_
+
+#include <d3d9.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "../../Core/Header/Void.h"
+#include "RendererTypes.h"
+#include "CSpriteVertexKernel.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		//gutter around every packed texture, filled with its edge texels so linear filtering
+		//at the border samples the texture itself instead of a neighbour
+		#define ATLAS_PADDING		1
+
+		struct AtlasEntry
+		{
+			IDirect3DTexture9*	Source;
+			bool			Packed;
+			uint16			Page;
+			uint16			X;		//texture origin on the page, the gutter starts ATLAS_PADDING before
+			uint16			Y;
+			uint16			Width;
+			uint16			Height;
+			SpriteTexTransform	TexTransform;
+		};
+
+		struct AtlasStats
+		{
+			uint32			PageCnt;
+			uint32			EntryCnt;
+			uint32			PackedEntryCnt;
+			uint32			UsedArea;
+			uint32			PageArea;
+			uint32			PageEvictions;
+			uint32			LookupHits;
+			uint32			LookupMisses;
+		};
+
+		class CTextureAtlas
+		{
+		private:
+			struct SkylineNode
+			{
+				uint32			X;
+				uint32			Y;
+				uint32			Width;
+			};
+
+			struct AtlasPage
+			{
+				TextureId		PageId;
+				IDirect3DTexture9*	Texture;
+				uint32			Width;
+				uint32			Height;
+				std::vector<SkylineNode>	Skyline;
+				std::vector<TextureId>		Entries;
+				uint32			UsedArea;
+				uint32			LastUsedFrame;
+			};
+
+			typedef std::map<TextureId, AtlasEntry>		AtlasEntryMap;
+
+			AtlasEntryMap				m_Entries;
+			std::vector<AtlasPage>			m_Pages;
+			uint32					m_MaxEntrySize;
+			uint32					m_Frame;
+
+			uint32					m_PageEvictions;
+			uint32					m_LookupHits;
+			uint32					m_LookupMisses;
+
+		private:
+			bool Pack(const TextureId id, AtlasEntry& entry);
+			bool FindPosition(const AtlasPage& page, const uint32 width, const uint32 height, uint32& node, uint32& x, uint32& y) const;
+			void PlaceRect(AtlasPage& page, const uint32 node, const uint32 x, const uint32 y, const uint32 width, const uint32 height);
+			bool CopyTexels(const AtlasPage& page, const AtlasEntry& entry);
+			void ResetPage(const uint32 page);
+
+		public:
+			CTextureAtlas();
+			~CTextureAtlas();
+
+			bool Initialize(const uint32 maxEntrySize);
+			void Release();
+
+			//page texture must be lockable (managed), single level and of the same format as the sources
+			bool AddPage(const TextureId pageId, IDirect3DTexture9* const pageTexture);
+
+			//textures larger than maxEntrySize are refused and keep rendering on their own
+			bool Register(const TextureId id, IDirect3DTexture9* const source);
+			void Unregister(const TextureId id);
+
+			//packs on first use, repacks after eviction; NULL means draw with the texture itself
+			const AtlasEntry* Lookup(const TextureId id);
+
+			//pages touched during the current frame are never evicted
+			inline void NextFrame()
+			{
+				++m_Frame;
+			}
+
+			inline TextureId GetPageId(const uint16 page) const
+			{
+				return m_Pages[page].PageId;
+			}
+
+			AtlasStats GetStats() const;
+
+			//used area over the area of all pages, 0..1
+			float32 GetPackingEfficiency() const;
+		};
+	};
+};
+
+#endif
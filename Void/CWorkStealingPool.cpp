@@ -0,0 +1,156 @@
+#include "../Header/CWorkStealingPool.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		CWorkStealingPool::CWorkStealingPool()
+			:	m_Generation(0),
+				m_Quit(false),
+				m_PendingRanges(0)
+		{
+		}
+
+		CWorkStealingPool::~CWorkStealingPool()
+		{
+			this->Release();
+		}
+
+		bool CWorkStealingPool::Initialize(const uint32 numThreads)
+		{
+			this->Release();
+
+			//one queue per worker plus one for the calling thread
+			for(uint32 i = 0; i <= numThreads; ++i)
+				m_Queues.push_back(new TaskQueue());
+
+			m_Quit = false;
+			for(uint32 i = 0; i < numThreads; ++i)
+				m_Workers.push_back(std::thread(&CWorkStealingPool::WorkerMain, this, i));
+
+			return true;
+		}
+
+		void CWorkStealingPool::Release()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_WakeLock);
+				m_Quit = true;
+			}
+			m_WakeCondition.notify_all();
+
+			for(uint32 i = 0; i < m_Workers.size(); ++i)
+				m_Workers[i].join();
+			m_Workers.clear();
+
+			for(uint32 i = 0; i < m_Queues.size(); ++i)
+				SAFE_DELETE(m_Queues[i]);
+			m_Queues.clear();
+		}
+
+		void CWorkStealingPool::ParallelFor(const uint32 count, const uint32 grainSize, ParallelTask task, void* const context)
+		{
+			if(count == 0)
+				return;
+
+			uint32 grain = grainSize > 0 ? grainSize : 1;
+			uint32 queueCnt = m_Queues.size();
+
+			//no workers or a single range, nothing to distribute
+			if(queueCnt <= 1 || count <= grain)
+			{
+				task(context, 0, count);
+				return;
+			}
+
+			//deal ranges out round robin, neighbouring ranges end up on different threads
+			uint32 rangeCnt = (count + grain - 1) / grain;
+			m_PendingRanges = rangeCnt;
+			for(uint32 i = 0; i < rangeCnt; ++i)
+			{
+				TaskRange range;
+				range.Task		= task;
+				range.Context	= context;
+				range.Begin		= i * grain;
+				range.End		= (i + 1) * grain < count ? (i + 1) * grain : count;
+
+				TaskQueue* queue = m_Queues[i % queueCnt];
+				std::lock_guard<std::mutex> lock(queue->Lock);
+				queue->Ranges.push_back(range);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_WakeLock);
+				++m_Generation;
+			}
+			m_WakeCondition.notify_all();
+
+			//calling thread owns the last queue
+			this->RunRanges(queueCnt - 1);
+
+			//ranges still running on workers
+			while(m_PendingRanges.load() != 0)
+				std::this_thread::yield();
+		}
+
+		void CWorkStealingPool::WorkerMain(const uint32 queueIndex)
+		{
+			uint32 seenGeneration = 0;
+			while(true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_WakeLock);
+					while(!m_Quit && m_Generation == seenGeneration)
+						m_WakeCondition.wait(lock);
+
+					if(m_Quit)
+						return;
+
+					seenGeneration = m_Generation;
+				}
+
+				this->RunRanges(queueIndex);
+			}
+		}
+
+		void CWorkStealingPool::RunRanges(const uint32 queueIndex)
+		{
+			TaskRange range;
+			while(this->PopRange(queueIndex, range) || this->StealRange(queueIndex, range))
+			{
+				range.Task(range.Context, range.Begin, range.End);
+				m_PendingRanges.fetch_sub(1);
+			}
+		}
+
+		bool CWorkStealingPool::PopRange(const uint32 queueIndex, TaskRange& range)
+		{
+			TaskQueue* queue = m_Queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue->Lock);
+			if(queue->Ranges.empty())
+				return false;
+
+			range = queue->Ranges.back();
+			queue->Ranges.pop_back();
+			return true;
+		}
+
+		bool CWorkStealingPool::StealRange(const uint32 thiefIndex, TaskRange& range)
+		{
+			//thieves take from the front, away from the owner
+			uint32 queueCnt = m_Queues.size();
+			for(uint32 i = 1; i < queueCnt; ++i)
+			{
+				TaskQueue* queue = m_Queues[(thiefIndex + i) % queueCnt];
+				std::lock_guard<std::mutex> lock(queue->Lock);
+				if(queue->Ranges.empty())
+					continue;
+
+				range = queue->Ranges.front();
+				queue->Ranges.pop_front();
+				return true;
+			}
+			return false;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+	Small thread pool running parallel-for loops. Every
+	participant owns a range queue and steals from the others
+	once it runs dry. The calling thread takes part as well.
+*/
+
+#ifndef _CWORKSTEALINGPOOL_H_
+#define _CWORKSTEALINGPOOL_H_
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "../../Core/Header/Void.h"
+
+namespace Void
+{
+	namespace Renderer
+	{
+		typedef void (*ParallelTask)(void* const context, const uint32 begin, const uint32 end);
+
+		class CWorkStealingPool
+		{
+		private:
+			struct TaskRange
+			{
+				ParallelTask	Task;
+				void*		Context;
+				uint32		Begin;
+				uint32		End;
+			};
+
+			struct TaskQueue
+			{
+				std::mutex		Lock;
+				std::deque<TaskRange>	Ranges;
+			};
+
+			std::vector<std::thread>		m_Workers;
+			std::vector<TaskQueue*>			m_Queues;
+
+			std::mutex				m_WakeLock;
+			std::condition_variable			m_WakeCondition;
+			uint32					m_Generation;
+			bool					m_Quit;
+
+			std::atomic<uint32>			m_PendingRanges;
+
+		private:
+			void WorkerMain(const uint32 queueIndex);
+			void RunRanges(const uint32 queueIndex);
+			bool PopRange(const uint32 queueIndex, TaskRange& range);
+			bool StealRange(const uint32 thiefIndex, TaskRange& range);
+
+		public:
+			CWorkStealingPool();
+			~CWorkStealingPool();
+
+			bool Initialize(const uint32 numThreads);
+			void Release();
+
+			//splits [0, count) into grainSize ranges and blocks until all of them ran
+			void ParallelFor(const uint32 count, const uint32 grainSize, ParallelTask task, void* const context);
+
+			inline uint32 GetThreadCount() const
+			{
+				return m_Workers.size();
+			}
+		};
+	};
+};
+
+#endif
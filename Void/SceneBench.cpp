@@ -0,0 +1,292 @@
+#include "../Header/CEntity3D.h"
+#include "../Header/CEntityFrustumCuller.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+using namespace Void::Scene;
+
+//headless scene benchmarks, prints one line per run, fails if a culling kernel differs from the reference
+//usage: SceneBench [iterations]
+
+#define BENCH_PASSES		4
+
+//results end up here so the compiler can not drop the work
+static volatile uint64 s_Sink = 0;
+
+//stands in for a loaded CEffect, every setter only touches the value
+struct BenchEffect
+{
+	uint64		Sink;
+
+	BenchEffect() : Sink(0) {}
+
+	inline void Touch(const char* const name, const void* const value)	{ Sink += (size_t)name ^ *((const uint8*)value); }
+
+	void SetBool(const char* const name, const bool value)								{ this->Touch(name, &value); }
+	void SetInt(const char* const name, const int32 value)								{ this->Touch(name, &value); }
+	void SetFloat(const char* const name, const float32 value)							{ this->Touch(name, &value); }
+	void SetVector(const char* const name, CVector3* const value)						{ this->Touch(name, value); }
+	void SetVector(const char* const name, CVector4* const value)						{ this->Touch(name, value); }
+	void SetVectorArray(const char* const name, CVector4* const value, const uint32 count)		{ this->Touch(name, value); }
+	void SetMatrix(const char* const name, CMatrix4x4* const value)					{ this->Touch(name, value); }
+	void SetMatrixArray(const char* const name, CMatrix4x4* const value, const uint32 count)	{ this->Touch(name, value); }
+};
+
+//the smallest entity there is, only its shader constants are used
+class BenchEntity : public CEntity3D
+{
+public:
+	explicit BenchEntity(const CHashedString& id) : CEntity3D(id) {}
+
+	void PreRender(CRenderer* const renderer)					{}
+	void LoadResources(CResourceManager* const resManager)		{}
+	void UnloadResources(CResourceManager* const resManager)	{}
+	void Rebuild()												{}
+	Entity3DType GetEntityType() const							{ return ENTITY3D_MODEL; }
+};
+
+//how CEntity3D kept its constants before CEntityConstantStore, a map walked for every pass
+typedef std::map<const CHashedString, ShaderConstant*>	BenchConstantMap;
+
+static void BindMap(BenchConstantMap& constants, BenchEffect* const effect, const uint16 pass)
+{
+	for(BenchConstantMap::iterator iter = constants.begin(); iter != constants.end(); ++iter)
+	{
+		ShaderConstant* constant = iter->second;
+		if(constant->Pass != pass)
+			continue;
+
+		const char* name = constant->Identifier.GetString().c_str();
+		switch(constant->Type)
+		{
+		case ShaderConstant::CONSTANT_TYPE_FLOAT:			effect->SetFloat(name, *((float32*)constant->Value));						break;
+		case ShaderConstant::CONSTANT_TYPE_VECTOR4:			effect->SetVector(name, (CVector4*)constant->Value);						break;
+		case ShaderConstant::CONSTANT_TYPE_MATRIX4X4:		effect->SetMatrix(name, (CMatrix4x4*)constant->Value);						break;
+		case ShaderConstant::CONSTANT_TYPE_MATRIX4X4_ARRAY:	effect->SetMatrixArray(name, (CMatrix4x4*)constant->Value, constant->ArraySize);	break;
+		default:																										break;
+		}
+	}
+}
+
+//float, vector4, matrix and matrix array constants spread over the passes, values stay alive in values
+static void MakeConstants(const uint32 count, std::vector<ShaderConstant>& constants, std::vector<float32>& values)
+{
+	static const ShaderConstant::ConstantType s_Types[] =
+	{
+		ShaderConstant::CONSTANT_TYPE_FLOAT,
+		ShaderConstant::CONSTANT_TYPE_VECTOR4,
+		ShaderConstant::CONSTANT_TYPE_MATRIX4X4,
+		ShaderConstant::CONSTANT_TYPE_MATRIX4X4_ARRAY
+	};
+
+	values.assign(count * 4 * 16, 1.0f);
+	constants.resize(count);
+	for(uint32 i = 0; i < count; ++i)
+	{
+		char name[32];
+		sprintf(name, "constant%u", i);
+
+		ShaderConstant& constant = constants[i];
+		constant.Identifier	= CHashedString(name);
+		constant.Type		= s_Types[i % 4];
+		constant.Pass		= i % BENCH_PASSES;
+		constant.ArraySize	= 4;
+		constant.Value		= &values[i * 4 * 16];
+	}
+}
+
+//nanoseconds per entity bind of all passes, the effect is not registered so every value is sent
+//the entity goes through SetShaderConstants as a model would, every other constant is handed over by pointer
+static void BenchConstants(const uint32 count, const uint32 iterations)
+{
+	std::vector<ShaderConstant> constants;
+	std::vector<float32> values;
+	MakeConstants(count, constants, values);
+
+	BenchConstantMap map;
+	BenchEntity* entity = new BenchEntity(CHashedString("bench"));
+	for(uint32 i = 0; i < count; ++i)
+	{
+		map.insert(std::pair<const CHashedString, ShaderConstant*>(constants[i].Identifier, &constants[i]));
+		if(i % 2 == 0)
+		{
+			entity->SetShaderConstant(constants[i]);
+			continue;
+		}
+
+		//the entity gives it back to the pool, its value stays in values
+		ShaderConstant* owned = ShaderConstantPool->New();
+		*owned = constants[i];
+		entity->SetShaderConstant(owned);
+	}
+
+	BenchEffect effect;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(uint32 i = 0; i < iterations; ++i)
+	{
+		for(uint16 pass = 0; pass < BENCH_PASSES; ++pass)
+			BindMap(map, &effect, pass);
+	}
+	std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+	for(uint32 i = 0; i < iterations; ++i)
+	{
+		for(uint16 pass = 0; pass < BENCH_PASSES; ++pass)
+			entity->BindShaderConstants(&effect, NULL, pass);
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	float64 mapTime = std::chrono::duration<float64, std::nano>(middle - start).count() / iterations;
+	float64 entityTime = std::chrono::duration<float64, std::nano>(end - middle).count() / iterations;
+	printf("constants %u: map %.0f ns, entity %.0f ns\n", count, mapTime, entityTime);
+	s_Sink = s_Sink + effect.Sink;
+	delete entity;
+}
+
+#define BENCH_BOXES			100000
+
+struct BenchBox
+{
+	float32		Min[3];
+	float32		Max[3];
+	CEntity3D*	Owner;
+};
+
+static float32 RandomRange(const float32 min, const float32 max)
+{
+	return min + (max - min) * ((float32)rand() / (float32)RAND_MAX);
+}
+
+//one box at a time with an early out, how a culler over scattered entities would look
+static uint32 CullReference(const FrustumPlanes& frustum, const std::vector<BenchBox>& boxes, CEntity3D** const visible)
+{
+	uint32 visibleCnt = 0;
+	for(uint32 i = 0; i < boxes.size(); ++i)
+	{
+		const BenchBox& box = boxes[i];
+		bool inside = true;
+		for(uint32 plane = 0; plane < 6 && inside; ++plane)
+		{
+			const float32* p = frustum.Planes[plane];
+			float32 x = p[0] >= 0.0f ? box.Max[0] : box.Min[0];
+			float32 y = p[1] >= 0.0f ? box.Max[1] : box.Min[1];
+			float32 z = p[2] >= 0.0f ? box.Max[2] : box.Min[2];
+			inside = (p[0] * x + p[1] * y) + (p[2] * z + p[3]) >= 0.0f;
+		}
+
+		if(inside)
+			visible[visibleCnt++] = box.Owner;
+	}
+	return visibleCnt;
+}
+
+//milliseconds per cull of 100k random boxes with every tenth freed, each kernel has to match the reference
+static bool BenchFrustumCull(const uint32 iterations)
+{
+	//owners are only compared, any distinct addresses do
+	std::vector<uint8> owners(BENCH_BOXES);
+	std::vector<EntityHandle> handles(BENCH_BOXES);
+	CEntity3DStore store;
+
+	srand(100000);
+	for(uint32 i = 0; i < BENCH_BOXES; ++i)
+	{
+		handles[i] = store.Allocate((CEntity3D*)&owners[i]);
+		float32 extent = RandomRange(0.5f, 10.0f);
+		store.SetLocalBounds(handles[i], CVector3(-extent, -extent, -extent), CVector3(extent, extent, extent));
+
+		float32* m = (float32*)&store.GetWorldMatrix(handles[i]);
+		m[12] = RandomRange(-1000.0f, 1000.0f);
+		m[13] = RandomRange(-1000.0f, 1000.0f);
+		m[14] = RandomRange(-1000.0f, 1000.0f);
+	}
+	for(uint32 i = 0; i < BENCH_BOXES; i += 10)
+		store.Free(handles[i]);
+	store.RecomputeAllWorldBounds();
+
+	std::vector<BenchBox> boxes;
+	for(uint32 c = 0; c < store.GetChunkCount(); ++c)
+	{
+		const EntityChunk* chunk = store.GetChunkByIndex(c);
+		for(uint32 slot = 0; slot < ENTITYSTORE_CHUNK_SIZE; ++slot)
+		{
+			if(chunk->Owners[slot] == NULL)
+				continue;
+
+			BenchBox box;
+			for(uint32 axis = 0; axis < 3; ++axis)
+			{
+				box.Min[axis] = chunk->WorldMin[axis][slot];
+				box.Max[axis] = chunk->WorldMax[axis][slot];
+			}
+			box.Owner = chunk->Owners[slot];
+			boxes.push_back(box);
+		}
+	}
+
+	//fov 90 down +z from the origin, near 1, far 800
+	float32 zn = 1.0f;
+	float32 zf = 800.0f;
+	CMatrix4x4 viewProjection;
+	float32* vp = (float32*)&viewProjection;
+	memset(vp, 0, sizeof(CMatrix4x4));
+	vp[0]	= 1.0f;
+	vp[5]	= 1.0f;
+	vp[10]	= zf / (zf - zn);
+	vp[11]	= 1.0f;
+	vp[14]	= -zn * zf / (zf - zn);
+
+	FrustumPlanes frustum;
+	CEntityFrustumCuller::ExtractPlanes(viewProjection, frustum);
+	CEntityFrustumCuller culler;
+	culler.SetFrustum(frustum);
+
+	std::vector<CEntity3D*> expected(boxes.size());
+	uint32 expectedCnt = CullReference(frustum, boxes, &expected[0]);
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for(uint32 i = 0; i < iterations; ++i)
+		CullReference(frustum, boxes, &expected[0]);
+	float64 referenceTime = std::chrono::duration<float64, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+	printf("frustum %u of %u boxes visible: reference %.3f ms", expectedCnt, (uint32)boxes.size(), referenceTime);
+
+	static const CCpuFeatures::SimdLevel s_Levels[] = { CCpuFeatures::SIMD_SCALAR, CCpuFeatures::SIMD_SSE2, CCpuFeatures::SIMD_AVX };
+	static const char* s_LevelNames[] = { "scalar", "sse2", "avx" };
+
+	bool matched = true;
+	CCpuFeatures::SimdLevel supported = CCpuFeatures::DetectLevel();
+	for(uint32 level = 0; level < sizeof(s_Levels) / sizeof(s_Levels[0]) && s_Levels[level] <= supported; ++level)
+	{
+		culler.SetLevel(s_Levels[level]);
+		uint32 visibleCnt = culler.Cull(&store);
+		if(visibleCnt != expectedCnt || memcmp(culler.GetVisible(), &expected[0], visibleCnt * sizeof(CEntity3D*)) != 0)
+		{
+			printf(", %s differs from the reference", s_LevelNames[level]);
+			matched = false;
+			continue;
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		for(uint32 i = 0; i < iterations; ++i)
+			culler.Cull(&store);
+		float64 time = std::chrono::duration<float64, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+		printf(", %s %.3f ms", s_LevelNames[level], time);
+	}
+	printf("\n");
+	return matched;
+}
+
+int main(int argc, char** argv)
+{
+	uint32 iterations = argc > 1 ? (uint32)atoi(argv[1]) : 100000;
+	if(iterations == 0)
+		iterations = 1;
+
+	static const uint32 s_ConstantCounts[] = { 10, 30, 50 };
+	for(uint32 i = 0; i < sizeof(s_ConstantCounts) / sizeof(uint32); ++i)
+		BenchConstants(s_ConstantCounts[i], iterations);
+
+	//a cull takes a thousand times longer than a bind
+	bool succeeded = BenchFrustumCull(iterations / 1000 > 0 ? iterations / 1000 : 1);
+	return succeeded ? 0 : 1;
+}
\ No newline at end of file
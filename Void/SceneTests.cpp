@@ -0,0 +1,443 @@
+#include "../Header/CEntity3D.h"
+#include "../Header/CEntityBVH.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+using namespace Void::Scene;
+
+//headless checks of the scene entities, returns the number of failed tests
+//usage: SceneTests
+
+#define TEST_CHECK(condition) \
+	if(!(condition)) \
+	{ \
+		printf("  failed: %s (line %d)\n", #condition, __LINE__); \
+		return false; \
+	}
+
+//the smallest entity there is, only what CEntity3D does itself is tested
+class TestEntity : public CEntity3D
+{
+public:
+	explicit TestEntity(const CHashedString& id) : CEntity3D(id) {}
+
+	void PreRender(CRenderer* const renderer)					{}
+	void LoadResources(CResourceManager* const resManager)		{}
+	void UnloadResources(CResourceManager* const resManager)	{}
+	void Rebuild()												{}
+	Entity3DType GetEntityType() const							{ return ENTITY3D_MODEL; }
+};
+
+//stands in for a loaded CEffect, counts the values it was sent
+struct TestEffect
+{
+	uint32		SetCnt;
+
+	TestEffect() : SetCnt(0) {}
+
+	void SetBool(const char* const name, const bool value)								{ ++SetCnt; }
+	void SetInt(const char* const name, const int32 value)								{ ++SetCnt; }
+	void SetFloat(const char* const name, const float32 value)							{ ++SetCnt; }
+	void SetVector(const char* const name, CVector3* const value)						{ ++SetCnt; }
+	void SetVector(const char* const name, CVector4* const value)						{ ++SetCnt; }
+	void SetVectorArray(const char* const name, CVector4* const value, const uint32 count)		{ ++SetCnt; }
+	void SetMatrix(const char* const name, CMatrix4x4* const value)					{ ++SetCnt; }
+	void SetMatrixArray(const char* const name, CMatrix4x4* const value, const uint32 count)	{ ++SetCnt; }
+};
+
+static ShaderConstant MakeConstant(const char* const name, const ShaderConstant::ConstantType type, void* const value)
+{
+	ShaderConstant constant;
+	constant.Identifier	= CHashedString(name);
+	constant.Type		= type;
+	constant.Pass		= 0;
+	constant.Value		= value;
+	constant.ArraySize	= 1;
+	return constant;
+}
+
+//binds entity to effect and checks what EffectParameterCache counted and what the effect received
+static bool CheckUploads(TestEntity* const entity, TestEffect& effect, const uint32 sentCnt, const uint32 skippedCnt)
+{
+	EffectParameterCache->ResetUploadCounts();
+	effect.SetCnt = 0;
+	entity->BindShaderConstants(&effect, (const CEffect*)&effect, 0);
+	return	EffectParameterCache->GetSentCount() == sentCnt && EffectParameterCache->GetSkippedCount() == skippedCnt &&
+			effect.SetCnt == sentCnt;
+}
+
+//untracked parameters are always sent, tracked ones only while the effect holds another value
+static bool CheckUploadSequence(TestEntity* const a, TestEntity* const b, TestEffect& effect, float32& tintA)
+{
+	TEST_CHECK(CheckUploads(a, effect, 3, 0));
+
+	//unchanged re-bind
+	TEST_CHECK(CheckUploads(a, effect, 1, 2));
+
+	//equal values of another entity still carry their own version
+	TEST_CHECK(CheckUploads(b, effect, 2, 0));
+	TEST_CHECK(CheckUploads(a, effect, 3, 0));
+
+	//writing the same value keeps the version, a new value only resends that constant
+	ShaderConstantHandle tint = a->GetShaderConstantHandle(CHashedString("tint"));
+	TEST_CHECK(a->UpdateShaderConstant(tint, &tintA));
+	TEST_CHECK(CheckUploads(a, effect, 1, 2));
+
+	tintA = 0.25f;
+	TEST_CHECK(a->UpdateShaderConstant(tint, &tintA));
+	TEST_CHECK(CheckUploads(a, effect, 2, 1));
+	return true;
+}
+
+static bool TestConstantUploads()
+{
+	//the stand-in registers like a loaded effect, "unknown" is a constant it has no parameter for
+	TestEffect effect;
+	static const char* const s_Parameters[] = { "tint", "matWorld" };
+	EffectParameterCache->RegisterEffect((const CEffect*)&effect, s_Parameters, 2);
+
+	float32 tintA = 1.0f;
+	float32 tintB = 0.5f;
+	float32 unknown = 0.0f;
+	CMatrix4x4 world;
+	world.Identity();
+
+	TestEntity* a = new TestEntity(CHashedString("a"));
+	TestEntity* b = new TestEntity(CHashedString("b"));
+	a->SetShaderConstant(MakeConstant("tint", ShaderConstant::CONSTANT_TYPE_FLOAT, &tintA));
+	a->SetShaderConstant(MakeConstant("matWorld", ShaderConstant::CONSTANT_TYPE_MATRIX4X4, &world));
+	a->SetShaderConstant(MakeConstant("unknown", ShaderConstant::CONSTANT_TYPE_FLOAT, &unknown));
+	b->SetShaderConstant(MakeConstant("tint", ShaderConstant::CONSTANT_TYPE_FLOAT, &tintB));
+	b->SetShaderConstant(MakeConstant("matWorld", ShaderConstant::CONSTANT_TYPE_MATRIX4X4, &world));
+
+	bool passed = CheckUploadSequence(a, b, effect, tintA);
+
+	delete a;
+	delete b;
+	EffectParameterCache->UnregisterEffect((const CEffect*)&effect);
+	EffectParameterCache->ResetUploadCounts();
+	return passed;
+}
+
+#define BVH_SLOTS		256
+#define BVH_STEPS		4000
+#define BVH_MARGIN		0.5f
+
+//what the tree should hold for one slot, the fat box follows the rules of CEntityBVH::Move
+struct BVHShadow
+{
+	EntityHandle	Handle;
+	uint32			Generation;
+	bool			Inserted;
+	CVector3		FatMin;
+	CVector3		FatMax;
+};
+
+static float32 RandomRange(const float32 min, const float32 max)
+{
+	return min + (max - min) * ((float32)rand() / (float32)RAND_MAX);
+}
+
+static void RandomBox(CVector3& min, CVector3& max, const float32 range)
+{
+	float32 extent = RandomRange(0.1f, 4.0f);
+	float32 x = RandomRange(-range, range);
+	float32 y = RandomRange(-range, range);
+	float32 z = RandomRange(-range, range);
+	min = CVector3(x - extent, y - extent, z - extent);
+	max = CVector3(x + extent, y + extent, z + extent);
+}
+
+static void FattenBox(BVHShadow& shadow, const CVector3& min, const CVector3& max)
+{
+	shadow.FatMin = CVector3(min.X - BVH_MARGIN, min.Y - BVH_MARGIN, min.Z - BVH_MARGIN);
+	shadow.FatMax = CVector3(max.X + BVH_MARGIN, max.Y + BVH_MARGIN, max.Z + BVH_MARGIN);
+}
+
+static bool ContainsBox(const BVHShadow& shadow, const CVector3& min, const CVector3& max)
+{
+	return	shadow.FatMin.X <= min.X && shadow.FatMin.Y <= min.Y && shadow.FatMin.Z <= min.Z &&
+			shadow.FatMax.X >= max.X && shadow.FatMax.Y >= max.Y && shadow.FatMax.Z >= max.Z;
+}
+
+//the query has to return exactly the inserted leaves a brute force search finds
+static bool CheckQueryAABB(const CEntityBVH& bvh, const std::vector<BVHShadow>& shadows, const CVector3& min, const CVector3& max)
+{
+	std::vector<EntityHandle> found;
+	bvh.QueryAABB(min, max, found);
+
+	std::vector<EntityHandle> expected;
+	for(uint32 i = 0; i < shadows.size(); ++i)
+	{
+		const BVHShadow& shadow = shadows[i];
+		if(	!shadow.Inserted ||
+			shadow.FatMax.X < min.X || shadow.FatMin.X > max.X ||
+			shadow.FatMax.Y < min.Y || shadow.FatMin.Y > max.Y ||
+			shadow.FatMax.Z < min.Z || shadow.FatMin.Z > max.Z)
+			continue;
+
+		expected.push_back(shadow.Handle);
+	}
+
+	std::sort(found.begin(), found.end());
+	std::sort(expected.begin(), expected.end());
+	return found == expected;
+}
+
+static bool CheckTree(const CEntityBVH& bvh, const std::vector<BVHShadow>& shadows)
+{
+	uint32 insertedCnt = 0;
+	for(uint32 i = 0; i < shadows.size(); ++i)
+		insertedCnt += shadows[i].Inserted ? 1 : 0;
+
+	TEST_CHECK(bvh.Validate());
+	TEST_CHECK(bvh.GetLeafCount() == insertedCnt);
+
+	CVector3 min, max;
+	RandomBox(min, max, 100.0f);
+	min = CVector3(min.X - 20.0f, min.Y - 20.0f, min.Z - 20.0f);
+	max = CVector3(max.X + 20.0f, max.Y + 20.0f, max.Z + 20.0f);
+	TEST_CHECK(CheckQueryAABB(bvh, shadows, min, max));
+	return true;
+}
+
+//one random operation on slot, mirrored in its shadow
+static bool StepBVH(CEntityBVH& bvh, BVHShadow& shadow, const uint32 slot)
+{
+	CVector3 min, max;
+	switch(rand() % 8)
+	{
+	case 0:
+	case 1:
+		RandomBox(min, max, 100.0f);
+		TEST_CHECK(bvh.Insert(shadow.Handle, min, max) == !shadow.Inserted);
+		if(!shadow.Inserted)
+			FattenBox(shadow, min, max);
+		shadow.Inserted = true;
+		break;
+
+	case 2:
+		TEST_CHECK(bvh.Remove(shadow.Handle) == shadow.Inserted);
+		shadow.Inserted = false;
+		break;
+
+	case 3:
+	case 4:
+	case 5:
+	{
+		//mostly small steps inside the margin, now and then a jump
+		if(!shadow.Inserted)
+			break;
+
+		float32 step = rand() % 4 == 0 ? 20.0f : 0.4f;
+		float32 dx = RandomRange(-step, step);
+		float32 dy = RandomRange(-step, step);
+		float32 dz = RandomRange(-step, step);
+		float32 extent = RandomRange(0.1f, 0.2f);
+		float32 x = (shadow.FatMin.X + shadow.FatMax.X) * 0.5f + dx;
+		float32 y = (shadow.FatMin.Y + shadow.FatMax.Y) * 0.5f + dy;
+		float32 z = (shadow.FatMin.Z + shadow.FatMax.Z) * 0.5f + dz;
+		min = CVector3(x - extent, y - extent, z - extent);
+		max = CVector3(x + extent, y + extent, z + extent);
+
+		bool refit = !ContainsBox(shadow, min, max);
+		TEST_CHECK(bvh.Move(shadow.Handle, min, max) == refit);
+		if(refit)
+			FattenBox(shadow, min, max);
+		break;
+	}
+
+	case 6:
+	{
+		//the entity died without Remove and the slot was handed out again
+		EntityHandle stale = shadow.Handle;
+		shadow.Generation = (shadow.Generation + 1) & 0xFF;
+		shadow.Handle = (slot + 1) | (shadow.Generation << ENTITYHANDLE_INDEX_BITS);
+
+		RandomBox(min, max, 100.0f);
+		TEST_CHECK(bvh.Insert(shadow.Handle, min, max));
+		TEST_CHECK(!bvh.Remove(stale));
+		TEST_CHECK(!bvh.Move(stale, min, max));
+		FattenBox(shadow, min, max);
+		shadow.Inserted = true;
+		break;
+	}
+
+	default:
+		bvh.Rebalance(rand() % 8);
+		break;
+	}
+	return true;
+}
+
+static bool TestBVH()
+{
+	srand(256);
+
+	CEntityBVH bvh;
+	bvh.SetMargin(BVH_MARGIN);
+
+	std::vector<BVHShadow> shadows(BVH_SLOTS);
+	for(uint32 i = 0; i < BVH_SLOTS; ++i)
+	{
+		shadows[i].Generation	= 1;
+		shadows[i].Handle		= (i + 1) | (1 << ENTITYHANDLE_INDEX_BITS);
+		shadows[i].Inserted		= false;
+	}
+
+	for(uint32 step = 0; step < BVH_STEPS; ++step)
+	{
+		uint32 slot = rand() % BVH_SLOTS;
+		TEST_CHECK(StepBVH(bvh, shadows[slot], slot));
+
+		if(step % 64 == 0)
+			TEST_CHECK(CheckTree(bvh, shadows));
+	}
+
+	//reinserting every dirty leaf leaves the contents alone
+	TEST_CHECK(CheckTree(bvh, shadows));
+	bvh.Rebalance(BVH_SLOTS);
+	TEST_CHECK(bvh.GetDirtyCount() == 0);
+	TEST_CHECK(CheckTree(bvh, shadows));
+
+	CVector3 everything(1.0e6f, 1.0e6f, 1.0e6f);
+	TEST_CHECK(CheckQueryAABB(bvh, shadows, CVector3(-1.0e6f, -1.0e6f, -1.0e6f), everything));
+
+	for(uint32 i = 0; i < BVH_SLOTS; ++i)
+	{
+		TEST_CHECK(bvh.Remove(shadows[i].Handle) == shadows[i].Inserted);
+		shadows[i].Inserted = false;
+	}
+	TEST_CHECK(CheckTree(bvh, shadows));
+	TEST_CHECK(bvh.GetHeight() == 0);
+	return true;
+}
+
+#define POOL_TEST_OBJECTS		1000
+
+struct PoolTestObject
+{
+	uint32		Value;
+	uint32		Padding[7];
+
+	explicit PoolTestObject(const uint32 value) : Value(value) {}
+};
+
+//static so the thread cache of the main thread is flushed before the pool goes away
+static TSlabPool<PoolTestObject> s_TestPool("Test");
+
+static void FreePoolObjects(std::vector<PoolTestObject*>* const objects)
+{
+	for(uint32 i = 0; i < objects->size(); ++i)
+		s_TestPool.Delete((*objects)[i]);
+}
+
+//objects allocated here and freed on another thread come back to the shared free list when that thread exits
+static bool TestPoolCrossThreadFree()
+{
+	std::vector<PoolTestObject*> objects(POOL_TEST_OBJECTS);
+	for(uint32 i = 0; i < POOL_TEST_OBJECTS; ++i)
+	{
+		objects[i] = s_TestPool.New(i);
+		TEST_CHECK(objects[i] != NULL && s_TestPool.Owns(objects[i]));
+	}
+
+	PoolStats before;
+	s_TestPool.GetStats(before);
+	TEST_CHECK(before.SlotSize == sizeof(PoolTestObject));
+	TEST_CHECK(before.Capacity == before.SlabCnt * (POOL_SLAB_BYTES / before.SlotSize));
+	TEST_CHECK(before.Outstanding >= POOL_TEST_OBJECTS && before.Outstanding < POOL_TEST_OBJECTS + POOL_CACHE_BATCH);
+	TEST_CHECK(before.PeakOutstanding >= before.Outstanding);
+
+	std::thread worker(&FreePoolObjects, &objects);
+	worker.join();
+
+	//only what the cache of this thread still holds is missing
+	PoolStats after;
+	s_TestPool.GetStats(after);
+	TEST_CHECK(after.Outstanding == before.Outstanding - POOL_TEST_OBJECTS);
+	TEST_CHECK(after.Flushes > before.Flushes);
+	TEST_CHECK(after.SlabCnt == before.SlabCnt);
+
+	//the same slots are handed out again, no slab is added
+	for(uint32 i = 0; i < POOL_TEST_OBJECTS; ++i)
+		objects[i] = s_TestPool.New(i);
+
+	PoolStats reused;
+	s_TestPool.GetStats(reused);
+	TEST_CHECK(reused.SlabCnt == before.SlabCnt);
+	TEST_CHECK(reused.Refills > after.Refills);
+
+	FreePoolObjects(&objects);
+	return true;
+}
+
+static bool TestPoolDoubleFree()
+{
+#ifdef VOID_POOL_DEBUG
+	PoolStats before;
+	s_TestPool.GetStats(before);
+
+	//the second free is reported and ignored, the slot is not handed out twice
+	PoolTestObject* object = s_TestPool.New(1);
+	TEST_CHECK(object != NULL);
+	s_TestPool.Free(object);
+	s_TestPool.Free(object);
+
+	PoolStats after;
+	s_TestPool.GetStats(after);
+	TEST_CHECK(after.DoubleFrees == before.DoubleFrees + 1);
+
+	PoolTestObject* a = s_TestPool.New(2);
+	PoolTestObject* b = s_TestPool.New(3);
+	TEST_CHECK(a != NULL && b != NULL && a != b);
+	s_TestPool.Delete(a);
+	s_TestPool.Delete(b);
+
+	//a slot written after its free is reported when it is handed out again, the first bytes hold the free list link
+	PoolTestObject* written = s_TestPool.New(4);
+	s_TestPool.Delete(written);
+	written->Padding[2] = 5;
+	PoolTestObject* again = s_TestPool.New(6);
+	TEST_CHECK(again == written);
+	s_TestPool.Delete(again);
+
+	s_TestPool.GetStats(after);
+	TEST_CHECK(after.WritesAfterFree == before.WritesAfterFree + 1);
+	TEST_CHECK(after.DoubleFrees == before.DoubleFrees + 1);
+#else
+	printf("  skipped, needs VOID_POOL_DEBUG\n");
+#endif
+	return true;
+}
+
+struct SceneTest
+{
+	const char*		Name;
+	bool			(*Run)();
+};
+
+static const SceneTest s_Tests[] =
+{
+	{ "ConstantUploads",	&TestConstantUploads },
+	{ "BVH",				&TestBVH },
+	{ "PoolCrossThreadFree",	&TestPoolCrossThreadFree },
+	{ "PoolDoubleFree",		&TestPoolDoubleFree }
+};
+
+int main(int argc, char** argv)
+{
+	uint32 failed = 0;
+	for(uint32 i = 0; i < sizeof(s_Tests) / sizeof(SceneTest); ++i)
+	{
+		printf("%s\n", s_Tests[i].Name);
+		if(!s_Tests[i].Run())
+			++failed;
+	}
+
+	printf("%u of %u tests failed\n", failed, (uint32)(sizeof(s_Tests) / sizeof(SceneTest)));
+	return failed;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "../Header/CSpriteBenchmark.h"
+#include <atomic>
+#include <stdlib.h>
+#include <new>
+
+using namespace Void::Renderer;
+
+//headless sprite benchmark, writes one JSON line per run to the given file or stdout
+//usage: SpriteBench [output.json] [frames]
+
+static std::atomic<uint64> s_AllocationCnt(0);
+
+void* operator new(size_t size)
+{
+	++s_AllocationCnt;
+	void* memory = malloc(size > 0 ? size : 1);
+	if(memory == NULL)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+static uint64 CountAllocations()
+{
+	return s_AllocationCnt.load();
+}
+
+struct SpriteBenchMode
+{
+	const char*		Name;
+	SpriteRenderMode	Mode;
+	SpriteVertexFormat	Format;
+};
+
+static const SpriteBenchMode s_Modes[] =
+{
+	{ "vertex",		SPRITE_MODE_VERTEX,		SPRITE_FORMAT_FLOAT },
+	{ "compact",	SPRITE_MODE_VERTEX,		SPRITE_FORMAT_COMPACT_UNORM },
+	{ "instanced",	SPRITE_MODE_INSTANCED,	SPRITE_FORMAT_FLOAT }
+};
+
+static const float32 s_Sortedness[] = { 1.0f, 0.9f, 0.0f };
+
+int main(int argc, char** argv)
+{
+	FILE* output = stdout;
+	if(argc > 1 && (output = fopen(argv[1], "w")) == NULL)
+	{
+		printf("Can not open %s\n", argv[1]);
+		return 1;
+	}
+
+	uint32 frames = argc > 2 ? (uint32)atoi(argv[2]) : 100;
+	if(frames == 0)
+		frames = 1;
+
+	SpriteWorkloadParams params = CSpriteWorkload::GetDefaultParams();
+	CSpriteWorkload workload;
+	CSpriteNullSink sink;
+
+	bool succeeded = true;
+	for(uint32 mode = 0; mode < sizeof(s_Modes) / sizeof(SpriteBenchMode); ++mode)
+	{
+		//one renderer per mode, the headless setup never touches a device
+		CSpriteBenchmark benchmark;
+		if(!benchmark.InitializeHeadless(params.ScreenWidth, params.ScreenHeight, s_Modes[mode].Mode, s_Modes[mode].Format, &CountAllocations, &sink))
+		{
+			succeeded = false;
+			continue;
+		}
+
+		for(uint32 sortedness = 0; sortedness < sizeof(s_Sortedness) / sizeof(float32); ++sortedness)
+		{
+			params.Sortedness = s_Sortedness[sortedness];
+			workload.Generate(params);
+
+			for(uint32 inPlace = 0; inPlace < 2; ++inPlace)
+			{
+				SpriteBenchResult result;
+				if(!benchmark.Run(workload, frames, frames / 10, inPlace == 1, result))
+				{
+					succeeded = false;
+					continue;
+				}
+				CSpriteBenchmark::WriteResult(output, s_Modes[mode].Name, result);
+			}
+		}
+		benchmark.Release();
+	}
+
+	if(output != stdout)
+		fclose(output);
+	return succeeded ? 0 : 1;
+}
\ No newline at end of file
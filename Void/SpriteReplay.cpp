@@ -0,0 +1,55 @@
+#include "../Header/CSpriteBenchmark.h"
+#include "../Header/CSpriteCapture.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Void::Renderer;
+
+//headless replay of a sprite capture, prints the layers, sprites and time per sprite
+//usage: SpriteReplay capture.bin [loops] [vertex|compact|instanced]
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: SpriteReplay capture.bin [loops] [vertex|compact|instanced]\n");
+		return 1;
+	}
+
+	CSpriteCaptureReplay replay;
+	if(!replay.Open(argv[1]))
+	{
+		printf("Can not open %s\n", argv[1]);
+		return 1;
+	}
+
+	uint32 loops = argc > 2 ? (uint32)atoi(argv[2]) : 1;
+	if(loops == 0)
+		loops = 1;
+
+	SpriteRenderMode mode = SPRITE_MODE_VERTEX;
+	SpriteVertexFormat format = SPRITE_FORMAT_FLOAT;
+	if(argc > 3 && strcmp(argv[3], "compact") == 0)
+		format = SPRITE_FORMAT_COMPACT_UNORM;
+	else if(argc > 3 && strcmp(argv[3], "instanced") == 0)
+		mode = SPRITE_MODE_INSTANCED;
+
+	//the benchmark only owns the headless renderer here, the capture drives it
+	CSpriteNullSink sink;
+	CSpriteBenchmark benchmark;
+	const SpriteCaptureHeader& header = replay.GetHeader();
+	if(!benchmark.InitializeHeadless(header.ScreenWidth, header.ScreenHeight, mode, format, NULL, &sink))
+		return 1;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	uint32 layers = replay.ReplayAll(benchmark.GetRenderer(), loops, &sink);
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	uint64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	uint32 sprites = sink.GetSpriteCount();
+	printf("layers %u, sprites %u, draws %u, bytes %llu, %.3f ns per sprite\n",
+			layers, sprites, sink.GetDrawCount(), (unsigned long long)sink.GetBytesCopied(), sprites > 0 ? (float32)ns / sprites : 0.0f);
+
+	benchmark.Release();
+	return layers == loops * replay.GetLayerCount() ? 0 : 1;
+}
\ No newline at end of file
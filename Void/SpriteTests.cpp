@@ -0,0 +1,601 @@
+#include "../Header/CSpriteRenderer.h"
+#include "../Header/CSpriteCommandList.h"
+#include "../Header/CSpriteWorkload.h"
+#include <stdlib.h>
+
+using namespace Void::Renderer;
+
+//headless checks of the sprite pipeline, returns the number of failed tests
+//usage: SpriteTests
+
+#define TEST_CHECK(condition) \
+	if(!(condition)) \
+	{ \
+		printf("  failed: %s (line %d)\n", #condition, __LINE__); \
+		return false; \
+	}
+
+static void MakeSprite(RenderJob_Sprite::Sprite& sprite, const float32 x, const float32 y, const float32 size)
+{
+	sprite.PositionMin = CVector2(x, y);
+	sprite.PositionMax = CVector2(x + size, y + size);
+	sprite.TexCoordMin = CVector2(0.0f, 0.0f);
+	sprite.TexCoordMax = CVector2(1.0f, 1.0f);
+}
+
+//sorts keys through the sorter and checks the order against std::stable_sort of the same keys
+static bool CheckSortOrder(CSpriteJobSorter& sorter, const std::vector<uint64>& keys)
+{
+	std::vector<RenderJob_Sprite> jobs(keys.size());
+	std::deque<RenderJob_Sprite* const> queue;
+	for(uint32 i = 0; i < keys.size(); ++i)
+	{
+		jobs[i].SortingKey = keys[i];
+		queue.push_back(&jobs[i]);
+	}
+
+	std::vector<RenderJob_Sprite*> sortedJobs;
+	std::vector<uint32> order;
+	sorter.Sort(queue, sortedJobs, NULL, &order);
+
+	std::vector<uint32> expected(keys.size());
+	for(uint32 i = 0; i < expected.size(); ++i)
+		expected[i] = i;
+	std::stable_sort(expected.begin(), expected.end(), [&keys](const uint32 a, const uint32 b) { return keys[a] < keys[b]; });
+
+	if(order != expected)
+		return false;
+	for(uint32 i = 0; i < sortedJobs.size(); ++i)
+	{
+		if(sortedJobs[i] != &jobs[expected[i]])
+			return false;
+	}
+	return true;
+}
+
+//few distinct keys so equal keys have to keep their queue order
+static uint64 RandomKey()
+{
+	return ((uint64)(rand() % 4) << 48) | ((uint64)(rand() % 8) << 32) | ((uint64)(rand() % 16) << 16);
+}
+
+static bool TestJobSorter()
+{
+	srand(64);
+	CSpriteJobSorter sorter;
+	std::vector<uint64> keys;
+
+	//below the insertion threshold
+	keys.resize(SPRITESORT_INSERTION_THRESHOLD - 1);
+	for(uint32 i = 0; i < keys.size(); ++i)
+		keys[i] = RandomKey();
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+
+	//random keys go through the radix passes
+	keys.resize(4096);
+	for(uint32 i = 0; i < keys.size(); ++i)
+		keys[i] = RandomKey();
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+
+	//sorted with a few neighbours swapped, the bounded insertion sort finishes
+	std::sort(keys.begin(), keys.end());
+	for(uint32 i = 0; i + 1 < keys.size(); i += 256)
+		std::swap(keys[i], keys[i + 1]);
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+
+	//few descents but the smallest keys sit at the end, the insertion sort gives up halfway and radix takes over
+	std::sort(keys.begin(), keys.end());
+	for(uint32 i = keys.size() - 64; i < keys.size(); ++i)
+		keys[i] = i & 1;
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+
+	//already sorted and empty queues
+	std::sort(keys.begin(), keys.end());
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+	keys.clear();
+	TEST_CHECK(CheckSortOrder(sorter, keys));
+	return true;
+}
+
+//producers submit through AddRenderJob and frame memory while the render thread builds,
+//waves of them exit on the way and their buffers have to go once their jobs were built
+#define STRESS_WAVES			4
+#define STRESS_PRODUCERS		8
+#define STRESS_FRAMES			200
+#define STRESS_JOBS_PER_FRAME	16
+
+struct StressProducer
+{
+	CSpriteRenderer*				Renderer;
+	uint32						Index;
+	std::atomic<uint64>*				SpritesSubmitted;
+	std::vector<RenderJob_Sprite>			Jobs;
+	std::vector<RenderJob_Sprite::Sprite>	Sprites;
+};
+
+static void StressProducerMain(StressProducer* const producer)
+{
+	uint64 submitted = 0;
+	for(uint32 frame = 0; frame < STRESS_FRAMES; ++frame)
+	{
+		for(uint32 i = 0; i < STRESS_JOBS_PER_FRAME; ++i)
+		{
+			bool curtain = ((i + producer->Index) & 1) != 0;
+			uint32 spriteCnt = 1 + (frame + i) % 4;
+
+			//every other job in frame memory, the rest from memory the producer keeps alive
+			if(i & 2)
+			{
+				RenderJob_Sprite* job = producer->Renderer->BeginSpriteJob(curtain, spriteCnt);
+				if(job == NULL)
+					continue;
+
+				for(uint32 j = 0; j < spriteCnt; ++j)
+					MakeSprite(job->SpritePtr[j], (float32)(j * 40), (float32)(i * 40), 32.0f);
+				job->EffectId	= EffectId_Default;
+				job->TextureId	= (TextureId)(1 + i % 3);
+				job->FinalAlpha	= 1.0f;
+				producer->Renderer->EndSpriteJob(job);
+			}
+			else
+			{
+				uint32 index = producer->Jobs.size();
+				producer->Jobs.push_back(RenderJob_Sprite());
+				RenderJob_Sprite& job = producer->Jobs[index];
+				job.SpritePtr	= &producer->Sprites[index * 4];
+				job.SpriteCnt	= spriteCnt;
+				job.IsCurtain	= curtain;
+				job.EffectId	= EffectId_Default;
+				job.TextureId	= (TextureId)(1 + i % 3);
+				job.FinalAlpha	= 1.0f;
+				for(uint32 j = 0; j < spriteCnt; ++j)
+					MakeSprite(job.SpritePtr[j], (float32)(j * 40), (float32)(i * 40), 32.0f);
+				producer->Renderer->AddRenderJob(&job);
+			}
+			submitted += spriteCnt;
+		}
+	}
+	producer->SpritesSubmitted->fetch_add(submitted);
+}
+
+static bool TestSubmitStress()
+{
+	CSpriteRenderer renderer;
+	TEST_CHECK(renderer.Initialize(NULL, 1920.0f, 1080.0f));
+
+	CSpriteNullSink sink;
+	CSpriteCommandList list;
+	std::atomic<uint64> spritesSubmitted(0);
+	std::atomic<uint32> wavesDone(0);
+
+	//the vectors must not reallocate while the jobs are queued
+	std::vector<StressProducer*> producers;
+	for(uint32 i = 0; i < STRESS_WAVES * STRESS_PRODUCERS; ++i)
+	{
+		StressProducer* producer = new StressProducer();
+		producer->Renderer			= &renderer;
+		producer->Index				= i;
+		producer->SpritesSubmitted	= &spritesSubmitted;
+		producer->Jobs.reserve(STRESS_FRAMES * STRESS_JOBS_PER_FRAME);
+		producer->Sprites.resize(STRESS_FRAMES * STRESS_JOBS_PER_FRAME * 4);
+		producers.push_back(producer);
+	}
+
+	std::thread waves([&producers, &wavesDone]()
+	{
+		for(uint32 wave = 0; wave < STRESS_WAVES; ++wave)
+		{
+			std::vector<std::thread> threads;
+			for(uint32 i = 0; i < STRESS_PRODUCERS; ++i)
+				threads.push_back(std::thread(&StressProducerMain, producers[wave * STRESS_PRODUCERS + i]));
+			for(uint32 i = 0; i < threads.size(); ++i)
+				threads[i].join();
+		}
+		wavesDone.store(1);
+	});
+
+	uint32 frames = 0;
+	uint32 peakBuffers = 0;
+	while(wavesDone.load() == 0)
+	{
+		renderer.BuildBackground(list);
+		renderer.Execute(list, &sink);
+		renderer.BuildForeground(list);
+		renderer.Execute(list, &sink);
+
+		uint32 buffers = renderer.GetSubmitBufferCount();
+		peakBuffers = buffers > peakBuffers ? buffers : peakBuffers;
+		++frames;
+	}
+	waves.join();
+
+	//jobs of the last frame sit in the active queue, the next swap picks them up
+	uint64 pending = renderer.GetPendingSpriteCount(0) + renderer.GetPendingSpriteCount(1);
+	TEST_CHECK(sink.GetSpriteCount() + pending == spritesSubmitted.load());
+	for(uint32 i = 0; i < 2; ++i)
+	{
+		renderer.BuildBackground(list);
+		renderer.Execute(list, &sink);
+		renderer.BuildForeground(list);
+		renderer.Execute(list, &sink);
+	}
+
+	printf("  %u frames, %llu sprites, %u buffers at peak\n", frames, (unsigned long long)spritesSubmitted.load(), peakBuffers);
+	TEST_CHECK(sink.GetSpriteCount() == spritesSubmitted.load());
+	TEST_CHECK(renderer.GetSubmitBufferCount() == 0);
+	TEST_CHECK(renderer.GetPendingSpriteCount(0) == 0 && renderer.GetPendingSpriteCount(1) == 0);
+
+	renderer.Release();
+	for(uint32 i = 0; i < producers.size(); ++i)
+		delete producers[i];
+	return true;
+}
+
+//records what a headless renderer in mode draws for the jobs of workload
+static bool RecordWorkload(CSpriteWorkload& workload, const SpriteRenderMode mode, CSpriteCommandRecorder& recorder)
+{
+	const SpriteWorkloadParams& params = workload.GetParams();
+	CSpriteRenderer renderer;
+	if(!renderer.Initialize(NULL, params.ScreenWidth, params.ScreenHeight, mode))
+		return false;
+
+	CSpriteCommandList list;
+	workload.Submit(&renderer);
+	renderer.BuildBackground(list);
+	renderer.Execute(list, &recorder);
+	renderer.BuildForeground(list);
+	renderer.Execute(list, &recorder);
+	return true;
+}
+
+//instance records expanded the way the instancing vertex shader does have to match the vertex path bit for bit
+static bool TestInstanceReference()
+{
+	SpriteWorkloadParams params = CSpriteWorkload::GetDefaultParams();
+	params.JobCnt		= 500;
+	params.SpriteSize	= 17.5f;
+	CSpriteWorkload workload;
+	workload.Generate(params);
+
+	CSpriteCommandRecorder vertices;
+	CSpriteCommandRecorder instances;
+	TEST_CHECK(RecordWorkload(workload, SPRITE_MODE_VERTEX, vertices));
+	TEST_CHECK(RecordWorkload(workload, SPRITE_MODE_INSTANCED, instances));
+	TEST_CHECK(vertices.GetDrawCount() == instances.GetDrawCount());
+
+	uint32 spriteCnt = instances.GetDrawnData().size() / sizeof(Instance_Sprite);
+	TEST_CHECK(spriteCnt == workload.GetSpriteCount());
+	TEST_CHECK(vertices.GetDrawnData().size() == spriteCnt * sizeof(Vertex_Sprite) * 4);
+
+	const Instance_Sprite* records = (const Instance_Sprite*)&instances.GetDrawnData()[0];
+	const Vertex_Sprite* expected = (const Vertex_Sprite*)&vertices.GetDrawnData()[0];
+	for(uint32 i = 0; i < spriteCnt; ++i)
+	{
+		Vertex_Sprite quad[4];
+		CSpriteVertexKernel::ExpandInstance(records[i], quad);
+		TEST_CHECK(memcmp(quad, &expected[i * 4], sizeof(quad)) == 0);
+	}
+	return true;
+}
+
+//jobs with the same effect, texture and alpha fold into one draw, a texture or alpha change splits the run
+static bool TestCoalescing()
+{
+	CSpriteRenderer renderer;
+	TEST_CHECK(renderer.Initialize(NULL, 1920.0f, 1080.0f));
+
+	static const TextureId s_Textures[] = { 1, 1, 1, 2 };
+	static const float32 s_Alphas[] = { 1.0f, 1.0f, 0.5f, 0.5f };
+	RenderJob_Sprite::Sprite sprites[4][2];
+	RenderJob_Sprite jobs[4];
+	for(uint32 i = 0; i < 4; ++i)
+	{
+		for(uint32 j = 0; j < 2; ++j)
+			MakeSprite(sprites[i][j], (float32)(i * 100 + j * 40), 100.0f, 32.0f);
+		jobs[i].SpritePtr	= sprites[i];
+		jobs[i].SpriteCnt	= 2;
+		jobs[i].IsCurtain	= false;
+		jobs[i].EffectId	= EffectId_Default;
+		jobs[i].TextureId	= s_Textures[i];
+		jobs[i].FinalAlpha	= s_Alphas[i];
+		renderer.AddRenderJob(&jobs[i]);
+	}
+
+	CSpriteCommandList list;
+	CSpriteCommandRecorder recorder;
+	renderer.BuildBackground(list);
+	renderer.Execute(list, &recorder);
+	renderer.Release();
+
+	static const SpriteCommand s_Expected[] =
+	{
+		{ SPRITECMD_BIND_EFFECT,	EffectId_Default,	0, 0, 0, 0.0f },
+		{ SPRITECMD_BIND_TEXTURE,	1,					0, 0, 0, 0.0f },
+		{ SPRITECMD_SET_ALPHA,		0,					0, 0, 0, 1.0f },
+		{ SPRITECMD_DRAW,			0,					0, 4, 0, 0.0f },
+		{ SPRITECMD_SET_ALPHA,		0,					0, 0, 0, 0.5f },
+		{ SPRITECMD_DRAW,			0,					4, 2, 0, 0.0f },
+		{ SPRITECMD_BIND_TEXTURE,	2,					0, 0, 0, 0.0f },
+		{ SPRITECMD_DRAW,			0,					6, 2, 0, 0.0f }
+	};
+
+	const std::vector<SpriteCommand>& commands = recorder.GetCommands();
+	TEST_CHECK(commands.size() == sizeof(s_Expected) / sizeof(SpriteCommand));
+	for(uint32 i = 0; i < commands.size(); ++i)
+	{
+		TEST_CHECK(commands[i].Type == s_Expected[i].Type);
+		TEST_CHECK(commands[i].Id == s_Expected[i].Id);
+		TEST_CHECK(commands[i].First == s_Expected[i].First);
+		TEST_CHECK(commands[i].Count == s_Expected[i].Count);
+		TEST_CHECK(commands[i].Alpha == s_Expected[i].Alpha);
+	}
+	TEST_CHECK(recorder.GetDrawnData().size() == 8 * 4 * sizeof(Vertex_Sprite));
+	return true;
+}
+
+//jobs in frame memory are recycled after a frame and can not be retained
+static bool TestRetainedFrameMemory()
+{
+	CSpriteRenderer renderer;
+	TEST_CHECK(renderer.Initialize(NULL, 1920.0f, 1080.0f));
+
+	RenderJob_Sprite* job = renderer.BeginSpriteJob(false, 1);
+	TEST_CHECK(job != NULL);
+	MakeSprite(job->SpritePtr[0], 0.0f, 0.0f, 32.0f);
+	job->EffectId	= EffectId_Default;
+	job->TextureId	= TextureId_Default;
+	job->FinalAlpha	= 1.0f;
+	renderer.EndSpriteJob(job);
+	TEST_CHECK(renderer.AddRetainedJob(job) == SpriteJobHandle_Invalid);
+
+	RenderJob_Sprite::Sprite sprite;
+	RenderJob_Sprite kept = *job;
+	kept.SpritePtr = &sprite;
+	MakeSprite(sprite, 0.0f, 0.0f, 32.0f);
+	TEST_CHECK(renderer.AddRetainedJob(&kept) != SpriteJobHandle_Invalid);
+
+	renderer.Release();
+	return true;
+}
+
+//a retained job draws the same vertices as the job queued for one frame
+static bool RecordJob(RenderJob_Sprite& job, const bool retained, CSpriteCommandRecorder& recorder)
+{
+	CSpriteRenderer renderer;
+	if(!renderer.Initialize(NULL, 1920.0f, 1080.0f))
+		return false;
+
+	if(retained)
+		renderer.AddRetainedJob(&job);
+	else
+		renderer.AddRenderJob(&job);
+
+	CSpriteCommandList list;
+	renderer.BuildBackground(list);
+	renderer.Execute(list, &recorder);
+	renderer.Release();
+	return true;
+}
+
+static bool TestRetainedPayload()
+{
+	RenderJob_Sprite::Sprite sprites[3];
+	for(uint32 i = 0; i < 3; ++i)
+		MakeSprite(sprites[i], (float32)(i * 50), 10.0f, 40.0f);
+
+	RenderJob_Sprite job;
+	job.SpritePtr	= sprites;
+	job.SpriteCnt	= 3;
+	job.IsCurtain	= false;
+	job.EffectId	= EffectId_Default;
+	job.TextureId	= TextureId_Default;
+	job.FinalAlpha	= 1.0f;
+
+	CSpriteCommandRecorder queued;
+	CSpriteCommandRecorder retained;
+	TEST_CHECK(RecordJob(job, false, queued));
+	TEST_CHECK(RecordJob(job, true, retained));
+	TEST_CHECK(queued.GetDrawnData().size() == 3 * 4 * sizeof(Vertex_Sprite));
+	TEST_CHECK(retained.GetDrawnData() == queued.GetDrawnData());
+	return true;
+}
+
+//compact vertices at 3840x2160 stay within half a pixel of the float path, unorm texcoords within
+//a small fraction of a texel and half texcoords within a texel of a 4096 texture
+#define QUANT_SPRITES			4096
+#define QUANT_SCREEN_WIDTH		3840.0f
+#define QUANT_SCREEN_HEIGHT		2160.0f
+#define QUANT_TEXTURE_SIZE		4096.0f
+
+static float32 RandomUnit()
+{
+	return (float32)rand() / (float32)RAND_MAX;
+}
+
+static float32 Distance(const float32 a, const float32 b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static bool TestCompactQuantization()
+{
+	srand(4096);
+	std::vector<RenderJob_Sprite::Sprite> sprites(QUANT_SPRITES);
+	for(uint32 i = 0; i < QUANT_SPRITES; ++i)
+	{
+		float32 x = RandomUnit() * (QUANT_SCREEN_WIDTH - 64.0f);
+		float32 y = RandomUnit() * (QUANT_SCREEN_HEIGHT - 64.0f);
+		float32 u = RandomUnit() * 0.9f;
+		float32 v = RandomUnit() * 0.9f;
+		sprites[i].PositionMin = CVector2(x, y);
+		sprites[i].PositionMax = CVector2(x + 1.0f + RandomUnit() * 63.0f, y + 1.0f + RandomUnit() * 63.0f);
+		sprites[i].TexCoordMin = CVector2(u, v);
+		sprites[i].TexCoordMax = CVector2(u + RandomUnit() * 0.1f, v + RandomUnit() * 0.1f);
+	}
+
+	const SpriteTexTransform& transform = CSpriteVertexKernel::IdentityTexTransform;
+	std::vector<Vertex_Sprite> expected(QUANT_SPRITES * 4);
+	CSpriteVertexKernel::FillScalar(&expected[0], &sprites[0], QUANT_SPRITES, QUANT_SCREEN_HEIGHT, transform);
+
+	for(uint32 half = 0; half < 2; ++half)
+	{
+		std::vector<Vertex_SpriteCompact> scalar(QUANT_SPRITES * 4);
+		std::vector<Vertex_SpriteCompact> sse2(QUANT_SPRITES * 4);
+		CSpriteVertexKernel::GetCompactKernel(CCpuFeatures::SIMD_SCALAR, half == 1)(&scalar[0], &sprites[0], QUANT_SPRITES, QUANT_SCREEN_HEIGHT, transform);
+		CSpriteVertexKernel::GetCompactKernel(CCpuFeatures::SIMD_SSE2, half == 1)(&sse2[0], &sprites[0], QUANT_SPRITES, QUANT_SCREEN_HEIGHT, transform);
+		TEST_CHECK(memcmp(&scalar[0], &sse2[0], scalar.size() * sizeof(Vertex_SpriteCompact)) == 0);
+
+		float32 maxPosition = 0.0f;
+		float32 maxTexel = 0.0f;
+		for(uint32 i = 0; i < scalar.size(); ++i)
+		{
+			Vertex_Sprite vertex;
+			CSpriteVertexKernel::ExpandCompactVertex(scalar[i], half == 1, vertex);
+
+			float32 position = Distance(vertex.Position.X, expected[i].Position.X);
+			position = Distance(vertex.Position.Y, expected[i].Position.Y) > position ? Distance(vertex.Position.Y, expected[i].Position.Y) : position;
+			float32 texel = Distance(vertex.Texture0_U, expected[i].Texture0_U) * QUANT_TEXTURE_SIZE;
+			texel = Distance(vertex.Texture0_V, expected[i].Texture0_V) * QUANT_TEXTURE_SIZE > texel ? Distance(vertex.Texture0_V, expected[i].Texture0_V) * QUANT_TEXTURE_SIZE : texel;
+
+			maxPosition = position > maxPosition ? position : maxPosition;
+			maxTexel = texel > maxTexel ? texel : maxTexel;
+		}
+
+		printf("  %s: %.4f px, %.4f texels\n", half == 1 ? "half" : "unorm", maxPosition, maxTexel);
+		TEST_CHECK(maxPosition <= 0.5f);
+		TEST_CHECK(maxTexel <= (half == 1 ? 1.0f : 0.05f));
+	}
+
+	//every finite half survives the round trip
+	for(uint32 i = 0; i < 0x10000; ++i)
+	{
+		if((i & 0x7c00) == 0x7c00)
+			continue;
+		TEST_CHECK(CSpriteVertexKernel::FloatToHalf(CSpriteVertexKernel::HalfToFloat((uint16)i)) == i);
+	}
+	return true;
+}
+
+//simd float kernels write the same bytes as the scalar kernel for every count, aligned or not,
+//the counts cover the tails left over by the two sprites per iteration of the avx kernel
+static bool TestFloatKernels()
+{
+	static const uint32 s_Counts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 31, 33, 1001 };
+	static const SpriteTexTransform s_Transform = { 0.25f, 0.5f, 0.125f, 0.375f };
+
+	srand(1001);
+	std::vector<RenderJob_Sprite::Sprite> sprites(1001);
+	for(uint32 i = 0; i < sprites.size(); ++i)
+	{
+		float32 x = RandomUnit() * 1920.0f;
+		float32 y = RandomUnit() * 1080.0f;
+		sprites[i].PositionMin = CVector2(x, y);
+		sprites[i].PositionMax = CVector2(x + RandomUnit() * 100.0f, y + RandomUnit() * 100.0f);
+		sprites[i].TexCoordMin = CVector2(RandomUnit(), RandomUnit());
+		sprites[i].TexCoordMax = CVector2(RandomUnit(), RandomUnit());
+	}
+
+	CCpuFeatures::SimdLevel supported = CCpuFeatures::DetectLevel();
+	for(uint32 level = CCpuFeatures::SIMD_SSE2; level <= CCpuFeatures::SIMD_AVX && level <= (uint32)supported; ++level)
+	{
+		SpriteVertexKernel kernel = CSpriteVertexKernel::GetKernel((CCpuFeatures::SimdLevel)level);
+		for(uint32 i = 0; i < sizeof(s_Counts) / sizeof(uint32); ++i)
+		{
+			uint32 count = s_Counts[i];
+			std::vector<Vertex_Sprite> expected(count * 4);
+			CSpriteVertexKernel::FillScalar(&expected[0], &sprites[0], count, 1080.0f, s_Transform);
+
+			//one spare vertex in front, an offset of 4 bytes takes the unaligned stores
+			std::vector<uint8> output((count * 4 + 1) * sizeof(Vertex_Sprite) + 32);
+			uint8* base = (uint8*)(((size_t)&output[0] + 31) & ~(size_t)31);
+			for(uint32 offset = 0; offset <= 4; offset += 4)
+			{
+				memset(&output[0], 0xCD, output.size());
+				kernel((Vertex_Sprite*)(base + offset), &sprites[0], count, 1080.0f, s_Transform);
+				TEST_CHECK(memcmp(base + offset, &expected[0], count * 4 * sizeof(Vertex_Sprite)) == 0);
+				TEST_CHECK(base[offset + count * 4 * sizeof(Vertex_Sprite)] == 0xCD);
+			}
+		}
+		printf("  %s matches scalar\n", level == CCpuFeatures::SIMD_AVX ? "avx" : "sse2");
+	}
+	return true;
+}
+
+//an opaque foreground sprite hides the background under it when both layers are built front to back,
+//the same sprite drawn with a blending effect hides nothing
+static uint64 CountBackgroundSprites(const bool opaqueEffect)
+{
+	CSpriteRenderer renderer;
+	if(!renderer.Initialize(NULL, 1920.0f, 1080.0f))
+		return ~0ull;
+	renderer.SetCulling(true, true);
+	renderer.SetTextureOpaque(1, true);
+	renderer.SetEffectOpaque(EffectId_Default, opaqueEffect);
+
+	RenderJob_Sprite::Sprite sprites[9];
+	RenderJob_Sprite jobs[2];
+	MakeSprite(sprites[0], 0.0f, 0.0f, 1920.0f);
+	for(uint32 i = 1; i < 9; ++i)
+		MakeSprite(sprites[i], (float32)(i * 100), 200.0f, 64.0f);
+	for(uint32 i = 0; i < 2; ++i)
+	{
+		jobs[i].SpritePtr	= i == 0 ? &sprites[0] : &sprites[1];
+		jobs[i].SpriteCnt	= i == 0 ? 1 : 8;
+		jobs[i].IsCurtain	= i == 0;
+		jobs[i].EffectId	= EffectId_Default;
+		jobs[i].TextureId	= 1;
+		jobs[i].FinalAlpha	= 1.0f;
+		renderer.AddRenderJob(&jobs[i]);
+	}
+
+	CSpriteNullSink background;
+	CSpriteNullSink foreground;
+	CSpriteCommandList backgroundList;
+	CSpriteCommandList foregroundList;
+	renderer.BuildFrame(backgroundList, foregroundList);
+	renderer.Execute(backgroundList, &background);
+	renderer.Execute(foregroundList, &foreground);
+	renderer.Release();
+
+	return foreground.GetSpriteCount() == 1 ? background.GetSpriteCount() : ~0ull;
+}
+
+static bool TestOverdrawAcrossLayers()
+{
+	TEST_CHECK(CountBackgroundSprites(true) == 0);
+	TEST_CHECK(CountBackgroundSprites(false) == 8);
+	return true;
+}
+
+struct SpriteTest
+{
+	const char*		Name;
+	bool			(*Run)();
+};
+
+static const SpriteTest s_Tests[] =
+{
+	{ "JobSorter",			&TestJobSorter },
+	{ "Coalescing",			&TestCoalescing },
+	{ "SubmitStress",		&TestSubmitStress },
+	{ "InstanceReference",	&TestInstanceReference },
+	{ "RetainedFrameMemory",	&TestRetainedFrameMemory },
+	{ "RetainedPayload",		&TestRetainedPayload },
+	{ "CompactQuantization",	&TestCompactQuantization },
+	{ "FloatKernels",		&TestFloatKernels },
+	{ "OverdrawAcrossLayers",	&TestOverdrawAcrossLayers }
+};
+
+int main(int argc, char** argv)
+{
+	uint32 failed = 0;
+	for(uint32 i = 0; i < sizeof(s_Tests) / sizeof(SpriteTest); ++i)
+	{
+		printf("%s\n", s_Tests[i].Name);
+		if(!s_Tests[i].Run())
+			++failed;
+	}
+
+	printf("%u of %u tests failed\n", failed, (uint32)(sizeof(s_Tests) / sizeof(SpriteTest)));
+	return failed;
+}
\ No newline at end of file